@@ -25,7 +25,8 @@ bool_synopsis::bool_synopsis(vast::type x) : synopsis{std::move(x)} {
 }
 
 bool_synopsis::bool_synopsis(bool true_, bool false_)
-  : synopsis{bool_type{}}, true_(true_), false_(false_) {
+  : synopsis{bool_type{}}, true_(true_), false_(false_), nil_(true) {
+  // nop
 }
 
 void bool_synopsis::add(data_view x) {
@@ -36,6 +37,10 @@ void bool_synopsis::add(data_view x) {
     false_ = true;
 }
 
+void bool_synopsis::add_nil() {
+  nil_ = true;
+}
+
 size_t bool_synopsis::size_bytes() const {
   return sizeof(bool_synopsis);
 }
@@ -46,7 +51,8 @@ caf::optional<bool> bool_synopsis::lookup(relational_operator op,
     if (op == equal)
       return *b ? true_ : false_;
     if (op == not_equal)
-      return *b ? false_ : true_;
+      // Nil values differ from every value.
+      return nil_ || (*b ? false_ : true_);
   }
   return caf::none;
 }
@@ -71,6 +77,8 @@ caf::error bool_synopsis::serialize(caf::serializer& sink) const {
 }
 
 caf::error bool_synopsis::deserialize(caf::deserializer& source) {
+  // Like the flatbuffer layout, the serialized form omits nil values.
+  nil_ = true;
   return source(false_, true_);
 }
 
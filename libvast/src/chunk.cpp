@@ -24,6 +24,7 @@
 #include <caf/make_counted.hpp>
 #include <caf/serializer.hpp>
 
+#include <cstdint>
 #include <cstring>
 #include <fcntl.h>
 #include <memory>
@@ -104,6 +105,21 @@ chunk_ptr chunk::slice(size_type start, size_type length) const {
   return make(view_.subspan(start, length), [=]() noexcept { this->deref(); });
 }
 
+void chunk::prefetch(size_type start, size_type length) const noexcept {
+  VAST_ASSERT(start < size());
+  if (length > size() - start)
+    length = size() - start;
+  // The address passed to madvise must be page-aligned, so we extend the range
+  // to the start of its first page.
+  static const auto page_size
+    = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+  auto first = reinterpret_cast<uintptr_t>(data() + start);
+  auto aligned_first = first & ~(page_size - 1);
+  length += first - aligned_first;
+  // This is only a hint, so we deliberately ignore failures.
+  ::madvise(reinterpret_cast<void*>(aligned_first), length, MADV_WILLNEED);
+}
+
 // -- concepts -----------------------------------------------------------------
 
 span<const byte> as_bytes(const chunk_ptr& x) noexcept {
@@ -0,0 +1,63 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/detail/lz4.hpp"
+
+#include "lz4/lib/lz4.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace vast::detail::lz4 {
+
+size_t compress_bound(size_t size) noexcept {
+  if (size > LZ4_MAX_INPUT_SIZE)
+    return 0;
+  return LZ4_compressBound(static_cast<int>(size));
+}
+
+size_t decompress_bound(size_t size) noexcept {
+  // Every byte of a block encodes at most 255 bytes of output, and no block
+  // decompresses to more than the maximum input size of LZ4.
+  constexpr auto max_ratio = size_t{255};
+  if (size > LZ4_MAX_INPUT_SIZE / max_ratio)
+    return LZ4_MAX_INPUT_SIZE;
+  return size * max_ratio;
+}
+
+size_t compress(span<const byte> input, span<byte> output) noexcept {
+  if (input.size() > LZ4_MAX_INPUT_SIZE)
+    return 0;
+  constexpr auto max_output_size
+    = static_cast<size_t>(std::numeric_limits<int>::max());
+  auto n = ::LZ4_compress_default(
+    reinterpret_cast<const char*>(input.data()),
+    reinterpret_cast<char*>(output.data()), static_cast<int>(input.size()),
+    static_cast<int>(std::min(output.size(), max_output_size)));
+  return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+size_t decompress(span<const byte> input, span<byte> output) noexcept {
+  constexpr auto max_size
+    = static_cast<size_t>(std::numeric_limits<int>::max());
+  if (input.size() > max_size)
+    return 0;
+  auto n = ::LZ4_decompress_safe(reinterpret_cast<const char*>(input.data()),
+                                 reinterpret_cast<char*>(output.data()),
+                                 static_cast<int>(input.size()),
+                                 static_cast<int>(
+                                   std::min(output.size(), max_size)));
+  return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+} // namespace vast::detail::lz4
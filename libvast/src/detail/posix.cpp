@@ -337,6 +337,50 @@ caf::expected<size_t> write(int fd, const void* buffer, size_t bytes) {
   return total;
 }
 
+caf::expected<size_t>
+pread(int fd, void* buffer, size_t bytes, size_t offset) {
+  auto total = size_t{0};
+  auto buf = reinterpret_cast<uint8_t*>(buffer);
+  while (total < bytes) {
+    ssize_t taken;
+    // See the comment in read above.
+    constexpr size_t read_max = std::numeric_limits<int>::max();
+    auto request_size = std::min(read_max, bytes - total);
+    do {
+      taken = ::pread(fd, buf + total, request_size, offset + total);
+    } while (taken < 0 && errno == EINTR);
+    if (taken < 0) // error
+      return make_error(ec::filesystem_error,
+                        "failed in pread(2):", std::strerror(errno));
+    if (taken == 0) // EOF
+      break;
+    total += static_cast<size_t>(taken);
+  }
+  return total;
+}
+
+caf::expected<size_t>
+pwrite(int fd, const void* buffer, size_t bytes, size_t offset) {
+  auto total = size_t{0};
+  auto buf = reinterpret_cast<const uint8_t*>(buffer);
+  while (total < bytes) {
+    ssize_t written;
+    // See the comment in write above.
+    constexpr size_t write_max = std::numeric_limits<int>::max();
+    auto request_size = std::min(write_max, bytes - total);
+    do {
+      written = ::pwrite(fd, buf + total, request_size, offset + total);
+    } while (written < 0 && errno == EINTR);
+    if (written < 0)
+      return make_error(ec::filesystem_error,
+                        "failed in pwrite(2):", std::strerror(errno));
+    if (written == 0)
+      return make_error(ec::filesystem_error, "pwrite(2) returned 0");
+    total += static_cast<size_t>(written);
+  }
+  return total;
+}
+
 caf::error seek(int fd, size_t bytes) {
   if (::lseek(fd, bytes, SEEK_CUR) == -1)
     return make_error(ec::filesystem_error,
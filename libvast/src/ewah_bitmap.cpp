@@ -13,12 +13,63 @@
 
 #include "vast/ewah_bitmap.hpp"
 
+#include <algorithm>
+
 namespace vast {
 
+namespace {
+
+thread_local ewah_bitmap_table* current_table = nullptr;
+
+} // namespace
+
+ewah_bitmap_table::ewah_bitmap_table() : previous_{current_table} {
+  current_table = this;
+}
+
+ewah_bitmap_table::ewah_bitmap_table(std::vector<ewah_bitmap> bitmaps)
+  : bitmaps_{std::move(bitmaps)}, previous_{current_table} {
+  current_table = this;
+}
+
+ewah_bitmap_table::~ewah_bitmap_table() {
+  VAST_ASSERT(current_table == this);
+  current_table = previous_;
+}
+
+ewah_bitmap_table* ewah_bitmap_table::current() {
+  return current_table;
+}
+
+uint64_t ewah_bitmap_table::add(const ewah_bitmap& bm) {
+  bitmaps_.push_back(bm);
+  return bitmaps_.size() - 1;
+}
+
+const ewah_bitmap* ewah_bitmap_table::at(uint64_t position) const {
+  if (position >= bitmaps_.size())
+    return nullptr;
+  return &bitmaps_[position];
+}
+
+const std::vector<ewah_bitmap>& ewah_bitmap_table::bitmaps() const {
+  return bitmaps_;
+}
+
 ewah_bitmap::ewah_bitmap(size_type n, bool bit) {
   append_bits(bit, n);
 }
 
+ewah_bitmap::ewah_bitmap(span<const block_type> blocks, size_type last_marker,
+                         size_type num_bits, chunk_ptr owner)
+  : last_marker_{last_marker},
+    num_bits_{num_bits},
+    view_{blocks},
+    owner_{std::move(owner)} {
+  VAST_ASSERT(owner_ != nullptr);
+  VAST_ASSERT(num_bits_ == 0 || last_marker_ + 1 < view_.size());
+}
+
 bool ewah_bitmap::empty() const {
   return num_bits_ == 0;
 }
@@ -27,11 +78,22 @@ ewah_bitmap::size_type ewah_bitmap::size() const {
   return num_bits_;
 }
 
-const ewah_bitmap::block_vector& ewah_bitmap::blocks() const {
+span<const ewah_bitmap::block_type> ewah_bitmap::blocks() const {
+  if (owner_)
+    return view_;
   return blocks_;
 }
 
+ewah_bitmap::size_type ewah_bitmap::last_marker() const {
+  return last_marker_;
+}
+
+bool ewah_bitmap::borrowed() const {
+  return owner_ != nullptr;
+}
+
 void ewah_bitmap::append_bit(bool bit) {
+  materialize();
   auto partial = num_bits_ % word_type::width;
   if (blocks_.empty()) {
     blocks_.push_back(0); // Always begin with an empty marker.
@@ -49,6 +111,7 @@ void ewah_bitmap::append_bit(bool bit) {
 void ewah_bitmap::append_bits(bool bit, size_type n) {
   if (n == 0)
     return;
+  materialize();
   if (blocks_.empty()) {
     blocks_.push_back(0); // Always begin with an empty marker.
   } else {
@@ -123,6 +186,7 @@ void ewah_bitmap::append_bits(bool bit, size_type n) {
 void ewah_bitmap::append_block(block_type value, size_type bits) {
   VAST_ASSERT(bits > 0);
   VAST_ASSERT(bits <= word_type::width);
+  materialize();
   if (blocks_.empty())
     blocks_.push_back(0); // Always begin with an empty marker.
   else if (num_bits_ % word_type::width == 0)
@@ -149,6 +213,7 @@ void ewah_bitmap::append_block(block_type value, size_type bits) {
 }
 
 void ewah_bitmap::flip() {
+  materialize();
   if (blocks_.empty())
     return;
   VAST_ASSERT(blocks_.size() >= 2);
@@ -237,7 +302,18 @@ void ewah_bitmap::bump_dirty_count() {
 bool operator==(const ewah_bitmap& x, const ewah_bitmap& y) {
   // If the block vector and the number of bits are equal, so must be the
   // marker by construction.
-  return x.blocks_ == y.blocks_ && x.num_bits_ == y.num_bits_;
+  auto xs = x.blocks();
+  auto ys = y.blocks();
+  return x.num_bits_ == y.num_bits_
+         && std::equal(xs.begin(), xs.end(), ys.begin(), ys.end());
+}
+
+void ewah_bitmap::materialize() {
+  if (!owner_)
+    return;
+  blocks_.assign(view_.begin(), view_.end());
+  view_ = {};
+  owner_ = nullptr;
 }
 
 ewah_bitmap_range::ewah_bitmap_range(const ewah_bitmap& bm)
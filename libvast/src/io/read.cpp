@@ -13,6 +13,7 @@
 
 #include "vast/io/read.hpp"
 
+#include "vast/detail/posix.hpp"
 #include "vast/error.hpp"
 #include "vast/file.hpp"
 #include "vast/path.hpp"
@@ -42,4 +43,17 @@ caf::expected<std::vector<byte>> read(const path& filename) {
   return buffer;
 }
 
+caf::expected<std::vector<byte>>
+read(const path& filename, size_t offset, size_t size) {
+  file f{filename};
+  if (!f.open(file::read_only))
+    return make_error(ec::filesystem_error, "failed open file");
+  std::vector<byte> buffer(size);
+  auto bytes_read = detail::pread(f.handle(), buffer.data(), size, offset);
+  if (!bytes_read)
+    return bytes_read.error();
+  buffer.resize(*bytes_read);
+  return buffer;
+}
+
 } // namespace vast::io
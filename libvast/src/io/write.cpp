@@ -26,4 +26,11 @@ caf::error write(const path& filename, span<const byte> xs) {
   return f.write(xs.data(), xs.size());
 }
 
+caf::error append(const path& filename, span<const byte> xs) {
+  file f{filename};
+  if (!f.open(file::write_only, true))
+    return make_error(ec::filesystem_error, "failed open file");
+  return f.write(xs.data(), xs.size());
+}
+
 } // namespace vast::io
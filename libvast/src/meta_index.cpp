@@ -18,6 +18,7 @@
 #include "vast/detail/set_operations.hpp"
 #include "vast/detail/string.hpp"
 #include "vast/expression.hpp"
+#include "vast/expression_visitors.hpp"
 #include "vast/fbs/utils.hpp"
 #include "vast/fwd.hpp"
 #include "vast/logger.hpp"
@@ -29,6 +30,8 @@
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
 
+#include <algorithm>
+
 namespace vast {
 
 void partition_synopsis::shrink() {
@@ -62,7 +65,9 @@ void partition_synopsis::add(const table_slice& slice,
     if (auto& syn = it->second) {
       for (size_t row = 0; row < slice.rows(); ++row) {
         auto view = slice.at(row, col);
-        if (!caf::holds_alternative<caf::none_t>(view))
+        if (caf::holds_alternative<caf::none_t>(view))
+          syn->add_nil();
+        else
           syn->add(std::move(view));
       }
     }
@@ -84,27 +89,67 @@ size_t meta_index::size_bytes() const {
 }
 
 void meta_index::add(const uuid& partition, const table_slice& slice) {
+  // The slice may add new fields to the partition.
+  erase_columns(partition);
   auto& part_syn = synopses_[partition];
   part_syn.add(slice, synopsis_options_);
+  add_columns(partition);
+}
+
+void meta_index::add_pending(const uuid& partition, std::string layout_name) {
+  pending_[partition] = std::move(layout_name);
 }
 
 void meta_index::erase(const uuid& partition) {
+  erase_columns(partition);
   synopses_.erase(partition);
+  pending_.erase(partition);
 }
 
 void meta_index::merge(const uuid& partition, partition_synopsis&& ps) {
+  erase_columns(partition);
   synopses_[partition] = std::move(ps);
+  add_columns(partition);
+  pending_.erase(partition);
 }
 
-partition_synopsis& meta_index::at(const uuid& partition) {
+const partition_synopsis& meta_index::at(const uuid& partition) const {
   return synopses_.at(partition);
 }
 
 void meta_index::replace(const uuid& partition,
                          std::unique_ptr<partition_synopsis> ps) {
+  erase_columns(partition);
+  synopses_[partition].field_synopses_.swap(ps->field_synopses_);
+  add_columns(partition);
+  pending_.erase(partition);
+}
+
+void meta_index::add_columns(const uuid& partition) {
+  auto it = synopses_.find(partition);
+  if (it == synopses_.end())
+    return;
+  for (auto& [field, syn] : it->second.field_synopses_) {
+    auto& column = columns_[field];
+    if (column.fqn.empty())
+      column.fqn = field.fqn();
+    column.synopses.emplace_back(partition, syn.get());
+  }
+}
+
+void meta_index::erase_columns(const uuid& partition) {
   auto it = synopses_.find(partition);
-  if (it != synopses_.end()) {
-    it->second.field_synopses_.swap(ps->field_synopses_);
+  if (it == synopses_.end())
+    return;
+  for (auto& [field, _] : it->second.field_synopses_) {
+    auto column = columns_.find(field);
+    if (column == columns_.end())
+      continue;
+    auto& xs = column->second.synopses;
+    auto pred = [&](auto& x) { return x.first == partition; };
+    xs.erase(std::remove_if(xs.begin(), xs.end(), pred), xs.end());
+    if (xs.empty())
+      columns_.erase(column);
   }
 }
 
@@ -122,12 +167,16 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
   using result_type = std::vector<uuid>;
   result_type memoized_partitions;
   auto all_partitions = [&] {
-    if (!memoized_partitions.empty() || synopses_.empty())
+    if (!memoized_partitions.empty()
+        || (synopses_.empty() && pending_.empty()))
       return memoized_partitions;
-    memoized_partitions.reserve(synopses_.size());
+    memoized_partitions.reserve(synopses_.size() + pending_.size());
     std::transform(synopses_.begin(), synopses_.end(),
                    std::back_inserter(memoized_partitions),
                    [](auto& x) { return x.first; });
+    std::transform(pending_.begin(), pending_.end(),
+                   std::back_inserter(memoized_partitions),
+                   [](auto& x) { return x.first; });
     std::sort(memoized_partitions.begin(), memoized_partitions.end());
     return memoized_partitions;
   };
@@ -151,51 +200,59 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
       for (auto& op : x) {
         auto xs = lookup(op);
         VAST_ASSERT(std::is_sorted(xs.begin(), xs.end()));
-        if (xs.size() == synopses_.size())
+        if (xs.size() == synopses_.size() + pending_.size())
           return xs; // short-circuit
         detail::inplace_unify(result, xs);
         VAST_ASSERT(std::is_sorted(result.begin(), result.end()));
       }
       return result;
     },
-    [&](const negation&) -> result_type {
-      // We cannot handle negations, because a synopsis may return false
-      // positives, and negating such a result may cause false
-      // negatives.
-      return all_partitions();
+    [&](const negation& x) -> result_type {
+      // We cannot negate the result of a lookup, because a synopsis may
+      // return false positives, and negating such a result may cause false
+      // negatives. Instead, we push the negation down into the operators of
+      // the predicates, which every synopsis answers conservatively.
+      return lookup(caf::visit(denegator{true}, x.expr()));
     },
     [&](const predicate& x) -> result_type {
       // Performs a lookup on all *matching* synopses with operator and
       // data from the predicate of the expression. The match function
-      // uses a qualified_record_field to determine whether the synopsis should
-      // be queried.
+      // uses a qualified_record_field and its fully qualified name to
+      // determine whether the synopses of a field should be queried. Every
+      // field is matched only once, regardless of the number of partitions.
       auto search = [&](auto match) {
         VAST_ASSERT(caf::holds_alternative<data>(x.rhs));
-        auto& rhs = caf::get<data>(x.rhs);
+        auto rhs = make_view(caf::get<data>(x.rhs));
         result_type result;
         auto found_matching_synopsis = false;
-        for (auto& [part_id, part_syn] : synopses_) {
-          VAST_DEBUG(this, "checks", part_id, "for predicate", x);
-          for (auto& [field, syn] : part_syn.field_synopses_) {
-            if (syn && match(field)) {
-              found_matching_synopsis = true;
-              auto opt = syn->lookup(x.op, make_view(rhs));
-              if (!opt || *opt) {
-                VAST_DEBUG(this, "selects", part_id, "at predicate", x);
-                result.push_back(part_id);
-                break;
-              }
+        for (auto& [field, column] : columns_) {
+          if (!match(field, column.fqn))
+            continue;
+          VAST_DEBUG(this, "checks field", column.fqn, "for predicate", x);
+          for (auto& [part_id, syn] : column.synopses) {
+            if (!syn)
+              continue;
+            found_matching_synopsis = true;
+            auto opt = syn->lookup(x.op, rhs);
+            if (!opt || *opt) {
+              VAST_DEBUG(this, "selects", part_id, "at predicate", x);
+              result.push_back(part_id);
             }
           }
         }
-        // Re-establish potentially violated invariant.
+        // We cannot rule out partitions without synopses.
+        for (auto& [part_id, layout_name] : pending_)
+          result.push_back(part_id);
+        // Re-establish potentially violated invariant. Partitions selected
+        // by multiple fields occur multiple times.
         std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
         return found_matching_synopsis ? result : all_partitions();
       };
       auto extract_expr = detail::overload{
         [&](const attribute_extractor& lhs, const data& d) -> result_type {
           if (lhs.attr == atom::timestamp_v) {
-            auto pred = [](auto& field) {
+            auto pred = [](auto& field, auto&) {
               return has_attribute(field.type, "timestamp");
             };
             return search(pred);
@@ -203,34 +260,38 @@ std::vector<uuid> meta_index::lookup(const expression& expr) const {
             // We don't have to look into the synopses for type queries, just
             // at the layout names.
             result_type result;
-            for (auto& [part_id, part_syn] : synopses_) {
-              for (auto& pair : part_syn.field_synopses_) {
-                // TODO: provide an overload for view of evaluate() so that
-                // we can use string_view here. Fortunately type names are
-                // short, so we're probably not hitting the allocator due to
-                // SSO.
-                auto type_name = data{pair.first.layout_name};
-                if (evaluate(type_name, x.op, d)) {
+            for (auto& [field, column] : columns_) {
+              // TODO: provide an overload for view of evaluate() so that
+              // we can use string_view here. Fortunately type names are
+              // short, so we're probably not hitting the allocator due to
+              // SSO.
+              auto type_name = data{field.layout_name};
+              if (evaluate(type_name, x.op, d))
+                for (auto& [part_id, _] : column.synopses)
                   result.push_back(part_id);
-                  break;
-                }
-              }
             }
+            for (auto& [part_id, layout_name] : pending_)
+              if (layout_name.empty() || evaluate(data{layout_name}, x.op, d))
+                result.push_back(part_id);
             // Re-establish potentially violated invariant.
             std::sort(result.begin(), result.end());
+            result.erase(std::unique(result.begin(), result.end()),
+                         result.end());
             return result;
           }
           VAST_WARNING(this, "cannot process attribute extractor:", lhs.attr);
           return all_partitions();
         },
         [&](const field_extractor& lhs, const data&) -> result_type {
-          auto pred = [&](auto& field) {
-            return detail::ends_with(field.fqn(), lhs.field);
+          auto pred = [&](auto&, auto& fqn) {
+            return detail::ends_with(fqn, lhs.field);
           };
           return search(pred);
         },
         [&](const type_extractor& lhs, const data&) -> result_type {
-          auto pred = [&](auto& field) { return field.type == lhs.type; };
+          auto pred = [&](auto& field, auto&) {
+            return field.type == lhs.type;
+          };
           return search(pred);
         },
         [&](const auto&, const auto&) -> result_type {
@@ -36,10 +36,80 @@
 
 #include <flatbuffers/base.h> // FLATBUFFERS_MAX_BUFFER_SIZE
 
+#include <functional>
+
 namespace vast {
 
 using namespace binary_byte_literals;
 
+namespace {
+
+/// Dispatches to the version-specific FlatBuffers table of a segment.
+/// @param chunk The chunk holding the segment data.
+/// @param f The function to invoke with the segment table.
+/// @pre `chunk` holds a segment of a supported version.
+template <class F>
+auto visit(const chunk_ptr& chunk, F&& f) {
+  auto segment = fbs::GetSegment(chunk->data());
+  if (auto segment_v0 = segment->segment_as_v0())
+    return std::invoke(std::forward<F>(f), *segment_v0);
+  if (auto segment_v1 = segment->segment_as_v1())
+    return std::invoke(std::forward<F>(f), *segment_v1);
+  auto segment_v2 = segment->segment_as_v2();
+  VAST_ASSERT(segment_v2);
+  return std::invoke(std::forward<F>(f), *segment_v2);
+}
+
+/// @returns The bytes that a slice occupies in its segment.
+span<const byte>
+slice_bytes(const fbs::FlatTableSlice& flat_slice, const chunk_ptr&) {
+  return {reinterpret_cast<const byte*>(flat_slice.data()->data()),
+          flat_slice.data()->size()};
+}
+
+/// @returns The bytes that a slice occupies in its segment.
+span<const byte> slice_bytes(const fbs::CompressedTableSlice& compressed_slice,
+                             const chunk_ptr&) {
+  return {reinterpret_cast<const byte*>(compressed_slice.data()->data()),
+          compressed_slice.data()->size()};
+}
+
+/// @returns The bytes that a slice occupies in its segment, or an empty span
+///          if the extent lies outside of the segment.
+span<const byte>
+slice_bytes(const fbs::extent::v0& extent, const chunk_ptr& chunk) {
+  if (extent.offset() > chunk->size()
+      || extent.size() > chunk->size() - extent.offset())
+    return {};
+  return as_bytes(chunk).subspan(extent.offset(), extent.size());
+}
+
+/// Converts a slice stored in a segment into a table slice.
+table_slice make_table_slice(const fbs::FlatTableSlice& flat_slice,
+                             const chunk_ptr& chunk) {
+  return table_slice{flat_slice, chunk, table_slice::verify::yes};
+}
+
+/// Converts a slice stored in a segment into a table slice. This decompresses
+/// the slice into a new chunk that does not share the segment's lifetime.
+table_slice make_table_slice(const fbs::CompressedTableSlice& compressed_slice,
+                             const chunk_ptr&) {
+  return table_slice{compressed_slice, table_slice::verify::yes};
+}
+
+/// Converts a slice stored in a segment into a table slice. This decompresses
+/// the slice into a new chunk that does not share the segment's lifetime.
+table_slice
+make_table_slice(const fbs::extent::v0& extent, const chunk_ptr& chunk) {
+  auto bytes = slice_bytes(extent, chunk);
+  if (bytes.empty())
+    return {};
+  return decompress(bytes, extent.uncompressed_size(),
+                    table_slice::verify::yes);
+}
+
+} // namespace
+
 caf::expected<segment> segment::make(chunk_ptr chunk) {
   VAST_ASSERT(chunk != nullptr);
   // FlatBuffers <= 1.11 does not correctly use '::flatbuffers::soffset_t' over
@@ -51,35 +121,51 @@ caf::expected<segment> segment::make(chunk_ptr chunk) {
                       FLATBUFFERS_MAX_BUFFER_SIZE);
   auto s = fbs::GetSegment(chunk->data());
   VAST_ASSERT(s); // `GetSegment` is just a cast, so this cant become null.
-  if (s->segment_type() != fbs::segment::Segment::v0)
+  if (s->segment_type() != fbs::segment::Segment::v0
+      && s->segment_type() != fbs::segment::Segment::v1
+      && s->segment_type() != fbs::segment::Segment::v2)
     return make_error(ec::format_error, "unsupported segment version");
   return segment{std::move(chunk)};
 }
 
 uuid segment::id() const {
-  auto segment = fbs::GetSegment(chunk_->data());
-  auto segment_v0 = segment->segment_as_v0();
-  uuid result;
-  if (auto error = unpack(*segment_v0->uuid(), result))
-    VAST_ERROR_ANON("couldnt get uuid from segment:", error);
-  return result;
+  return visit(chunk_, [](const auto& segment) {
+    uuid result;
+    if (auto error = unpack(*segment.uuid(), result))
+      VAST_ERROR_ANON("couldnt get uuid from segment:", error);
+    return result;
+  });
 }
 
 vast::ids segment::ids() const {
-  vast::ids result;
-  auto segment = fbs::GetSegment(chunk_->data());
-  auto segment_v0 = segment->segment_as_v0();
-  for (auto interval : *segment_v0->ids()) {
-    result.append_bits(false, interval->begin() - result.size());
-    result.append_bits(true, interval->end() - interval->begin());
-  }
-  return result;
+  return visit(chunk_, [](const auto& segment) {
+    vast::ids result;
+    for (auto interval : *segment.ids()) {
+      result.append_bits(false, interval->begin() - result.size());
+      result.append_bits(true, interval->end() - interval->begin());
+    }
+    return result;
+  });
+}
+
+const vast::ids& segment::tombstones() const {
+  return tombstones_;
+}
+
+void segment::tombstones(vast::ids xs) {
+  tombstones_ = std::move(xs);
 }
 
 size_t segment::num_slices() const {
-  auto segment = fbs::GetSegment(chunk_->data());
-  auto segment_v0 = segment->segment_as_v0();
-  return segment_v0->slices()->size();
+  return visit(chunk_, [](const auto& segment) -> size_t {
+    return segment.slices()->size();
+  });
+}
+
+uint64_t segment::num_events() const {
+  return visit(chunk_, [](const auto& segment) -> uint64_t {
+    return segment.events();
+  });
 }
 
 chunk_ptr segment::chunk() const {
@@ -88,38 +174,75 @@ chunk_ptr segment::chunk() const {
 
 caf::expected<std::vector<table_slice>>
 segment::lookup(const vast::ids& xs) const {
-  std::vector<table_slice> result;
-  auto segment = fbs::GetSegment(chunk_->data())->segment_as_v0();
-  if (!segment)
-    return make_error(ec::format_error, "invalid segment version");
-  VAST_ASSERT(segment->ids()->size() == segment->slices()->size());
-  auto f = [&](const auto& zip) noexcept {
-    auto&& interval = std::get<0>(zip);
-    return std::pair{interval->begin(), interval->end()};
-  };
-  auto g = [&](const auto& zip) {
-    auto&& [interval, flat_slice] = zip;
-    auto slice = table_slice{*flat_slice, chunk_, table_slice::verify::yes};
-    slice.offset(interval->begin());
-    VAST_ASSERT(slice.offset() == interval->begin());
-    VAST_ASSERT(slice.offset() + slice.rows() == interval->end());
-    VAST_DEBUG(this, "returns slice from lookup:", to_string(slice));
-    result.push_back(std::move(slice));
-    return caf::none;
-  };
-  // TODO: We cannot iterate over `*segment->ids()` and `*segment->slices()`
-  // directly here, because the `flatbuffers::Vector<Offset<T>>` iterator
-  // dereferences to a temporary pointer. This works for normal iteration, but
-  // the `detail::zip` adapter tries to take the address of the pointer, which
-  // cannot work. We could improve this by adding a `select_with` overload that
-  // iterates over multiple ranges in lockstep.
-  auto intervals = std::vector(segment->ids()->begin(), segment->ids()->end());
-  auto flat_slices
-    = std::vector(segment->slices()->begin(), segment->slices()->end());
-  auto zipped = detail::zip(intervals, flat_slices);
-  if (auto error = select_with(xs, zipped.begin(), zipped.end(), f, g))
-    return error;
-  return result;
+  return visit(chunk_, [&](const auto& segment)
+                 -> caf::expected<std::vector<table_slice>> {
+    std::vector<table_slice> result;
+    VAST_ASSERT(segment.ids()->size() == segment.slices()->size());
+    // Erased events must not show up in the result, so we skip slices with no
+    // live events and cut the remaining ones around the tombstones.
+    auto selection = tombstones_.empty() ? xs : xs - tombstones_;
+    auto keep_mask = ~tombstones_;
+    auto f = [&](const auto& zip) noexcept {
+      auto&& interval = std::get<0>(zip);
+      return std::pair{interval->begin(), interval->end()};
+    };
+    // We only materialize the slices that the selection hits, which means
+    // that compressed slices get decompressed lazily.
+    auto g = [&](const auto& zip) -> caf::error {
+      auto&& [interval, flat_slice] = zip;
+      auto slice = make_table_slice(*flat_slice, chunk_);
+      if (slice.encoding() == table_slice::encoding::none)
+        return make_error(ec::format_error, "failed to read table slice "
+                                            "from segment");
+      slice.offset(interval->begin());
+      VAST_ASSERT(slice.offset() == interval->begin());
+      VAST_ASSERT(slice.offset() + slice.rows() == interval->end());
+      VAST_DEBUG(this, "returns slice from lookup:", to_string(slice));
+      if (tombstones_.empty() || interval->begin() >= tombstones_.size()) {
+        result.push_back(std::move(slice));
+        return caf::none;
+      }
+      if (keep_mask.size() < interval->end())
+        keep_mask.append_bits(true, interval->end() - keep_mask.size());
+      select(result, slice, keep_mask);
+      return caf::none;
+    };
+    // TODO: We cannot iterate over `*segment.ids()` and `*segment.slices()`
+    // directly here, because the `flatbuffers::Vector<Offset<T>>` iterator
+    // dereferences to a temporary pointer. This works for normal iteration,
+    // but the `detail::zip` adapter tries to take the address of the pointer,
+    // which cannot work. We could improve this by adding a `select_with`
+    // overload that iterates over multiple ranges in lockstep.
+    auto intervals = std::vector(segment.ids()->begin(), segment.ids()->end());
+    auto flat_slices
+      = std::vector(segment.slices()->begin(), segment.slices()->end());
+    auto zipped = detail::zip(intervals, flat_slices);
+    if (auto error
+        = select_with(selection, zipped.begin(), zipped.end(), f, g))
+      return error;
+    return result;
+  });
+}
+
+void segment::prefetch(const vast::ids& xs) const {
+  visit(chunk_, [&](const auto& segment) {
+    auto f = [&](const auto& zip) noexcept {
+      auto&& interval = std::get<0>(zip);
+      return std::pair{interval->begin(), interval->end()};
+    };
+    auto g = [&](const auto& zip) noexcept {
+      auto bytes = slice_bytes(*std::get<1>(zip), chunk_);
+      if (!bytes.empty())
+        chunk_->prefetch(bytes.data() - chunk_->data(), bytes.size());
+      return caf::none;
+    };
+    auto intervals = std::vector(segment.ids()->begin(), segment.ids()->end());
+    auto flat_slices
+      = std::vector(segment.slices()->begin(), segment.slices()->end());
+    auto zipped = detail::zip(intervals, flat_slices);
+    if (auto error = select_with(xs, zipped.begin(), zipped.end(), f, g))
+      VAST_DEBUG(this, "failed to prefetch table slices:", error);
+  });
 }
 
 segment::segment(chunk_ptr chk) : chunk_{std::move(chk)} {
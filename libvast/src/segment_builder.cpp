@@ -15,6 +15,7 @@
 
 #include "vast/detail/assert.hpp"
 #include "vast/detail/byte_swap.hpp"
+#include "vast/detail/lz4.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/error.hpp"
 #include "vast/fbs/segment.hpp"
@@ -37,9 +38,18 @@ segment_builder::segment_builder(size_t initial_buffer_size)
 caf::error segment_builder::add(table_slice x) {
   if (x.offset() < min_table_slice_offset_)
     return make_error(ec::unspecified, "slice offsets not increasing");
-  auto bytes = fbs::pack_bytes(builder_, x);
-  auto slice = fbs::CreateFlatTableSlice(builder_, bytes);
-  flat_slices_.push_back(slice);
+  auto bytes = as_bytes(x);
+  compression_buffer_.resize(detail::lz4::compress_bound(bytes.size()));
+  auto compressed_size
+    = detail::lz4::compress(bytes, as_writeable_bytes(compression_buffer_));
+  if (compressed_size == 0)
+    return make_error(ec::unspecified, "failed to compress table slice");
+  auto data = builder_.CreateVector(
+    reinterpret_cast<const uint8_t*>(compression_buffer_.data()),
+    compressed_size);
+  auto slice = fbs::CreateCompressedTableSlice(builder_, bytes.size(), data);
+  compressed_slices_.push_back(slice);
+  table_slice_bytes_ += bytes.size();
   intervals_.emplace_back(x.offset(), x.offset() + x.rows());
   num_events_ += x.rows();
   slices_.push_back(x);
@@ -47,18 +57,18 @@ caf::error segment_builder::add(table_slice x) {
 }
 
 segment segment_builder::finish() {
-  auto table_slices_offset = builder_.CreateVector(flat_slices_);
+  auto table_slices_offset = builder_.CreateVector(compressed_slices_);
   auto uuid_offset = pack(builder_, id_);
   auto ids_offset = builder_.CreateVectorOfStructs(intervals_);
-  fbs::segment::v0Builder segment_v0_builder{builder_};
-  segment_v0_builder.add_slices(table_slices_offset);
-  segment_v0_builder.add_uuid(*uuid_offset);
-  segment_v0_builder.add_ids(ids_offset);
-  segment_v0_builder.add_events(num_events_);
-  auto segment_v0_offset = segment_v0_builder.Finish();
+  fbs::segment::v1Builder segment_v1_builder{builder_};
+  segment_v1_builder.add_slices(table_slices_offset);
+  segment_v1_builder.add_uuid(*uuid_offset);
+  segment_v1_builder.add_ids(ids_offset);
+  segment_v1_builder.add_events(num_events_);
+  auto segment_v1_offset = segment_v1_builder.Finish();
   fbs::SegmentBuilder segment_builder{builder_};
-  segment_builder.add_segment_type(vast::fbs::segment::Segment::v0);
-  segment_builder.add_segment(segment_v0_offset.Union());
+  segment_builder.add_segment_type(vast::fbs::segment::Segment::v1);
+  segment_builder.add_segment(segment_v1_offset.Union());
   auto segment_offset = segment_builder.Finish();
   fbs::FinishSegmentBuffer(builder_, segment_offset);
   auto chk = fbs::release(builder_);
@@ -95,7 +105,7 @@ vast::ids segment_builder::ids() const {
 }
 
 size_t segment_builder::table_slice_bytes() const {
-  return builder_.GetSize();
+  return table_slice_bytes_;
 }
 
 const std::vector<table_slice>& segment_builder::table_slices() const {
@@ -107,9 +117,10 @@ void segment_builder::reset() {
   min_table_slice_offset_ = 0;
   num_events_ = 0;
   builder_.Clear();
-  flat_slices_.clear();
+  compressed_slices_.clear();
   intervals_.clear();
   slices_.clear();
+  table_slice_bytes_ = 0;
 }
 
 } // namespace vast
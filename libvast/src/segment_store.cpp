@@ -18,42 +18,143 @@
 #include "vast/concept/printable/vast/error.hpp"
 #include "vast/concept/printable/vast/filesystem.hpp"
 #include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/concept/parseable/vast/uuid.hpp"
+#include "vast/detail/deserialize.hpp"
 #include "vast/detail/overload.hpp"
+#include "vast/detail/serialize.hpp"
 #include "vast/directory.hpp"
 #include "vast/error.hpp"
 #include "vast/fbs/segment.hpp"
+#include "vast/fbs/segment_catalog.hpp"
 #include "vast/fbs/utils.hpp"
 #include "vast/ids.hpp"
+#include "vast/io/read.hpp"
+#include "vast/io/save.hpp"
+#include "vast/io/write.hpp"
 #include "vast/logger.hpp"
+#include "vast/span.hpp"
 #include "vast/table_slice.hpp"
 
 #include <caf/config_value.hpp>
 #include <caf/dictionary.hpp>
 #include <caf/settings.hpp>
 
+#include <flatbuffers/flatbuffers.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <type_traits>
+
 namespace vast {
 
+namespace {
+
+/// Summarizes a segment for the catalog by inspecting its header only.
+caf::expected<std::pair<uuid, segment_store::catalog_entry>>
+summarize(const chunk& chk) {
+  // We don't verify the segment here, since doing that would access
+  // most of the pages of the mapping and effectively cause us to
+  // read of the whole archive contents from disk. When the database
+  // approaches the terabyte range, this becomes prohibitively expensive.
+  // (see also tdhtf/ch1935)
+  // TODO: Create a library function that performs verification on a
+  // subset of the fields of a flatbuffer table.
+  auto s = fbs::GetSegment(chk.data());
+  if (s == nullptr)
+    return make_error(ec::format_error, "segment integrity check failed");
+  auto f = [&](const auto& segment)
+    -> caf::expected<std::pair<uuid, segment_store::catalog_entry>> {
+    auto result = std::pair<uuid, segment_store::catalog_entry>{};
+    if (auto error = unpack(*segment.uuid(), result.first))
+      return error;
+    for (auto interval : *segment.ids())
+      result.second.intervals.emplace_back(interval->begin(), interval->end());
+    result.second.events = segment.events();
+    result.second.size = chk.size();
+    using segment_type = std::decay_t<decltype(segment)>;
+    if constexpr (std::is_same_v<segment_type, fbs::segment::v0>) {
+      // The first version stores table slices uncompressed.
+      result.second.table_slice_bytes = chk.size();
+    } else if (segment.slices() != nullptr) {
+      for (auto slice : *segment.slices())
+        result.second.table_slice_bytes += slice->uncompressed_size();
+    }
+    return result;
+  };
+  if (auto s0 = s->segment_as_v0())
+    return f(*s0);
+  if (auto s1 = s->segment_as_v1())
+    return f(*s1);
+  if (auto s2 = s->segment_as_v2())
+    return f(*s2);
+  return make_error(ec::format_error, "unknown segment version");
+}
+
+/// Packs the catalog entry of a segment.
+caf::expected<flatbuffers::Offset<fbs::segment_summary::v0>>
+pack(flatbuffers::FlatBufferBuilder& builder, const uuid& segment_id,
+     const segment_store::catalog_entry& entry) {
+  auto uuid_offset = pack(builder, segment_id);
+  if (!uuid_offset)
+    return uuid_offset.error();
+  std::vector<fbs::interval::v0> intervals;
+  intervals.reserve(entry.intervals.size());
+  for (auto [first, last] : entry.intervals)
+    intervals.emplace_back(first, last);
+  auto ids_offset = builder.CreateVectorOfStructs(intervals);
+  fbs::segment_summary::v0Builder summary_builder{builder};
+  summary_builder.add_uuid(*uuid_offset);
+  summary_builder.add_ids(ids_offset);
+  summary_builder.add_events(entry.events);
+  summary_builder.add_size(entry.size);
+  summary_builder.add_table_slice_bytes(entry.table_slice_bytes);
+  return summary_builder.Finish();
+}
+
+/// Unpacks the catalog entry of a segment.
+caf::error unpack(const fbs::segment_summary::v0& summary, uuid& segment_id,
+                  segment_store::catalog_entry& entry) {
+  if (summary.uuid() == nullptr || summary.ids() == nullptr)
+    return make_error(ec::format_error, "incomplete segment summary");
+  if (auto err = unpack(*summary.uuid(), segment_id))
+    return err;
+  entry.intervals.clear();
+  for (auto interval : *summary.ids())
+    entry.intervals.emplace_back(interval->begin(), interval->end());
+  entry.events = summary.events();
+  entry.size = summary.size();
+  entry.table_slice_bytes = summary.table_slice_bytes();
+  // Catalogs of earlier versions lack the size of the table slices.
+  if (entry.events > 0 && entry.table_slice_bytes == 0)
+    return make_error(ec::format_error, "segment summary lacks the size of "
+                                        "the table slices");
+  return caf::none;
+}
+
+} // namespace
+
 // TODO: return expected<segment_store_ptr> for better error propagation.
 segment_store_ptr segment_store::make(path dir, size_t max_segment_size,
-                                      size_t in_memory_segments) {
+                                      size_t cache_size,
+                                      size_t read_ahead) {
   VAST_TRACE(VAST_ARG(dir), VAST_ARG(max_segment_size),
-             VAST_ARG(in_memory_segments));
+             VAST_ARG(cache_size), VAST_ARG(read_ahead));
   VAST_ASSERT(max_segment_size > 0);
-  auto result = segment_store_ptr{
-    new segment_store{std::move(dir), max_segment_size, in_memory_segments}};
+  auto result = segment_store_ptr{new segment_store{
+    std::move(dir), max_segment_size, cache_size, read_ahead}};
   if (auto err = result->register_segments())
     return nullptr;
   return result;
 }
 
 segment_store::segment_store(path dir, uint64_t max_segment_size,
-                             size_t in_memory_segments)
+                             size_t cache_size, size_t read_ahead)
   : dir_{std::move(dir)},
     max_segment_size_{max_segment_size},
-    cache_{in_memory_segments},
-    // TODO: Make vast.max-segment-size a hard instead of a soft limit, such
-    // that we do not need to multiplay with an arbitrary value above 1 here.
-    builder_{detail::narrow_cast<size_t>(max_segment_size * 1.1)} {
+    read_ahead_{read_ahead},
+    cache_{cache_size,
+           [](const uuid&, const segment& x) { return x.chunk()->size(); }},
+    writer_{active_path()} {
   // nop
 }
 
@@ -63,12 +164,12 @@ segment_store::~segment_store() {
 
 caf::error segment_store::put(table_slice xs) {
   VAST_TRACE(VAST_ARG(xs));
-  if (!segments_.inject(xs.offset(), xs.offset() + xs.rows(), builder_.id()))
+  if (!segments_.inject(xs.offset(), xs.offset() + xs.rows(), writer_.id()))
     return make_error(ec::unspecified, "failed to update range_map");
   num_events_ += xs.rows();
-  if (auto error = builder_.add(std::move(xs)))
+  if (auto error = writer_.add(std::move(xs)))
     return error;
-  if (builder_.table_slice_bytes() < max_segment_size_)
+  if (writer_.table_slice_bytes() < max_segment_size_)
     return caf::none;
   // We have exceeded our maximum segment size and now finish.
   return flush();
@@ -102,15 +203,36 @@ std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
       if (first_ == candidates_.end())
         return caf::no_error;
       auto& cand = *first_++;
-      if (cand == store_.builder_.id()) {
+      read_ahead();
+      if (cand == store_.writer_.id()) {
         VAST_DEBUG(this, "looks into the active segement", cand);
-        return store_.builder_.lookup(xs_);
+        return store_.writer_.lookup(xs_);
+      }
+      // An erasure since we selected the candidates may have dropped the
+      // segment entirely.
+      if (store_.catalog_.count(cand) == 0) {
+        VAST_DEBUG(this, "skips dropped segment", cand);
+        return std::vector<table_slice>{};
       }
       auto i = store_.cache_.find(cand);
       if (i != store_.cache_.end()) {
         VAST_DEBUG(this, "got cache hit for segment", cand);
         return i->second.lookup(xs_);
       }
+      auto j = std::find_if(prefetched_.begin(), prefetched_.end(),
+                            [&](const auto& x) { return x.first == cand; });
+      if (j != prefetched_.end()) {
+        VAST_DEBUG(this, "got prefetched segment", cand);
+        auto s = std::move(j->second);
+        prefetched_.erase(j);
+        // Erasures since prefetching only updated the tombstones of the
+        // store, so we need to apply them to our copy.
+        if (auto t = store_.tombstones_.find(cand);
+            t != store_.tombstones_.end())
+          s.tombstones(t->second);
+        store_.cache_.emplace(cand, s);
+        return s.lookup(xs_);
+      }
       VAST_DEBUG(this, "got cache miss for segment", cand);
       auto s = store_.load_segment(cand);
       if (!s)
@@ -119,10 +241,38 @@ std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
       return s->lookup(xs_);
     }
 
+    /// Advises the operating system to read the relevant parts of the next
+    /// few candidate segments in the background while we process the current
+    /// one. Memory-mapping a segment is cheap, so we keep the mappings of the
+    /// prefetched segments around outside of the cache until we reach them.
+    void read_ahead() {
+      auto remaining = static_cast<size_t>(candidates_.end() - first_);
+      auto last = first_ + std::min(remaining, store_.read_ahead_);
+      if (prefetch_first_ < first_)
+        prefetch_first_ = first_;
+      for (; prefetch_first_ < last; ++prefetch_first_) {
+        auto& cand = *prefetch_first_;
+        if (cand == store_.writer_.id())
+          continue;
+        if (auto i = store_.cache_.peek(cand); i != store_.cache_.end()) {
+          i->second.prefetch(xs_);
+          continue;
+        }
+        // Errors surface once we reach the candidate.
+        if (auto s = store_.load_segment(cand)) {
+          VAST_DEBUG(this, "prefetches segment", cand);
+          s->prefetch(xs_);
+          prefetched_.emplace_back(cand, std::move(*s));
+        }
+      }
+    }
+
     const segment_store& store_;
     ids xs_;
     std::vector<uuid> candidates_;
     uuid_iterator first_ = candidates_.begin();
+    uuid_iterator prefetch_first_ = candidates_.begin();
+    std::vector<std::pair<uuid, segment>> prefetched_;
     caf::expected<std::vector<table_slice>> buffer_{caf::no_error};
     std::vector<table_slice>::iterator it_;
   };
@@ -137,7 +287,7 @@ std::unique_ptr<store::lookup> segment_store::extract(const ids& xs) const {
   }
   VAST_DEBUG(this, "processes", candidates.size(), "candidates");
   std::partition(candidates.begin(), candidates.end(), [&](const auto& id) {
-    return id == builder_.id() || cache_.find(id) != cache_.end();
+    return id == writer_.id() || cache_.contains(id);
   });
   return std::make_unique<lookup>(*this, std::move(xs), std::move(candidates));
 }
@@ -151,115 +301,116 @@ caf::error segment_store::erase(const ids& xs) {
     return err;
   if (candidates.empty())
     return caf::none;
-  auto is_subset_of_xs = [&](const ids& ys) { return is_subset(ys, xs); };
   // Counts number of total erased events for user-facing output.
   uint64_t erased_events = 0;
   // Implements the body of the for-loop below. This lambda must be generic,
-  // because the argument is either a `segment` or a `segment_builder`. This
+  // because the argument is either a `segment` or a `segment_writer`. This
   // algorithm removes all events with IDs in `xs` from a segment. For existing
-  // segments, we create a new segment that contains all table slices that
-  // remain after erasing `xs` from the input segment. For builders, we update
-  // the builder directly by replacing the set of table slices. In any case, we
-  // have to update `segments_` to point to the new segment ID.
+  // segments, we mark the erased events with tombstones, and schedule a
+  // rewrite of the segment that contains only the remaining events once most
+  // events of the segment are dead. For the writer, we update the writer
+  // directly by replacing the set of table slices. In any case, we have to
+  // update `segments_` to point to the new segment ID.
   auto impl = [&](auto& seg) {
     auto segment_id = seg.id();
     // Get all slices in the segment and generate a new segment that contains
     // only what's left after dropping the selection.
     auto segment_ids = seg.ids();
+    // The IDs of all erased events in the segment, including the ones that
+    // previous erasures marked with tombstones.
+    auto dead = xs & segment_ids;
+    if constexpr (std::is_same_v<decltype(seg), segment&>)
+      dead |= seg.tombstones();
     // Check whether we can drop the entire segment.
-    if (is_subset_of_xs(segment_ids)) {
+    if (is_subset(segment_ids, dead)) {
       erased_events += drop(seg);
       return;
     }
-    std::vector<table_slice> slices;
-    if (auto maybe_slices = seg.lookup(segment_ids)) {
-      slices = std::move(*maybe_slices);
-      if (slices.empty()) {
-        VAST_WARNING(this, "got no slices after lookup for segment", segment_id,
-                     "=> erases entire segment!");
+    if constexpr (std::is_same_v<decltype(seg), segment&>) {
+      auto num_dead = rank(dead);
+      auto num_erased = num_dead - rank(seg.tombstones());
+      if (num_erased == 0)
+        return;
+      VAST_VERBOSE(this, "adds", num_erased, "tombstones to segment",
+                   segment_id);
+      if (auto err = save_tombstones(segment_id, dead))
+        VAST_ERROR(this, "failed to persist tombstones for segment",
+                   segment_id, render(err));
+      seg.tombstones(dead);
+      tombstones_[segment_id] = std::move(dead);
+      erased_events += num_erased;
+      // Rewriting a segment reads and writes all of its remaining events, so
+      // we leave that to the caller once most events of the segment are dead.
+      if (num_dead * 2 > rank(segment_ids)
+          && rewrites_.insert(segment_id).second)
+        pending_rewrites_.push_back(segment_id);
+    } else {
+      std::vector<table_slice> slices;
+      if (auto maybe_slices = seg.lookup(segment_ids)) {
+        slices = std::move(*maybe_slices);
+        if (slices.empty()) {
+          VAST_WARNING(this, "got no slices after lookup for segment",
+                       segment_id, "=> erases entire segment!");
+          erased_events += drop(seg);
+          return;
+        }
+      } else {
+        VAST_WARNING(this, "was unable to get table slice for segment",
+                     segment_id, "=> erases entire segment!");
         erased_events += drop(seg);
         return;
       }
-    } else {
-      VAST_WARNING(this, "was unable to get table slice for segment",
-                   segment_id, "=> erases entire segment!");
-      erased_events += drop(seg);
-      return;
-    }
-    VAST_ASSERT(slices.size() > 0);
-    // We have IDs we wish to delete in `xs`, but we need a bitmap of what to
-    // keep for `select` in order to fill `new_slices` with the table slices
-    // that remain after dropping all deleted IDs from the segment.
-    auto keep_mask = ~xs;
-    std::vector<table_slice> new_slices;
-    for (auto& slice : slices) {
-      // Expand keep_mask on-the-fly if needed.
-      auto max_id = slice.offset() + slice.rows();
-      if (keep_mask.size() < max_id)
-        keep_mask.append_bits(true, max_id - keep_mask.size());
-      size_t new_slices_size_before = new_slices.size();
-      select(new_slices, slice, keep_mask);
-      size_t remaining_rows = 0;
-      for (size_t i = new_slices_size_before; i < new_slices.size(); ++i)
-        remaining_rows += new_slices[i].rows();
-      erased_events += slice.rows() - remaining_rows;
-    }
-    if (new_slices.empty()) {
-      VAST_WARNING(this, "was unable to generate any new slice for segment",
-                   segment_id, "=> erases entire segment!");
-      erased_events += drop(seg);
-      return;
-    }
-    VAST_VERBOSE(this, "shrinks segment", segment_id, "from", slices.size(),
-                 "to", new_slices.size(), "slices");
-    // Remove stale state.
-    segments_.erase_value(segment_id);
-    // Estimate the size of the new segment.
-    auto size_estimate = size_t{};
-    for (const auto& slice : new_slices)
-      size_estimate += as_bytes(slice).size();
-    size_estimate *= 1.1;
-    // Create a new segment from the remaining slices.
-    segment_builder tmp_builder{size_estimate};
-    segment_builder* builder = &tmp_builder;
-    if constexpr (std::is_same_v<decltype(seg), segment_builder&>) {
-      // If `update` got called with a builder then we simply use that by
-      // resetting it and filling it with new content. Otherwise, we fill
-      // `tmp_builder` instead and replace the the segment `seg` in the next
-      // `if constexpr` block.
+      VAST_ASSERT(slices.size() > 0);
+      // We have IDs we wish to delete in `dead`, but we need a bitmap of what
+      // to keep for `select` in order to fill `new_slices` with the table
+      // slices that remain after dropping all deleted IDs from the segment.
+      auto keep_mask = ~dead;
+      std::vector<table_slice> new_slices;
+      for (auto& slice : slices) {
+        // Expand keep_mask on-the-fly if needed.
+        auto max_id = slice.offset() + slice.rows();
+        if (keep_mask.size() < max_id)
+          keep_mask.append_bits(true, max_id - keep_mask.size());
+        size_t new_slices_size_before = new_slices.size();
+        select(new_slices, slice, keep_mask);
+        size_t remaining_rows = 0;
+        for (size_t i = new_slices_size_before; i < new_slices.size(); ++i)
+          remaining_rows += new_slices[i].rows();
+        erased_events += slice.rows() - remaining_rows;
+      }
+      if (new_slices.empty()) {
+        VAST_WARNING(this, "was unable to generate any new slice for segment",
+                     segment_id, "=> erases entire segment!");
+        erased_events += drop(seg);
+        return;
+      }
+      VAST_VERBOSE(this, "shrinks segment", segment_id, "from", slices.size(),
+                   "to", new_slices.size(), "slices");
+      // Remove stale state.
+      segments_.erase_value(segment_id);
+      // We simply reset the writer and refill it with the remaining slices,
+      // since we can continue filling the active segment afterwards.
       seg.reset();
-      builder = &seg;
-    }
-    for (auto& slice : new_slices) {
-      if (auto err = builder->add(slice)) {
-        VAST_ERROR(this, "failed to add slice to builder:", err);
-      } else if (!segments_.inject(slice.offset(),
-                                   slice.offset() + slice.rows(),
-                                   builder->id()))
-        VAST_ERROR(this, "failed to update range_map");
-    }
-    // Flush the new segment and remove the previous segment.
-    if constexpr (std::is_same_v<decltype(seg), segment&>) {
-      auto new_segment = builder->finish();
-      auto filename = segment_path() / to_string(new_segment.id());
-      if (auto err = write(filename, new_segment.chunk()))
-        VAST_ERROR(this, "failed to persist the new segment");
-      auto stale_filename = segment_path() / to_string(segment_id);
-      // Schedule deletion of the segment file when releasing the chunk.
-      seg.chunk()->add_deletion_step([=]() noexcept { rm(stale_filename); });
+      for (auto& slice : new_slices) {
+        if (auto err = seg.add(slice)) {
+          VAST_ERROR(this, "failed to add slice to builder:", err);
+        } else if (!segments_.inject(slice.offset(),
+                                     slice.offset() + slice.rows(),
+                                     seg.id()))
+          VAST_ERROR(this, "failed to update range_map");
+      }
     }
-    // else: nothing to do, since we can continue filling the active segment.
   };
   // Iterate affected segments.
   for (auto& candidate : candidates) {
-    auto j = cache_.find(candidate);
+    auto j = cache_.peek(candidate);
     if (j != cache_.end()) {
       VAST_DEBUG(this, "erases from the cached segement", candidate);
       impl(j->second);
       cache_.erase(j);
-    } else if (candidate == builder_.id()) {
+    } else if (candidate == writer_.id()) {
       VAST_DEBUG(this, "erases from the active segement", candidate);
-      impl(builder_);
+      impl(writer_);
     } else if (auto s = load_segment(candidate)) {
       VAST_DEBUG(this, "erases from the segement", candidate);
       impl(*s);
@@ -284,14 +435,14 @@ caf::expected<std::vector<table_slice>> segment_store::get(const ids& xs) {
   std::vector<table_slice> result;
   VAST_DEBUG(this, "processes", candidates.size(), "candidates");
   std::partition(candidates.begin(), candidates.end(), [&](const auto& id) {
-    return id == builder_.id() || cache_.find(id) != cache_.end();
+    return id == writer_.id() || cache_.contains(id);
   });
   for (auto cand = candidates.begin(); cand != candidates.end(); ++cand) {
     auto& id = *cand;
     caf::expected<std::vector<table_slice>> slices{caf::no_error};
-    if (id == builder_.id()) {
+    if (id == writer_.id()) {
       VAST_DEBUG(this, "looks into the active segement", id);
-      slices = builder_.lookup(xs);
+      slices = writer_.lookup(xs);
     } else {
       auto i = cache_.find(id);
       if (i == cache_.end()) {
@@ -317,42 +468,95 @@ caf::expected<std::vector<table_slice>> segment_store::get(const ids& xs) {
 caf::error segment_store::flush() {
   if (!dirty())
     return caf::none;
-  VAST_DEBUG(this, "finishes current builder");
-  auto seg = builder_.finish();
-  auto filename = segment_path() / to_string(seg.id());
-  if (auto err = write(filename, seg.chunk()))
-    return err;
+  VAST_DEBUG(this, "finishes current segment");
+  auto filename = segment_path() / to_string(writer_.id());
+  auto seg = writer_.finish(filename);
+  if (!seg)
+    return seg.error();
+  if (auto summary = summarize(*seg->chunk())) {
+    catalog_.insert(std::move(*summary));
+    journal_catalog(seg->id());
+  } else {
+    VAST_WARNING(this, "failed to summarize new segment:",
+                 render(summary.error()));
+  }
   // Keep new segment in the cache.
-  cache_.emplace(seg.id(), seg);
+  cache_.emplace(seg->id(), *seg);
   VAST_DEBUG(this, "wrote new segment to", filename.trim(-3));
   return caf::none;
 }
 
+caf::expected<size_t> segment_store::compact(size_t budget) {
+  auto runs = take_merges(budget);
+  size_t processed = 0;
+  for (auto run = runs.begin(); run != runs.end(); ++run) {
+    std::vector<uuid> sources;
+    std::vector<ids> applied;
+    for (auto& x : *run) {
+      sources.push_back(x.id());
+      applied.push_back(x.tombstones());
+      processed += x.chunk()->size();
+    }
+    auto result = merge(*run, rewrite_path());
+    if (!result) {
+      for (; run != runs.end(); ++run)
+        for (auto& x : *run)
+          rewrites_.erase(x.id());
+      return result.error();
+    }
+    if (auto err = finish_merge(sources, applied, *result))
+      return err;
+  }
+  return processed;
+}
+
 void segment_store::inspect_status(caf::settings& xs,
                                    system::status_verbosity v) {
   using caf::put;
   if (v >= system::status_verbosity::info) {
     put(xs, "events", num_events_);
-    auto mem = builder_.table_slice_bytes();
-    for (auto& segment : cache_)
-      mem += segment.second.chunk()->size();
-    put(xs, "memory-usage", mem);
+    // The segment under construction lives on disk, so only the cached
+    // segments contribute to the memory usage.
+    put(xs, "memory-usage", cache_.weight());
   }
   if (v >= system::status_verbosity::detailed) {
     auto& segments = put_dictionary(xs, "segments");
+    put(segments, "cache-capacity", cache_.capacity());
+    auto& statistics = put_dictionary(segments, "cache-statistics");
+    put(statistics, "hits", cache_.statistics().hits);
+    put(statistics, "misses", cache_.statistics().misses);
+    put(statistics, "evictions", cache_.statistics().evictions);
     auto& cached = put_list(segments, "cached");
     for (auto& kvp : cache_)
       cached.emplace_back(to_string(kvp.first));
     auto& current = put_dictionary(segments, "current");
-    put(current, "uuid", to_string(builder_.id()));
-    put(current, "size", builder_.table_slice_bytes());
+    put(current, "uuid", to_string(writer_.id()));
+    put(current, "size", writer_.table_slice_bytes());
   }
 }
 
 caf::error segment_store::register_segments() {
+  // Segments under construction do not survive a restart, since they lack
+  // the footer that describes their contents.
+  for (auto filename : directory{active_path()}) {
+    VAST_WARNING(this, "removes unfinished segment", filename.trim(-2));
+    rm(filename);
+  }
+  for (auto filename : directory{rewrite_path()}) {
+    VAST_WARNING(this, "removes unfinished rewrite", filename.trim(-2));
+    rm(filename);
+  }
+  recover_compaction();
+  if (auto err = load_tombstones())
+    return err;
+  if (load_catalog())
+    return caf::none;
+  // Fall back to reading every segment file to rebuild the catalog.
   for (auto filename : directory{segment_path()})
     if (auto err = register_segment(filename))
       return err;
+  if (auto err = save_catalog())
+    VAST_WARNING(this, "failed to persist segment catalog:", render(err));
   return caf::none;
 }
 
@@ -360,30 +564,203 @@ caf::error segment_store::register_segment(const path& filename) {
   auto chk = chunk::mmap(filename);
   if (!chk)
     return make_error(ec::filesystem_error, "failed to mmap chunk", filename);
-  // We don't verify the segment here, since doing that would access
-  // most of the pages of the mapping and effectively cause us to
-  // read of the whole archive contents from disk. When the database
-  // approaches the terabyte range, this becomes prohibitively expensive.
-  // (see also tdhtf/ch1935)
-  // TODO: Create a library function that performs verification on a
-  // subset of the fields of a flatbuffer table.
-  auto s = fbs::GetSegment(chk->data());
-  if (s == nullptr)
-    return make_error(ec::format_error, "segment integrity check failed");
-  auto s0 = s->segment_as_v0();
-  if (!s0)
-    return make_error(ec::format_error, "unknown segment version");
-  num_events_ += s0->events();
-  uuid segment_uuid;
-  if (auto error = unpack(*s0->uuid(), segment_uuid))
-    return error;
-  VAST_DEBUG(this, "found segment", segment_uuid);
-  for (auto interval : *s0->ids())
-    if (!segments_.inject(interval->begin(), interval->end(), segment_uuid))
+  auto summary = summarize(*chk);
+  if (!summary)
+    return summary.error();
+  return register_segment(summary->first, std::move(summary->second));
+}
+
+caf::error segment_store::register_segment(const uuid& id,
+                                           catalog_entry entry) {
+  VAST_DEBUG(this, "found segment", id);
+  for (auto [first, last] : entry.intervals)
+    if (!segments_.inject(first, last, id))
       return make_error(ec::unspecified, "failed to update range_map");
+  num_events_ += entry.events;
+  if (auto i = tombstones_.find(id); i != tombstones_.end())
+    num_events_ -= rank(i->second);
+  catalog_[id] = std::move(entry);
   return caf::none;
 }
 
+bool segment_store::load_catalog() {
+  if (!exists(catalog_path())) {
+    VAST_VERBOSE(this, "found no segment catalog");
+    return false;
+  }
+  auto buffer = io::read(catalog_path());
+  if (!buffer) {
+    VAST_WARNING(this, "failed to read segment catalog:",
+                 render(buffer.error()));
+    return false;
+  }
+  auto catalog = fbs::as_flatbuffer<fbs::SegmentCatalog>(as_bytes(*buffer));
+  if (catalog == nullptr) {
+    VAST_WARNING(this, "failed to verify segment catalog");
+    return false;
+  }
+  auto catalog_v0 = catalog->segment_catalog_as_v0();
+  if (catalog_v0 == nullptr || catalog_v0->segments() == nullptr) {
+    VAST_WARNING(this, "found unsupported segment catalog version");
+    return false;
+  }
+  std::unordered_map<uuid, catalog_entry> entries;
+  for (auto summary : *catalog_v0->segments()) {
+    uuid segment_id;
+    catalog_entry entry;
+    if (unpack(*summary, segment_id, entry))
+      return false;
+    entries[segment_id] = std::move(entry);
+  }
+  // Replay the changes that were appended after the catalog was written.
+  // Replaying is idempotent, because every entry carries the full state of
+  // its segment.
+  auto replayed_journal = exists(catalog_journal_path());
+  if (replayed_journal) {
+    auto journal = io::read(catalog_journal_path());
+    if (!journal) {
+      VAST_WARNING(this, "failed to read segment catalog journal:",
+                   render(journal.error()));
+      return false;
+    }
+    constexpr auto prefix_size = sizeof(flatbuffers::uoffset_t);
+    auto bytes = span<const byte>{*journal};
+    size_t replayed = 0;
+    while (bytes.size() >= prefix_size) {
+      auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+      auto size = prefix_size + flatbuffers::GetPrefixedSize(data);
+      if (size > bytes.size())
+        break;
+      flatbuffers::Verifier verifier{data, size};
+      if (!verifier.VerifySizePrefixedBuffer<fbs::segment_catalog_entry::v0>(
+            nullptr))
+        break;
+      auto change
+        = flatbuffers::GetSizePrefixedRoot<fbs::segment_catalog_entry::v0>(
+          data);
+      uuid segment_id;
+      catalog_entry entry;
+      if (change->segment() == nullptr
+          || unpack(*change->segment(), segment_id, entry))
+        break;
+      bytes = bytes.subspan(size);
+      if (change->removed())
+        entries.erase(segment_id);
+      else
+        entries[segment_id] = std::move(entry);
+      ++replayed;
+    }
+    // A crash while appending leaves an incomplete entry at the end. The
+    // directory listing below detects whether it mattered.
+    if (!bytes.empty())
+      VAST_WARNING(this, "discards", bytes.size(),
+                   "bytes of an incomplete segment catalog journal entry");
+    VAST_VERBOSE(this, "replayed", replayed,
+                 "segment catalog journal entries");
+  }
+  // Listing the directory is cheap compared to reading every segment, and
+  // detects segments that changed after the catalog was written, e.g., when
+  // VAST crashed in between.
+  size_t num_files = 0;
+  for (auto filename : directory{segment_path()}) {
+    ++num_files;
+    uuid segment_id;
+    auto i = entries.end();
+    if (parsers::uuid(filename.basename().str(), segment_id))
+      i = entries.find(segment_id);
+    auto size = file_size(filename);
+    if (i == entries.end() || !size || *size != i->second.size) {
+      VAST_WARNING(this, "found segment catalog out of sync with", filename);
+      return false;
+    }
+  }
+  if (num_files != entries.size()) {
+    VAST_WARNING(this, "found segment catalog with missing segments");
+    return false;
+  }
+  VAST_VERBOSE(this, "loaded", entries.size(), "segments from catalog");
+  for (auto& [segment_id, entry] : entries) {
+    if (auto err = register_segment(segment_id, std::move(entry))) {
+      VAST_WARNING(this, "failed to register segment", segment_id,
+                   "from catalog:", render(err));
+      segments_.clear();
+      catalog_.clear();
+      num_events_ = 0;
+      return false;
+    }
+  }
+  // Fold the replayed journal into a new catalog, such that we never append
+  // to a journal that ends with an incomplete entry.
+  if (replayed_journal)
+    if (auto err = save_catalog())
+      VAST_WARNING(this, "failed to persist segment catalog:", render(err));
+  return true;
+}
+
+caf::error segment_store::save_catalog() {
+  flatbuffers::FlatBufferBuilder builder;
+  std::vector<flatbuffers::Offset<fbs::segment_summary::v0>> summaries;
+  summaries.reserve(catalog_.size());
+  for (auto& [segment_id, entry] : catalog_) {
+    auto summary = pack(builder, segment_id, entry);
+    if (!summary)
+      return summary.error();
+    summaries.push_back(*summary);
+  }
+  auto segments_offset = builder.CreateVector(summaries);
+  fbs::segment_catalog::v0Builder catalog_v0_builder{builder};
+  catalog_v0_builder.add_segments(segments_offset);
+  auto catalog_v0_offset = catalog_v0_builder.Finish();
+  fbs::SegmentCatalogBuilder catalog_builder{builder};
+  catalog_builder.add_segment_catalog_type(
+    fbs::segment_catalog::SegmentCatalog::v0);
+  catalog_builder.add_segment_catalog(catalog_v0_offset.Union());
+  auto catalog_offset = catalog_builder.Finish();
+  fbs::FinishSegmentCatalogBuffer(builder, catalog_offset);
+  auto chk = fbs::release(builder);
+  if (auto err = mkdir(dir_))
+    return err;
+  if (auto err = io::save(catalog_path(), as_bytes(chk)))
+    return err;
+  // The catalog now contains all changes of the journal.
+  catalog_journal_entries_ = 0;
+  if (exists(catalog_journal_path()))
+    rm(catalog_journal_path());
+  return caf::none;
+}
+
+void segment_store::journal_catalog(const uuid& id) {
+  using defaults::system::segment_catalog_checkpoint_interval;
+  auto rewrite = [&] {
+    if (auto err = save_catalog())
+      VAST_WARNING(this, "failed to persist segment catalog:", render(err));
+  };
+  if (++catalog_journal_entries_ >= segment_catalog_checkpoint_interval)
+    return rewrite();
+  flatbuffers::FlatBufferBuilder builder;
+  auto i = catalog_.find(id);
+  auto removed = i == catalog_.end();
+  auto summary = pack(builder, id, removed ? catalog_entry{} : i->second);
+  if (!summary) {
+    VAST_WARNING(this, "failed to pack segment catalog journal entry:",
+                 render(summary.error()));
+    return rewrite();
+  }
+  fbs::segment_catalog_entry::v0Builder entry_builder{builder};
+  entry_builder.add_segment(*summary);
+  entry_builder.add_removed(removed);
+  builder.FinishSizePrefixed(entry_builder.Finish());
+  auto bytes = span<const byte>{
+    reinterpret_cast<const byte*>(builder.GetBufferPointer()),
+    builder.GetSize()};
+  if (auto err = io::append(catalog_journal_path(), bytes)) {
+    VAST_WARNING(this, "failed to append to segment catalog journal:",
+                 render(err));
+    // The journal may now lack the change, so we need the full catalog.
+    rewrite();
+  }
+}
+
 caf::expected<segment> segment_store::load_segment(uuid id) const {
   auto filename = segment_path() / to_string(id);
   VAST_DEBUG(this, "mmaps segment from", filename);
@@ -391,6 +768,8 @@ caf::expected<segment> segment_store::load_segment(uuid id) const {
   if (!chk)
     return make_error(ec::filesystem_error, "failed to mmap chunk", filename);
   if (auto segment = segment::make(std::move(chk))) {
+    if (auto i = tombstones_.find(id); i != tombstones_.end())
+      segment->tombstones(i->second);
     return segment;
   } else {
     VAST_ERROR(this, "failed to load segment at", filename,
@@ -399,6 +778,281 @@ caf::expected<segment> segment_store::load_segment(uuid id) const {
   }
 }
 
+std::vector<segment> segment_store::take_rewrites() {
+  std::vector<segment> result;
+  for (auto& segment_id : pending_rewrites_) {
+    // A later erasure may have dropped the segment in the meantime.
+    if (catalog_.count(segment_id) == 0) {
+      rewrites_.erase(segment_id);
+      continue;
+    }
+    auto seg = [&]() -> caf::expected<segment> {
+      if (auto i = cache_.peek(segment_id); i != cache_.end())
+        return i->second;
+      return load_segment(segment_id);
+    }();
+    if (!seg) {
+      VAST_WARNING(this, "failed to load segment", segment_id,
+                   "for rewriting:", render(seg.error()));
+      rewrites_.erase(segment_id);
+      continue;
+    }
+    result.push_back(std::move(*seg));
+  }
+  pending_rewrites_.clear();
+  return result;
+}
+
+caf::expected<uuid>
+segment_store::rewrite(const segment& x, const path& dir) {
+  return merge({x}, dir);
+}
+
+caf::error segment_store::finish_rewrite(const uuid& id, const ids& applied,
+                                         const uuid& result) {
+  return finish_merge({id}, {applied}, result);
+}
+
+void segment_store::abort_rewrite(const uuid& id) {
+  rewrites_.erase(id);
+}
+
+std::vector<std::vector<segment>> segment_store::take_merges(size_t budget) {
+  // Segments below half of the maximum size are candidates for merging. Like
+  // the writer, we measure the size of the table slices before compression.
+  auto threshold = max_segment_size_ / 2;
+  // Orders the persisted segments by their position in the ID space, such
+  // that merging keeps adjacent IDs together.
+  std::vector<std::pair<id, uuid>> order;
+  order.reserve(catalog_.size());
+  for (auto& [segment_id, entry] : catalog_)
+    if (!entry.intervals.empty())
+      order.emplace_back(entry.intervals.front().first, segment_id);
+  std::sort(order.begin(), order.end(), [](const auto& x, const auto& y) {
+    return x.first < y.first;
+  });
+  std::vector<std::vector<segment>> result;
+  size_t processed = 0;
+  auto first = order.begin();
+  while (first != order.end()) {
+    auto remaining = budget - processed;
+    // Find the next run of at least two adjacent undersized segments whose
+    // table slices fit into a segment, and whose files fit into the remaining
+    // budget. Segments with overlapping ID ranges cannot be merged, since the
+    // merged segment requires increasing table slice offsets.
+    std::vector<uuid> run;
+    uint64_t run_size = 0;
+    uint64_t run_bytes = 0;
+    id run_end = 0;
+    for (; first != order.end(); ++first) {
+      auto& entry = catalog_.find(first->second)->second;
+      // Segments that wait for a rewrite shrink anyway, and segments that
+      // are being merged already cannot be merged again.
+      auto undersized = entry.table_slice_bytes < threshold
+                        && entry.size <= remaining
+                        && rewrites_.count(first->second) == 0;
+      if (undersized && run_size + entry.size <= remaining
+          && run_bytes + entry.table_slice_bytes <= max_segment_size_
+          && (run.empty() || run_end <= entry.intervals.front().first)) {
+        run.push_back(first->second);
+        run_size += entry.size;
+        run_bytes += entry.table_slice_bytes;
+        run_end = entry.intervals.back().second;
+        continue;
+      }
+      if (run.size() > 1)
+        break;
+      run.clear();
+      run_size = 0;
+      run_bytes = 0;
+      if (undersized) {
+        run.push_back(first->second);
+        run_size = entry.size;
+        run_bytes = entry.table_slice_bytes;
+        run_end = entry.intervals.back().second;
+      }
+    }
+    if (run.size() < 2)
+      break;
+    std::vector<segment> segments;
+    for (auto& segment_id : run) {
+      auto seg = [&]() -> caf::expected<segment> {
+        if (auto i = cache_.peek(segment_id); i != cache_.end())
+          return i->second;
+        return load_segment(segment_id);
+      }();
+      if (!seg) {
+        VAST_WARNING(this, "failed to load segment", segment_id,
+                     "for merging:", render(seg.error()));
+        break;
+      }
+      segments.push_back(std::move(*seg));
+    }
+    if (segments.size() != run.size())
+      continue;
+    for (auto& segment_id : run)
+      rewrites_.insert(segment_id);
+    processed += run_size;
+    result.push_back(std::move(segments));
+  }
+  return result;
+}
+
+caf::expected<uuid>
+segment_store::merge(const std::vector<segment>& xs, const path& dir) {
+  // Stream the remaining events into a new segment under construction, and
+  // move it to `dir` where it waits for `finish_merge`.
+  segment_writer writer{dir / "active"};
+  for (auto& x : xs) {
+    // The lookup omits all events that we marked as erased.
+    auto slices = x.lookup(x.ids());
+    if (!slices)
+      return slices.error();
+    for (auto& slice : *slices)
+      if (auto err = writer.add(std::move(slice)))
+        return err;
+  }
+  auto result = writer.id();
+  if (auto seg = writer.finish(dir / to_string(result)); !seg)
+    return seg.error();
+  return result;
+}
+
+caf::error segment_store::finish_merge(const std::vector<uuid>& sources,
+                                       const std::vector<ids>& applied,
+                                       const uuid& result) {
+  VAST_ASSERT(sources.size() == applied.size());
+  for (auto& segment_id : sources)
+    rewrites_.erase(segment_id);
+  auto staged = rewrite_path() / to_string(result);
+  // A merge or a later erasure may have replaced a segment in the meantime.
+  auto replaced = [&](const uuid& segment_id) {
+    return catalog_.count(segment_id) == 0;
+  };
+  if (std::any_of(sources.begin(), sources.end(), replaced)) {
+    rm(staged);
+    return caf::none;
+  }
+  auto chk = chunk::mmap(staged);
+  if (!chk) {
+    rm(staged);
+    return make_error(ec::filesystem_error, "failed to mmap chunk", staged);
+  }
+  auto summary = summarize(*chk);
+  if (!summary) {
+    rm(staged);
+    return summary.error();
+  }
+  VAST_VERBOSE(this, "replaces", sources.size(), "segments with segment",
+               result);
+  // Erasures that happened while merging only marked their events with
+  // tombstones in the original segments, so we carry those over. We persist
+  // them before the new segment becomes visible, because we cannot restore
+  // them after a crash otherwise.
+  auto remaining = ids{};
+  for (size_t i = 0; i < sources.size(); ++i)
+    if (auto j = tombstones_.find(sources[i]); j != tombstones_.end())
+      remaining |= j->second - applied[i];
+  if (any(remaining))
+    if (auto err = save_tombstones(result, remaining))
+      return err;
+  // Record which segments the new segment replaces, such that we can complete
+  // the swap after a crash.
+  std::vector<char> buffer;
+  if (auto err = detail::serialize(buffer, result, sources))
+    return err;
+  if (auto err = io::save(compaction_path(), as_bytes(buffer)))
+    return err;
+  auto filename = segment_path() / to_string(result);
+  if (std::rename(staged.str().c_str(), filename.str().c_str()) != 0) {
+    rm(compaction_path());
+    rm(staged);
+    return make_error(ec::filesystem_error, "failed to move", staged, "to",
+                      filename);
+  }
+  // Existing memory mappings of the originals remain valid after removing
+  // their files.
+  for (auto& segment_id : sources) {
+    segments_.erase_value(segment_id);
+    catalog_.erase(segment_id);
+    journal_catalog(segment_id);
+    drop_tombstones(segment_id);
+    if (auto i = cache_.peek(segment_id); i != cache_.end())
+      cache_.erase(i);
+    rm(segment_path() / to_string(segment_id));
+  }
+  for (auto [first, last] : summary->second.intervals)
+    if (!segments_.inject(first, last, result))
+      return make_error(ec::unspecified, "failed to update range_map");
+  if (any(remaining))
+    tombstones_.emplace(result, std::move(remaining));
+  catalog_.insert(std::move(*summary));
+  journal_catalog(result);
+  rm(compaction_path());
+  return caf::none;
+}
+
+void segment_store::abort_merge(const std::vector<uuid>& sources) {
+  for (auto& segment_id : sources)
+    rewrites_.erase(segment_id);
+}
+
+void segment_store::recover_compaction() {
+  if (!exists(compaction_path()))
+    return;
+  uuid merged_id;
+  std::vector<uuid> run;
+  auto buffer = io::read(compaction_path());
+  if (buffer && !detail::deserialize(*buffer, merged_id, run)
+      && exists(segment_path() / to_string(merged_id))) {
+    VAST_WARNING(this, "completes interrupted merge into segment", merged_id);
+    for (auto& segment_id : run) {
+      rm(segment_path() / to_string(segment_id));
+      rm(tombstone_path() / to_string(segment_id));
+    }
+  }
+  rm(compaction_path());
+}
+
+caf::error segment_store::load_tombstones() {
+  for (auto filename : directory{tombstone_path()}) {
+    uuid segment_id;
+    if (!parsers::uuid(filename.basename().str(), segment_id)) {
+      VAST_WARNING(this, "ignores unexpected file", filename);
+      continue;
+    }
+    // Tombstones outlive their segment when we crash while dropping it.
+    if (!exists(segment_path() / to_string(segment_id))) {
+      VAST_DEBUG(this, "removes stale tombstones for segment", segment_id);
+      rm(filename);
+      continue;
+    }
+    auto buffer = io::read(filename);
+    if (!buffer)
+      return buffer.error();
+    ids xs;
+    if (auto err = detail::deserialize(*buffer, xs))
+      return err;
+    VAST_DEBUG(this, "loaded", rank(xs), "tombstones for segment", segment_id);
+    tombstones_.emplace(segment_id, std::move(xs));
+  }
+  return caf::none;
+}
+
+caf::error segment_store::save_tombstones(const uuid& id, const ids& xs) const {
+  if (auto err = mkdir(tombstone_path()))
+    return err;
+  std::vector<char> buffer;
+  if (auto err = detail::serialize(buffer, xs))
+    return err;
+  return io::save(tombstone_path() / to_string(id), as_bytes(buffer));
+}
+
+void segment_store::drop_tombstones(const uuid& id) {
+  if (tombstones_.erase(id) > 0)
+    rm(tombstone_path() / to_string(id));
+}
+
 caf::error segment_store::select_segments(const ids& selection,
                                           std::vector<uuid>& candidates) const {
   VAST_DEBUG(this, "retrieves table slices with requested ids");
@@ -415,31 +1069,22 @@ caf::error segment_store::select_segments(const ids& selection,
 }
 
 uint64_t segment_store::drop(segment& x) {
-  uint64_t erased_events = 0;
   auto segment_id = x.id();
-  // TODO: discuss whether we want to allow accessing a segment through the
-  // flatbuffers API. The (heavy-weight) altnerative here would be to create a
-  // custom iterator so that a segment can be iterated as a list of table_slice
-  // instances.
-  auto s = fbs::GetSegment(x.chunk()->data());
-  auto s0 = s->segment_as_v0();
-  for (auto flat_slice : *s0->slices()) {
-    auto slice = table_slice{*flat_slice, x.chunk(), table_slice::verify::no};
-    erased_events += slice.rows();
-  }
+  auto erased_events = x.num_events() - rank(x.tombstones());
   VAST_INFO(this, "erases entire segment", segment_id);
   // Schedule deletion of the segment file when releasing the chunk.
   auto filename = segment_path() / to_string(segment_id);
   x.chunk()->add_deletion_step([=]() noexcept { rm(filename); });
   segments_.erase_value(segment_id);
+  catalog_.erase(segment_id);
+  journal_catalog(segment_id);
+  drop_tombstones(segment_id);
   return erased_events;
 }
 
-uint64_t segment_store::drop(segment_builder& x) {
-  uint64_t erased_events = 0;
+uint64_t segment_store::drop(segment_writer& x) {
   auto segment_id = x.id();
-  for (auto& slice : x.table_slices())
-    erased_events += slice.rows();
+  auto erased_events = x.num_events();
   VAST_INFO(this, "erases segment under construction", segment_id);
   x.reset();
   segments_.erase_value(segment_id);
@@ -0,0 +1,220 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/segment_writer.hpp"
+
+#include "vast/bitmap_algorithms.hpp"
+#include "vast/chunk.hpp"
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/filesystem.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/detail/lz4.hpp"
+#include "vast/detail/posix.hpp"
+#include "vast/error.hpp"
+#include "vast/fbs/segment.hpp"
+#include "vast/ids.hpp"
+#include "vast/logger.hpp"
+#include "vast/segment.hpp"
+#include "vast/table_slice.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace vast {
+
+namespace {
+
+/// The size of the segment header, which holds the root offset and the file
+/// identifier of the FlatBuffers table at the end of the file.
+constexpr auto header_size = size_t{8};
+
+} // namespace
+
+segment_writer::segment_writer(path dir) : dir_{std::move(dir)} {
+  reset();
+}
+
+segment_writer::~segment_writer() {
+  reset();
+}
+
+caf::error segment_writer::add(table_slice x) {
+  if (!intervals_.empty() && x.offset() < intervals_.back().end())
+    return make_error(ec::unspecified, "slice offsets not increasing");
+  if (auto err = open())
+    return err;
+  auto bytes = as_bytes(x);
+  compression_buffer_.resize(detail::lz4::compress_bound(bytes.size()));
+  auto compressed_size
+    = detail::lz4::compress(bytes, as_writeable_bytes(compression_buffer_));
+  if (compressed_size == 0)
+    return make_error(ec::unspecified, "failed to compress table slice");
+  if (auto err = file_.write(compression_buffer_.data(), compressed_size))
+    return err;
+  extents_.emplace_back(size_, compressed_size, bytes.size());
+  intervals_.emplace_back(x.offset(), x.offset() + x.rows());
+  size_ += compressed_size;
+  num_events_ += x.rows();
+  table_slice_bytes_ += bytes.size();
+  return caf::none;
+}
+
+caf::expected<segment> segment_writer::finish(const path& filename) {
+  if (auto err = open())
+    return err;
+  // Pad the compressed table slices such that the footer starts at an offset
+  // that satisfies the alignment requirements of the FlatBuffers table.
+  static constexpr auto padding = std::array<byte, header_size>{};
+  if (auto remainder = size_ % header_size; remainder != 0) {
+    if (auto err = file_.write(padding.data(), header_size - remainder))
+      return err;
+    size_ += header_size - remainder;
+  }
+  flatbuffers::FlatBufferBuilder builder;
+  auto extents_offset = builder.CreateVectorOfStructs(extents_);
+  auto uuid_offset = pack(builder, id_);
+  auto ids_offset = builder.CreateVectorOfStructs(intervals_);
+  fbs::segment::v2Builder segment_v2_builder{builder};
+  segment_v2_builder.add_slices(extents_offset);
+  segment_v2_builder.add_uuid(*uuid_offset);
+  segment_v2_builder.add_ids(ids_offset);
+  segment_v2_builder.add_events(num_events_);
+  auto segment_v2_offset = segment_v2_builder.Finish();
+  fbs::SegmentBuilder segment_builder{builder};
+  segment_builder.add_segment_type(vast::fbs::segment::Segment::v2);
+  segment_builder.add_segment(segment_v2_offset.Union());
+  auto segment_offset = segment_builder.Finish();
+  fbs::FinishSegmentBuffer(builder, segment_offset);
+  // FlatBuffers <= 1.11 does not correctly use '::flatbuffers::soffset_t' over
+  // 'soffset_t' in FLATBUFFERS_MAX_BUFFER_SIZE.
+  using ::flatbuffers::soffset_t;
+  if (size_ + builder.GetSize() >= FLATBUFFERS_MAX_BUFFER_SIZE)
+    return make_error(ec::unspecified, "segment size exceeds the maximum "
+                                       "allowed size of",
+                      FLATBUFFERS_MAX_BUFFER_SIZE);
+  auto footer = builder.GetBufferPointer();
+  if (auto err = file_.write(footer, builder.GetSize()))
+    return err;
+  // Patch the header to make the entire file a valid FlatBuffers table: The
+  // root offset points to the root table in the footer, and the file
+  // identifier matches that of the footer.
+  auto header = std::array<uint8_t, header_size>{};
+  std::memcpy(header.data(), footer, header.size());
+  flatbuffers::WriteScalar<flatbuffers::uoffset_t>(
+    header.data(),
+    flatbuffers::ReadScalar<flatbuffers::uoffset_t>(footer) + size_);
+  auto written
+    = detail::pwrite(file_.handle(), header.data(), header.size(), 0);
+  if (!written)
+    return written.error();
+  if (*written != header.size())
+    return make_error(ec::filesystem_error, "incomplete write", file_.path());
+  auto tmp = file_.path();
+  if (!file_.close())
+    return make_error(ec::filesystem_error, "failed to close", tmp);
+  if (auto err = mkdir(filename.parent()))
+    return err;
+  if (std::rename(tmp.str().c_str(), filename.str().c_str()) != 0)
+    return make_error(ec::filesystem_error, "failed to move", tmp, "to",
+                      filename, std::strerror(errno));
+  reset();
+  auto chk = chunk::mmap(filename);
+  if (!chk)
+    return make_error(ec::filesystem_error, "failed to mmap chunk", filename);
+  return segment::make(std::move(chk));
+}
+
+caf::expected<std::vector<table_slice>>
+segment_writer::lookup(const vast::ids& xs) const {
+  std::vector<table_slice> result;
+  std::vector<byte> buffer;
+  auto f = [](const fbs::interval::v0& interval) {
+    return std::pair{interval.begin(), interval.end()};
+  };
+  auto g = [&](const fbs::interval::v0& interval) -> caf::error {
+    const auto& extent = extents_[&interval - intervals_.data()];
+    buffer.resize(extent.size());
+    auto read = detail::pread(file_.handle(), buffer.data(), extent.size(),
+                              extent.offset());
+    if (!read)
+      return read.error();
+    if (*read != extent.size())
+      return make_error(ec::filesystem_error, "incomplete read", file_.path());
+    auto slice
+      = decompress(buffer, extent.uncompressed_size(), table_slice::verify::no);
+    if (slice.encoding() == table_slice::encoding::none)
+      return make_error(ec::format_error, "failed to read table slice from "
+                                          "segment under construction");
+    slice.offset(interval.begin());
+    result.push_back(std::move(slice));
+    return caf::none;
+  };
+  if (auto error = select_with(xs, intervals_.begin(), intervals_.end(), f, g))
+    return error;
+  return result;
+}
+
+const uuid& segment_writer::id() const {
+  return id_;
+}
+
+vast::ids segment_writer::ids() const {
+  vast::ids result;
+  for (const auto& interval : intervals_) {
+    result.append_bits(false, interval.begin() - result.size());
+    result.append_bits(true, interval.end() - interval.begin());
+  }
+  return result;
+}
+
+uint64_t segment_writer::num_events() const {
+  return num_events_;
+}
+
+size_t segment_writer::table_slice_bytes() const {
+  return table_slice_bytes_;
+}
+
+void segment_writer::reset() {
+  if (file_.is_open()) {
+    file_.close();
+    if (!rm(file_.path()))
+      VAST_WARNING(this, "failed to remove unfinished segment", file_.path());
+  }
+  id_ = uuid::random();
+  file_ = file{dir_ / to_string(id_)};
+  size_ = 0;
+  num_events_ = 0;
+  table_slice_bytes_ = 0;
+  intervals_.clear();
+  extents_.clear();
+  compression_buffer_.clear();
+  compression_buffer_.shrink_to_fit();
+}
+
+caf::error segment_writer::open() {
+  if (file_.is_open())
+    return caf::none;
+  if (auto opened = file_.open(file::read_write); !opened)
+    return opened.error();
+  // The header gets patched in `finish` once we know the final layout.
+  static constexpr auto header = std::array<byte, header_size>{};
+  if (auto err = file_.write(header.data(), header.size()))
+    return err;
+  size_ = header.size();
+  return caf::none;
+}
+
+} // namespace vast
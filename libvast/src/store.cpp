@@ -19,6 +19,10 @@ store::~store() {
   // nop
 }
 
+caf::expected<size_t> store::compact(size_t) {
+  return size_t{0};
+}
+
 store::lookup::~lookup() {
   // nop
 }
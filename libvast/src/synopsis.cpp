@@ -42,6 +42,10 @@ const vast::type& synopsis::type() const {
   return type_;
 }
 
+void synopsis::add_nil() {
+  // nop
+}
+
 synopsis_ptr synopsis::shrink() const {
   return nullptr;
 }
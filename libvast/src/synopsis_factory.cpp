@@ -14,8 +14,10 @@
 #include "vast/synopsis_factory.hpp"
 
 #include "vast/address_synopsis.hpp"
+#include "vast/arithmetic_synopsis.hpp"
 #include "vast/bool_synopsis.hpp"
 #include "vast/concept/hashable/xxhash.hpp"
+#include "vast/string_synopsis.hpp"
 #include "vast/time_synopsis.hpp"
 
 namespace vast {
@@ -23,6 +25,12 @@ namespace vast {
 void factory_traits<synopsis>::initialize() {
   factory<synopsis>::add(address_type{}, make_address_synopsis<xxhash64>);
   factory<synopsis>::add<bool_type, bool_synopsis>();
+  factory<synopsis>::add<integer_type, integer_synopsis>();
+  factory<synopsis>::add<count_type, count_synopsis>();
+  factory<synopsis>::add<real_type, real_synopsis>();
+  factory<synopsis>::add<duration_type, duration_synopsis>();
+  factory<synopsis>::add<enumeration_type, enumeration_synopsis>();
+  factory<synopsis>::add(string_type{}, make_string_synopsis<xxhash64>);
   factory<synopsis>::add<time_type, time_synopsis>();
 }
 
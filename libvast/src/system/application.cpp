@@ -61,17 +61,45 @@ command::opts_builder add_index_opts(command::opts_builder ob) {
   return std::move(ob)
     .add<size_t>("max-partition-size", "maximum number of events in a "
                                        "partition")
-    .add<size_t>("max-resident-partitions", "maximum number of in-memory "
-                                            "partitions")
+    .add<size_t>("partition-cache-size", "maximum size of in-memory "
+                                         "partitions in MiB")
+    .add<size_t>("max-resident-partitions", "deprecated; use "
+                                            "partition-cache-size instead")
     .add<size_t>("max-taste-partitions", "maximum number of immediately "
                                          "scheduled partitions")
-    .add<size_t>("max-queries,q", "maximum number of concurrent queries");
+    .add<size_t>("max-queries,q", "maximum number of concurrent queries")
+    .add<size_t>("indexing-workers", "number of indexing workers per "
+                                     "partition (0: one indexer per field)")
+    .add<std::string>("partition-window", "wall-clock time window after which "
+                                          "partitions roll over (0s: never)")
+    .add<size_t>("max-active-partitions", "maximum number of partitions that "
+                                          "ingest events concurrently")
+    .add<std::string>("active-partition-timeout",
+                      "time without new events after which a partition "
+                      "persists (0s: never)")
+    .add<size_t>("partition-compaction-budget",
+                 "maximum number of events to merge per compaction cycle "
+                 "(0: never)")
+    .add<size_t>("synopsis-loaders", "number of threads that load partition "
+                                      "synopses at startup")
+    .add<bool>("lazy-synopses", "answer queries before all partition "
+                                "synopses are loaded")
+    .add<size_t>("meta-index-shards", "number of actors that look up "
+                                      "candidate partitions in parallel");
 }
 
 command::opts_builder add_archive_opts(command::opts_builder ob) {
   return std::move(ob)
-    .add<size_t>("segments,s", "number of cached segments")
-    .add<size_t>("max-segment-size,m", "maximum segment size in MB");
+    .add<size_t>("segment-cache-size", "maximum size of cached segments in "
+                                       "MiB")
+    .add<size_t>("segments,s", "deprecated; use segment-cache-size instead")
+    .add<size_t>("max-segment-size,m", "maximum segment size in MB")
+    .add<size_t>("max-archive-sessions", "maximum number of concurrent "
+                                         "extraction sessions")
+    .add<size_t>("segment-read-ahead", "number of candidate segments to "
+                                       "prefetch per extraction session")
+    .add<size_t>("segment-compaction-budget", "maximum MiB to read per minute "
+                                              "for merging small segments");
 }
 
 auto make_root_command(std::string_view path) {
@@ -108,6 +136,8 @@ auto make_root_command(std::string_view path) {
         .add<std::string>("aging-frequency", "interval between two aging "
                                              "cycles")
         .add<std::string>("aging-query", "query for aging out obsolete data")
+        .add<size_t>("filesystem-workers", "number of concurrent blocking "
+                                           "file system operations")
         .add<std::string>("shutdown-grace-period",
                           "time to wait until component shutdown "
                           "finishes cleanly before inducing a hard kill");
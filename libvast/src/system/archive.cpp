@@ -36,36 +36,142 @@ using namespace caf;
 
 namespace vast::system {
 
+namespace {
+
+/// Rewrites a single segment on a separate thread.
+caf::behavior
+segment_rewriter(caf::event_based_actor* self, segment x, path dir) {
+  return {
+    [=](atom::erase) -> caf::result<uuid> {
+      // There is nothing left to do after responding.
+      self->quit();
+      return segment_store::rewrite(x, dir);
+    },
+  };
+}
+
+/// Merges a run of segments on a separate thread.
+caf::behavior segment_merger(caf::event_based_actor* self,
+                             std::vector<segment> xs, path dir) {
+  return {
+    [=](atom::compact) -> caf::result<uuid> {
+      // There is nothing left to do after responding.
+      self->quit();
+      return segment_store::merge(xs, dir);
+    },
+  };
+}
+
+} // namespace
+
 void archive_state::next_session() {
-  // No requester means no work to do.
-  if (requesters.empty()) {
-    VAST_TRACE(self, "has no requesters");
-    session = nullptr;
-    return;
-  }
-  // Find the work queue for our current requester.
-  const auto& current_requester = requesters.front();
-  auto it = unhandled_ids.find(current_requester->address());
-  // There is no ids queue for our current requester. Let's dismiss the
-  // requester and try again.
-  if (it == unhandled_ids.end()) {
-    VAST_TRACE(self, "could not find an ids queue for the current requester");
+  // Swap in new segments before new sessions select their candidates.
+  swap_segments();
+  while (sessions.size() < max_sessions) {
+    // No requester means no work to do.
+    if (requesters.empty()) {
+      VAST_TRACE(self, "has no requesters");
+      return;
+    }
+    // Find the work queue for our current requester.
+    auto current_requester = std::move(requesters.front());
     requesters.pop();
-    return next_session();
+    auto it = unhandled_ids.find(current_requester->address());
+    // There is no ids queue for our current requester. Let's dismiss the
+    // requester and try again.
+    if (it == unhandled_ids.end()) {
+      VAST_TRACE(self, "could not find an ids queue for the current requester");
+      continue;
+    }
+    // There is a work queue for our current requester, but it is empty. Let's
+    // clean house, dismiss the requester and try again.
+    if (it->second.empty()) {
+      VAST_TRACE(self, "found an empty ids queue for the current requester");
+      unhandled_ids.erase(it);
+      continue;
+    }
+    // Start working on the next ids for the next requester.
+    auto& next_ids = it->second.front();
+    auto& current = sessions[current_requester->address()];
+    current.lookup = store->extract(next_ids);
+    current.id = ++session_id;
+    self->send(self, next_ids, current_requester, current.id);
+    it->second.pop();
   }
-  // There is a work queue for our current requester, but it is empty. Let's
-  // clean house, dismiss the requester and try again.
-  if (it->second.empty()) {
-    VAST_TRACE(self, "found an empty ids queue for the current requester");
-    unhandled_ids.erase(it);
-    requesters.pop();
-    return next_session();
+}
+
+void archive_state::finish_session(const archive_client_actor& requester) {
+  sessions.erase(requester->address());
+  // Requesters with pending work queue up behind all other waiting requesters
+  // to ensure that no single requester can monopolize the archive.
+  auto it = unhandled_ids.find(requester->address());
+  if (it != unhandled_ids.end()) {
+    if (it->second.empty())
+      unhandled_ids.erase(it);
+    else
+      requesters.push(requester);
+  }
+  next_session();
+}
+
+void archive_state::rewrite_segments() {
+  for (auto& seg : store->take_rewrites()) {
+    auto id = seg.id();
+    auto applied = seg.tombstones();
+    VAST_DEBUG(self, "rewrites segment", id);
+    auto rewriter = self->spawn<caf::detached>(segment_rewriter, std::move(seg),
+                                               store->rewrite_path());
+    self->request(rewriter, caf::infinite, atom::erase_v)
+      .then(
+        [=](const uuid& result) {
+          pending_swaps.push_back({{id}, {applied}, result});
+          swap_segments();
+        },
+        [=](const caf::error& err) {
+          VAST_ERROR(self, "failed to rewrite segment", id, ":", render(err));
+          store->abort_rewrite(id);
+        });
+  }
+}
+
+void archive_state::merge_segments() {
+  if (merges.empty())
+    return;
+  std::vector<uuid> sources;
+  std::vector<ids> applied;
+  for (auto& seg : merges.back()) {
+    sources.push_back(seg.id());
+    applied.push_back(seg.tombstones());
   }
-  // Start working on the next ids for the next requester.
-  auto& next_ids = it->second.front();
-  session = store->extract(next_ids);
-  self->send(self, next_ids, current_requester, ++session_id);
-  it->second.pop();
+  VAST_DEBUG(self, "merges", sources.size(), "segments");
+  auto merger = self->spawn<caf::detached>(segment_merger, merges.back(),
+                                           store->rewrite_path());
+  self->request(merger, caf::infinite, atom::compact_v)
+    .then(
+      [=](const uuid& result) {
+        merges.pop_back();
+        pending_swaps.push_back({sources, applied, result});
+        swap_segments();
+        merge_segments();
+      },
+      [=](const caf::error& err) {
+        VAST_WARNING(self, "failed to merge segments:", render(err));
+        merges.pop_back();
+        store->abort_merge(sources);
+        merge_segments();
+      });
+}
+
+void archive_state::swap_segments() {
+  // Running sessions may still read the segments that they selected as
+  // candidates when they started.
+  if (!sessions.empty())
+    return;
+  for (auto& x : pending_swaps)
+    if (auto err = store->finish_merge(x.sources, x.applied, x.result))
+      VAST_ERROR(self, "failed to replace segments with segment", x.result,
+                 ":", render(err));
+  pending_swaps.clear();
 }
 
 void archive_state::send_report() {
@@ -89,20 +195,32 @@ void archive_state::send_report() {
 
 archive_actor::behavior_type
 archive(archive_actor::stateful_pointer<archive_state> self, path dir,
-        size_t capacity, size_t max_segment_size) {
+        size_t capacity, size_t max_segment_size, size_t max_sessions,
+        size_t read_ahead, size_t compaction_budget) {
   // TODO: make the choice of store configurable. For most flexibility, it
   // probably makes sense to pass a unique_ptr<stor> directory to the spawn
   // arguments of the actor. This way, users can provide their own store
   // implementation conveniently.
   VAST_VERBOSE(self, "initializes archive in", dir,
-               "with a maximum segment size of", max_segment_size, "MB, and",
-               capacity, "segments in memory");
+               "with a maximum segment size of", max_segment_size, "bytes,",
+               capacity, "bytes of cached segments, and up to", max_sessions,
+               "concurrent extraction sessions");
+  VAST_ASSERT(max_sessions > 0);
   self->state.self = self;
-  self->state.store = segment_store::make(dir, max_segment_size, capacity);
+  self->state.max_sessions = max_sessions;
+  self->state.compaction_budget = compaction_budget;
+  self->state.store
+    = segment_store::make(dir, max_segment_size, capacity, read_ahead);
   VAST_ASSERT(self->state.store != nullptr);
+  if (compaction_budget > 0)
+    self->delayed_send(self, defaults::system::segment_compaction_interval,
+                       atom::compact_v);
   self->set_exit_handler([=](const exit_msg& msg) {
     VAST_DEBUG(self, "got EXIT from", msg.source);
     self->state.send_report();
+    // No session needs the sources of rewritten or merged segments anymore.
+    self->state.sessions.clear();
+    self->state.swap_segments();
     if (auto err = self->state.store->flush())
       VAST_ERROR(self, "failed to flush archive", to_string(err));
     self->state.store.reset();
@@ -110,7 +228,13 @@ archive(archive_actor::stateful_pointer<archive_state> self, path dir,
   });
   self->set_down_handler([=](const down_msg& msg) {
     VAST_DEBUG(self, "received DOWN from", msg.source);
-    self->state.active_exporters.erase(msg.source);
+    auto& st = self->state;
+    st.active_exporters.erase(msg.source);
+    // Free the session slot of the exporter right away instead of waiting for
+    // its next extraction step.
+    st.unhandled_ids.erase(msg.source);
+    if (st.sessions.erase(msg.source) > 0)
+      st.next_session();
   });
   return {
     [=](const ids& xs) {
@@ -129,40 +253,54 @@ archive(archive_actor::stateful_pointer<archive_state> self, path dir,
         VAST_DEBUG(self, "dismisses query for inactive sender");
         return;
       }
-      st.requesters.push(requester);
-      st.unhandled_ids[requester->address()].push(xs);
-      if (!st.session)
+      auto& pending = st.unhandled_ids[requester->address()];
+      pending.push(xs);
+      // A requester without prior pending work is neither waiting for a
+      // session slot nor in an active session, so it has to queue up.
+      if (pending.size() == 1
+          && st.sessions.count(requester->address()) == 0) {
+        st.requesters.push(requester);
         st.next_session();
+      }
     },
     [=](const ids& xs, archive_client_actor requester, uint64_t session_id) {
       auto& st = self->state;
       // If the export has since shut down, we need to invalidate the session.
       if (st.active_exporters.count(requester->address()) == 0) {
         VAST_DEBUG(self, "invalidates running query session for", requester);
-        st.next_session();
+        if (st.sessions.erase(requester->address()) > 0)
+          st.next_session();
         return;
       }
-      if (!st.session || st.session_id != session_id) {
+      auto it = st.sessions.find(requester->address());
+      if (it == st.sessions.end() || it->second.id != session_id) {
         VAST_DEBUG(self, "considers extraction finished for invalidated "
                          "session");
         self->send(requester, atom::done_v, make_error(ec::no_error));
-        st.next_session();
+        return;
+      }
+      if (!it->second.lookup) {
+        VAST_DEBUG(self, "failed to start extraction for the current session");
+        self->send(requester, atom::done_v, make_error(ec::no_error));
+        st.finish_session(requester);
         return;
       }
       // Extract the next slice.
-      auto slice = st.session->next();
+      auto slice = it->second.lookup->next();
       if (!slice) {
         auto err
           = slice.error() ? std::move(slice.error()) : make_error(ec::no_error);
         VAST_DEBUG(self, "finished extraction from the current session:", err);
         self->send(requester, atom::done_v, std::move(err));
-        st.next_session();
+        st.finish_session(requester);
         return;
       }
       // The slice may contain entries that are not selected by xs.
       for (auto& sub_slice : select(*slice, xs))
         self->send(requester, sub_slice);
-      // Continue working on the current session.
+      // Continue working on the current session. Since every session step is
+      // a separate message, the steps of all active sessions as well as
+      // incoming table slices interleave in the mailbox.
       self->send(self, xs, requester, session_id);
     },
     [=](caf::stream<table_slice> in) -> caf::inbound_stream_slot<table_slice> {
@@ -219,6 +357,12 @@ archive(archive_actor::stateful_pointer<archive_state> self, path dir,
       auto& archive_status = put_dictionary(result, "archive");
       if (v >= status_verbosity::debug)
         detail::fill_status_map(archive_status, self);
+      if (v >= status_verbosity::detailed) {
+        auto& sessions_status = put_dictionary(archive_status, "sessions");
+        put(sessions_status, "active", self->state.sessions.size());
+        put(sessions_status, "max", self->state.max_sessions);
+        put(sessions_status, "waiting", self->state.requesters.size());
+      }
       self->state.store->inspect_status(archive_status, v);
       return result;
     },
@@ -227,9 +371,24 @@ archive(archive_actor::stateful_pointer<archive_state> self, path dir,
       namespace defs = defaults::system;
       self->delayed_send(self, defs::telemetry_rate, atom::telemetry_v);
     },
+    [=](atom::compact) {
+      auto& st = self->state;
+      // The budget bounds the data we merge per cycle. A cycle starts only
+      // after all merges of the previous one completed.
+      if (st.merges.empty()) {
+        st.merges = st.store->take_merges(st.compaction_budget);
+        if (!st.merges.empty())
+          VAST_VERBOSE(self, "merges", st.merges.size(), "runs of segments");
+        st.merge_segments();
+      }
+      namespace defs = defaults::system;
+      self->delayed_send(self, defs::segment_compaction_interval,
+                         atom::compact_v);
+    },
     [=](atom::erase, const ids& xs) {
       if (auto err = self->state.store->erase(xs))
         VAST_ERROR(self, "failed to erase events:", self->system().render(err));
+      self->state.rewrite_segments();
       return atom::done_v;
     },
   };
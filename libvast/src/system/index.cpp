@@ -29,6 +29,8 @@
 #include "vast/detail/fill_status_map.hpp"
 #include "vast/detail/narrow.hpp"
 #include "vast/detail/notifying_stream_manager.hpp"
+#include "vast/detail/set_operations.hpp"
+#include "vast/detail/spawn_container_source.hpp"
 #include "vast/error.hpp"
 #include "vast/expression_visitors.hpp"
 #include "vast/fbs/index.hpp"
@@ -40,9 +42,11 @@
 #include "vast/io/save.hpp"
 #include "vast/json.hpp"
 #include "vast/logger.hpp"
+#include "vast/path.hpp"
 #include "vast/system/accountant_actor.hpp"
 #include "vast/system/evaluator.hpp"
 #include "vast/system/filesystem_actor.hpp"
+#include "vast/system/meta_index_shard.hpp"
 #include "vast/system/partition.hpp"
 #include "vast/system/query_supervisor.hpp"
 #include "vast/system/shutdown.hpp"
@@ -57,6 +61,7 @@
 #include <chrono>
 #include <ctime>
 #include <memory>
+#include <unordered_set>
 #include <unistd.h>
 
 using namespace std::chrono;
@@ -64,8 +69,8 @@ using namespace std::chrono;
 // clang-format off
 //
 // The index is implemented as a stream stage that hooks into the table slice
-// stream coming from the importer, and forwards them to the current active
-// partition
+// stream coming from the importer, and forwards them to the active partition
+// for their layout
 //
 //              table slice              table slice                      table slice column
 //   importer ----------------> index ---------------> active partition ------------------------> indexer
@@ -92,10 +97,23 @@ using namespace std::chrono;
 
 namespace vast::system {
 
+bool index_selector::operator()(const std::string& filter,
+                                const table_slice& x) const {
+  return filter == x.layout().name();
+}
+
 vast::path index_state::partition_path(const uuid& id) const {
   return dir / to_string(id);
 }
 
+const active_partition_info*
+index_state::find_active_partition(const uuid& id) const {
+  for (auto& [_, active] : active_partitions)
+    if (active.actor != nullptr && active.id == id)
+      return &active;
+  return nullptr;
+}
+
 partition_actor partition_factory::operator()(const uuid& id) const {
   // Load partition from disk.
   VAST_ASSERT(std::find(state_.persisted_partitions.begin(),
@@ -103,7 +121,14 @@ partition_actor partition_factory::operator()(const uuid& id) const {
               != state_.persisted_partitions.end());
   auto path = state_.partition_path(id);
   VAST_DEBUG(state_.self, "loads partition", id, "for path", path);
-  return state_.self->spawn(passive_partition, id, filesystem_, path);
+  auto& handle = state_.partition_files[id];
+  auto file = handle.lock();
+  if (!file) {
+    file = std::make_shared<partition_file>(std::move(path));
+    handle = file;
+  }
+  return state_.self->spawn(passive_partition, id, filesystem_,
+                            std::move(file));
 }
 
 filesystem_actor& partition_factory::filesystem() {
@@ -114,10 +139,83 @@ partition_factory::partition_factory(index_state& state) : state_{state} {
   // nop
 }
 
+partition_weigher::partition_weigher(const index_state& state)
+  : state_{state} {
+  // nop
+}
+
+size_t partition_weigher::operator()(const uuid& id,
+                                     const partition_actor&) const {
+  // A passive partition holds its partition flatbuffer in memory and reads
+  // value indexes only on demand. We avoid a blocking stat of the file here;
+  // partitions whose synopsis was not loaded yet weigh nothing until then.
+  auto i = state_.partition_sizes.find(id);
+  return i != state_.partition_sizes.end() ? i->second : 0;
+}
+
 index_state::index_state(index_actor::pointer self)
-  : self{self}, inmem_partitions{0, partition_factory{*this}} {
+  : self{self},
+    inmem_partitions{0, partition_factory{*this}, partition_weigher{*this}} {
 }
 
+namespace {
+
+/// Reads the synopsis of a persisted partition. Also reads the IDs of its
+/// events if the partition is small enough to be merged with others.
+caf::error load_synopsis(const path& filename, size_t partition_capacity,
+                         partition_synopsis& synopsis,
+                         undersized_partition_info& undersized,
+                         uint64_t& flatbuffer_size) {
+  auto chunk = chunk::mmap(filename);
+  if (!chunk)
+    return make_error(ec::filesystem_error, "failed to mmap partition",
+                      filename.str());
+  // Partition files of older versions contain their value indexes inline.
+  auto size = partition_flatbuffer_size(as_bytes(chunk));
+  if (!size)
+    return size.error();
+  flatbuffer_size = *size != 0 ? *size : chunk->size();
+  // Mapping the whole file only faults in the pages of the partition
+  // flatbuffer at its beginning, but not the value indexes after it.
+  auto partition = partition_flatbuffer(as_bytes(chunk));
+  if (!partition
+      || partition->partition_type() != fbs::partition::Partition::v0)
+    return make_error(ec::format_error, "unsupported partition version");
+  auto partition_v0 = partition->partition_as_v0();
+  VAST_ASSERT(partition_v0);
+  if (auto err = unpack(*partition_v0, synopsis))
+    return err;
+  // Remember small partitions of a single layout for compaction.
+  auto type_ids = partition_v0->type_ids();
+  if (type_ids && type_ids->size() == 1
+      && partition_v0->events() * 2 <= partition_capacity) {
+    auto type_id = type_ids->Get(0);
+    if (auto err = fbs::deserialize_bytes(type_id->ids(), undersized.ids))
+      return err;
+    undersized.layout = type_id->name()->str();
+  }
+  return caf::none;
+}
+
+/// Reads synopses of persisted partitions on behalf of the INDEX.
+caf::behavior synopsis_loader(size_t partition_capacity) {
+  return {
+    [=](atom::load, const path& filename)
+      -> caf::result<std::shared_ptr<partition_synopsis>,
+                     undersized_partition_info, uint64_t> {
+      auto synopsis = std::make_shared<partition_synopsis>();
+      auto undersized = undersized_partition_info{};
+      auto flatbuffer_size = uint64_t{0};
+      if (auto err = load_synopsis(filename, partition_capacity, *synopsis,
+                                   undersized, flatbuffer_size))
+        return err;
+      return {std::move(synopsis), std::move(undersized), flatbuffer_size};
+    },
+  };
+}
+
+} // namespace
+
 caf::error index_state::load_from_disk() {
   // We dont use the filesystem actor here because this function is only
   // called once during startup, when no other actors exist yet.
@@ -125,6 +223,10 @@ caf::error index_state::load_from_disk() {
     VAST_VERBOSE(self, "found no prior state, starting with a clean slate");
     return caf::none;
   }
+  // The partitions of the last checkpoint, updated by the journal.
+  std::unordered_set<uuid> partitions;
+  // The partitions that merged partitions replaced according to the journal.
+  std::vector<uuid> replaced_partitions;
   if (auto fname = index_filename(); exists(fname)) {
     VAST_VERBOSE(self, "loads state from", fname);
     auto buffer = io::read(fname);
@@ -144,32 +246,7 @@ caf::error index_state::load_from_disk() {
       VAST_ASSERT(uuid_fb);
       vast::uuid partition_uuid;
       unpack(*uuid_fb, partition_uuid);
-      auto partition_path = dir / to_string(partition_uuid);
-      if (exists(partition_path)) {
-        persisted_partitions.insert(partition_uuid);
-        // Use blocking operations here since this is part of the startup.
-        auto chunk = chunk::mmap(partition_path);
-        if (!chunk) {
-          VAST_WARNING(self, "could not mmap partition at", partition_path);
-          continue;
-        }
-        auto partition = fbs::GetPartition(chunk->data());
-        if (partition->partition_type() != fbs::partition::Partition::v0) {
-          VAST_WARNING(self, "found unsupported version for partition",
-                       partition_uuid);
-          continue;
-        }
-        auto partition_v0 = partition->partition_as_v0();
-        VAST_ASSERT(partition_v0);
-        partition_synopsis ps;
-        unpack(*partition_v0, ps);
-        VAST_DEBUG(self, "merging partition synopsis from", partition_uuid);
-        meta_idx.merge(partition_uuid, std::move(ps));
-      } else {
-        VAST_WARNING(self, "found partition", partition_uuid,
-                     "in the index state but not on disk; this may have been "
-                     "caused by an unclean shutdown");
-      }
+      partitions.insert(partition_uuid);
     }
     auto stats = index_v0->stats();
     if (!stats)
@@ -178,13 +255,201 @@ caf::error index_state::load_from_disk() {
       this->stats.layouts[stat->name()->str()]
         = layout_statistics{stat->count()};
     }
-  } else {
+    journal_generation = index_v0->journal_generation();
+  } else if (!exists(journal_filename())) {
     VAST_WARNING(self, "found existing database dir", dir,
                  "without index statefile, will start with fresh state");
   }
+  // Replay the journal entries that were appended after the checkpoint.
+  if (auto fname = journal_filename(); exists(fname)) {
+    VAST_VERBOSE(self, "replays journal from", fname);
+    auto buffer = io::read(fname);
+    if (!buffer) {
+      VAST_ERROR(self, "failed to read index journal:",
+                 render(buffer.error()));
+      return buffer.error();
+    }
+    constexpr auto prefix_size = sizeof(flatbuffers::uoffset_t);
+    auto bytes = span<const byte>{*buffer};
+    size_t replayed = 0;
+    while (bytes.size() >= prefix_size) {
+      auto data = reinterpret_cast<const uint8_t*>(bytes.data());
+      auto size = prefix_size + flatbuffers::GetPrefixedSize(data);
+      if (size > bytes.size())
+        break;
+      flatbuffers::Verifier verifier{data, size};
+      if (!verifier.VerifySizePrefixedBuffer<fbs::index_journal_entry::v0>(
+            nullptr))
+        break;
+      index_journal_entry entry;
+      auto entry_fb
+        = flatbuffers::GetSizePrefixedRoot<fbs::index_journal_entry::v0>(data);
+      if (auto err = unpack(*entry_fb, entry))
+        break;
+      bytes = bytes.subspan(size);
+      // Entries of older generations are already part of the checkpoint.
+      if (entry.generation < journal_generation)
+        continue;
+      if (entry.erased)
+        partitions.erase(entry.partition);
+      else
+        partitions.insert(entry.partition);
+      for (auto& id : entry.replaced) {
+        partitions.erase(id);
+        replaced_partitions.push_back(id);
+      }
+      this->stats = std::move(entry.stats);
+      ++replayed;
+    }
+    // A crash while appending to the journal leaves an incomplete entry at its
+    // end, which never made it into the state.
+    if (!bytes.empty())
+      VAST_WARNING(self, "discards", bytes.size(),
+                   "bytes of an incomplete journal entry; this may have been "
+                   "caused by an unclean shutdown");
+    VAST_VERBOSE(self, "replayed", replayed, "journal entries");
+  }
+  // A crash right after writing a swap leaves the replaced partitions behind.
+  for (auto& id : replaced_partitions) {
+    auto path = partition_path(id);
+    if (!partitions.count(id) && exists(path) && !rm(path))
+      VAST_WARNING(self, "could not unlink replaced partition at", path);
+  }
+  for (auto& partition_uuid : partitions) {
+    if (exists(partition_path(partition_uuid)))
+      persisted_partitions.insert(partition_uuid);
+    else
+      VAST_WARNING(self, "found partition", partition_uuid,
+                   "in the index state but not on disk; this may have been "
+                   "caused by an unclean shutdown");
+  }
+  // Fold the replayed journal into a new checkpoint, such that we never
+  // append to a journal that ends with an incomplete entry.
+  if (auto fname = journal_filename(); exists(fname)) {
+    ++journal_generation;
+    auto builder = flatbuffers::FlatBufferBuilder{};
+    auto index = pack(builder, *this);
+    if (!index)
+      return index.error();
+    auto chunk = fbs::release(builder);
+    if (auto err = io::save(index_filename(), as_bytes(chunk)))
+      return err;
+    if (!rm(fname))
+      VAST_WARNING(self, "could not unlink index journal at", fname);
+  }
   return caf::none;
 }
 
+void index_state::load_synopses(size_t num_loaders) {
+  synopsis_queue.assign(persisted_partitions.begin(),
+                        persisted_partitions.end());
+  pending_synopses = synopsis_queue.size();
+  if (synopsis_queue.empty())
+    return;
+  VAST_VERBOSE(self, "loads the synopses of", synopsis_queue.size(),
+               "partitions");
+  for (auto& id : synopsis_queue)
+    add_pending_synopsis(id, {});
+  num_loaders = std::clamp(num_loaders, size_t{1}, synopsis_queue.size());
+  for (size_t i = 0; i < num_loaders; ++i)
+    load_next_synopsis(
+      self->spawn<caf::detached>(synopsis_loader, partition_capacity));
+}
+
+void index_state::load_next_synopsis(caf::actor loader) {
+  if (synopsis_queue.empty()) {
+    self->send_exit(loader, caf::exit_reason::user_shutdown);
+    return;
+  }
+  auto id = synopsis_queue.back();
+  synopsis_queue.pop_back();
+  self->request(loader, caf::infinite, atom::load_v, partition_path(id))
+    .then(
+      [=](std::shared_ptr<partition_synopsis>& synopsis,
+          undersized_partition_info& undersized, uint64_t flatbuffer_size) {
+        --pending_synopses;
+        // The partition may have been erased in the meantime.
+        if (persisted_partitions.count(id) > 0) {
+          VAST_DEBUG(self, "merging partition synopsis from", id);
+          partition_sizes[id] = flatbuffer_size;
+          merge_synopsis(id, std::move(synopsis));
+          if (!undersized.layout.empty())
+            undersized_partitions[id] = std::move(undersized);
+        }
+        load_next_synopsis(loader);
+      },
+      [=](const caf::error& err) {
+        --pending_synopses;
+        VAST_WARNING(self, "failed to load the synopsis of partition", id,
+                     "with error:", render(err));
+        erase_synopsis(id);
+        load_next_synopsis(loader);
+      });
+}
+
+const meta_index_actor&
+index_state::meta_index_shard_for(const uuid& partition) const {
+  VAST_ASSERT(!meta_index_shards.empty());
+  auto i = std::hash<uuid>{}(partition) % meta_index_shards.size();
+  return meta_index_shards[i];
+}
+
+void index_state::add_pending_synopsis(const uuid& partition,
+                                       std::string layout) {
+  self->send(meta_index_shard_for(partition), atom::add_v, partition,
+             std::move(layout));
+}
+
+void index_state::merge_synopsis(
+  const uuid& partition, std::shared_ptr<partition_synopsis> synopsis) {
+  synopsis_sizes[partition] = synopsis->size_bytes();
+  self->send(meta_index_shard_for(partition), atom::replace_v, partition,
+             std::move(synopsis));
+}
+
+void index_state::erase_synopsis(const uuid& partition) {
+  synopsis_sizes.erase(partition);
+  self->send(meta_index_shard_for(partition), atom::erase_v, partition);
+}
+
+void index_state::lookup_candidates(
+  const expression& expr,
+  std::function<void(caf::expected<std::vector<uuid>>)> f) {
+  VAST_ASSERT(!meta_index_shards.empty());
+  // Every shard holds a disjoint set of partitions, so the candidates are the
+  // union of the candidates of all shards.
+  struct merge_state {
+    std::vector<uuid> candidates;
+    size_t remaining;
+    bool failed = false;
+  };
+  auto st = std::make_shared<merge_state>();
+  st->remaining = meta_index_shards.size();
+  ++candidate_lookups;
+  auto done = [=](caf::expected<std::vector<uuid>> candidates) {
+    --candidate_lookups;
+    f(std::move(candidates));
+    // Resume a merge that waited for the lookups to complete.
+    if (candidate_lookups == 0 && compaction && compaction->persisted)
+      finish_compaction();
+  };
+  for (auto& shard : meta_index_shards)
+    self->request(shard, caf::infinite, expr)
+      .then(
+        [=](std::vector<uuid>& xs) {
+          if (st->failed)
+            return;
+          detail::inplace_unify(st->candidates, xs);
+          if (--st->remaining == 0)
+            done(std::move(st->candidates));
+        },
+        [=](caf::error& err) {
+          if (std::exchange(st->failed, true))
+            return;
+          done(std::move(err));
+        });
+}
+
 bool index_state::worker_available() {
   return !idle_workers.empty();
 }
@@ -222,7 +487,16 @@ index_state::status(status_verbosity v) const {
   auto result = caf::settings{};
   auto& index_status = put_dictionary(result, "index");
   if (v >= status_verbosity::info) {
-    // nop
+    auto& cache = put_dictionary(index_status, "partition-cache");
+    put(cache, "memory-usage", inmem_partitions.weight());
+    put(cache, "capacity", inmem_partitions.max_size());
+    if (v >= status_verbosity::detailed) {
+      const auto& counters = inmem_partitions.statistics();
+      auto& statistics = put_dictionary(cache, "statistics");
+      put(statistics, "hits", counters.hits);
+      put(statistics, "misses", counters.misses);
+      put(statistics, "evictions", counters.evictions);
+    }
   }
   if (v >= status_verbosity::detailed) {
     auto& stats_object = put_dictionary(index_status, "statistics");
@@ -235,13 +509,23 @@ index_state::status(status_verbosity v) const {
       // Hence the fallback to low-level primitives.
       layout_object.insert_or_assign(name, std::move(xs));
     }
-    put(stats_object, "meta-index-bytes", meta_idx.size_bytes());
+    auto meta_index_bytes = size_t{0};
+    for (auto& [_, size] : synopsis_sizes)
+      meta_index_bytes += size;
+    put(stats_object, "meta-index-bytes", meta_index_bytes);
+    auto& journal = put_dictionary(index_status, "journal");
+    put(journal, "generation", journal_generation);
+    put(journal, "entries-since-checkpoint", journal_entries);
+    put(index_status, "undersized-partitions", undersized_partitions.size());
+    put(index_status, "pending-synopses", pending_synopses);
   }
   if (v >= status_verbosity::debug) {
     // Resident partitions.
     auto& partitions = put_dictionary(index_status, "partitions");
-    if (active_partition.actor != nullptr)
-      partitions.emplace("active", to_string(active_partition.id));
+    auto& active = put_list(partitions, "active");
+    for (auto& [_, partition] : active_partitions)
+      if (partition.actor != nullptr)
+        active.emplace_back(to_string(partition.id));
     auto& cached = put_list(partitions, "cached");
     for (auto& kv : inmem_partitions)
       cached.emplace_back(to_string(kv.first));
@@ -263,8 +547,7 @@ index_state::collect_query_actors(query_state& lookup,
     return result;
   // Prefer partitions that are already available in RAM.
   auto partition_is_loaded = [&](const uuid& candidate) {
-    return (active_partition.actor != nullptr
-            && active_partition.id == candidate)
+    return find_active_partition(candidate) != nullptr
            || unpersisted.count(candidate)
            || inmem_partitions.contains(candidate);
   };
@@ -275,9 +558,8 @@ index_state::collect_query_actors(query_state& lookup,
     // We need to first check whether the ID is the active partition or one
     // of our unpersisted ones. Only then can we dispatch to our LRU cache.
     partition_actor part;
-    if (active_partition.actor != nullptr
-        && active_partition.id == partition_id)
-      part = active_partition.actor;
+    if (auto active = find_active_partition(partition_id))
+      part = active->actor;
     else if (auto it = unpersisted.find(partition_id); it != unpersisted.end())
       part = it->second;
     else if (auto it = persisted_partitions.find(partition_id);
@@ -368,6 +650,73 @@ path index_state::index_filename(path basename) const {
   return basename / dir / "index.bin";
 }
 
+path index_state::journal_filename(path basename) const {
+  return basename / dir / "index.journal";
+}
+
+namespace {
+
+std::vector<flatbuffers::Offset<fbs::layout_statistics::v0>>
+pack_stats(flatbuffers::FlatBufferBuilder& builder,
+           const index_statistics& stats) {
+  std::vector<flatbuffers::Offset<fbs::layout_statistics::v0>> result;
+  for (auto& [name, layout_stats] : stats.layouts) {
+    auto name_fb = builder.CreateString(name);
+    fbs::layout_statistics::v0Builder stats_builder(builder);
+    stats_builder.add_name(name_fb);
+    stats_builder.add_count(layout_stats.count);
+    result.push_back(stats_builder.Finish());
+  }
+  return result;
+}
+
+} // namespace
+
+caf::expected<flatbuffers::Offset<fbs::index_journal_entry::v0>>
+pack(flatbuffers::FlatBufferBuilder& builder, const index_journal_entry& x) {
+  auto partition = pack(builder, x.partition);
+  if (!partition)
+    return partition.error();
+  auto stats = builder.CreateVector(pack_stats(builder, x.stats));
+  std::vector<flatbuffers::Offset<fbs::uuid::v0>> replaced_offsets;
+  for (auto& id : x.replaced) {
+    if (auto id_fb = pack(builder, id))
+      replaced_offsets.push_back(*id_fb);
+    else
+      return id_fb.error();
+  }
+  auto replaced = builder.CreateVector(replaced_offsets);
+  fbs::index_journal_entry::v0Builder entry_builder(builder);
+  entry_builder.add_generation(x.generation);
+  entry_builder.add_partition(*partition);
+  entry_builder.add_erased(x.erased);
+  entry_builder.add_stats(stats);
+  entry_builder.add_replaced(replaced);
+  return entry_builder.Finish();
+}
+
+caf::error unpack(const fbs::index_journal_entry::v0& x,
+                  index_journal_entry& y) {
+  if (!x.partition() || !x.stats())
+    return make_error(ec::format_error, "incomplete index journal entry");
+  y.generation = x.generation();
+  if (auto err = unpack(*x.partition(), y.partition))
+    return err;
+  y.erased = x.erased();
+  y.stats.layouts.clear();
+  for (const auto stat : *x.stats())
+    y.stats.layouts[stat->name()->str()] = layout_statistics{stat->count()};
+  y.replaced.clear();
+  // Entries written before swaps existed lack the field.
+  if (x.replaced()) {
+    for (const auto id : *x.replaced()) {
+      if (auto err = unpack(*id, y.replaced.emplace_back()))
+        return err;
+    }
+  }
+  return caf::none;
+}
+
 caf::expected<flatbuffers::Offset<fbs::Index>>
 pack(flatbuffers::FlatBufferBuilder& builder, const index_state& state) {
   VAST_DEBUG(state.self, "persists", state.persisted_partitions.size(),
@@ -391,19 +740,11 @@ pack(flatbuffers::FlatBufferBuilder& builder, const index_state& state) {
       return uuid_fb.error();
   }
   auto partitions = builder.CreateVector(partition_offsets);
-  std::vector<flatbuffers::Offset<fbs::layout_statistics::v0>> stats_offsets;
-  for (auto& [name, layout_stats] : state.stats.layouts) {
-    auto name_fb = builder.CreateString(name);
-    fbs::layout_statistics::v0Builder stats_builder(builder);
-    stats_builder.add_name(name_fb);
-    stats_builder.add_count(layout_stats.count);
-    auto offset = stats_builder.Finish();
-    stats_offsets.push_back(offset);
-  }
-  auto stats = builder.CreateVector(stats_offsets);
+  auto stats = builder.CreateVector(pack_stats(builder, state.stats));
   fbs::index::v0Builder v0_builder(builder);
   v0_builder.add_partitions(partitions);
   v0_builder.add_stats(stats);
+  v0_builder.add_journal_generation(state.journal_generation);
   auto index_v0 = v0_builder.Finish();
   fbs::IndexBuilder index_builder(builder);
   index_builder.add_index_type(vast::fbs::index::Index::v0);
@@ -413,44 +754,325 @@ pack(flatbuffers::FlatBufferBuilder& builder, const index_state& state) {
   return index;
 }
 
-/// Persists the state to disk.
 void index_state::flush_to_disk() {
+  ++journal_generation;
+  journal_entries = 0;
   auto builder = flatbuffers::FlatBufferBuilder{};
   auto index = pack(builder, *this);
   if (!index) {
     VAST_WARNING(self, "failed to pack index:", render(index.error()));
     return;
   }
-  auto chunk = fbs::release(builder);
-  self
-    ->request(caf::actor_cast<caf::actor>(filesystem), caf::infinite,
-              atom::write_v, index_filename(), chunk)
-    .then(
-      [=](atom::ok) { VAST_DEBUG(self, "successfully persisted index state"); },
-      [=](const caf::error& err) {
-        VAST_WARNING(self, "failed to persist index state:", render(err));
-      });
+  // The checkpoint already contains the changes of the buffered entries.
+  journal_buffer.clear();
+  checkpoint = fbs::release(builder);
+  flush_journal();
+}
+
+void index_state::append_to_journal(const uuid& partition, bool erased,
+                                    std::vector<uuid> replaced) {
+  auto entry = index_journal_entry{journal_generation, partition, erased,
+                                   stats, std::move(replaced)};
+  auto builder = flatbuffers::FlatBufferBuilder{};
+  auto offset = pack(builder, entry);
+  if (!offset) {
+    VAST_WARNING(self, "failed to pack journal entry:",
+                 render(offset.error()));
+    flush_to_disk();
+    return;
+  }
+  builder.FinishSizePrefixed(*offset);
+  auto first = reinterpret_cast<const char*>(builder.GetBufferPointer());
+  journal_buffer.insert(journal_buffer.end(), first, first + builder.GetSize());
+  if (++journal_entries >= defaults::system::index_checkpoint_interval)
+    flush_to_disk();
+  else
+    flush_journal();
+}
+
+void index_state::flush_journal() {
+  if (journal_in_flight)
+    return;
+  auto on_ok = [=](atom::ok) {
+    journal_in_flight = false;
+    flush_journal();
+  };
+  auto on_error = [=](const caf::error& err) {
+    VAST_WARNING(self, "failed to persist index state:", render(err));
+    journal_in_flight = false;
+    // The journal may now lack entries, so the next entry must come with a
+    // checkpoint.
+    journal_entries = defaults::system::index_checkpoint_interval;
+  };
+  // Unlink the obsolete files only after the journal entries that refer to
+  // them are on disk.
+  if (!journal_in_flight && !checkpoint && journal_buffer.empty())
+    for (auto& partition : std::exchange(obsolete_partitions, {}))
+      unlink_partition(partition);
+  if (checkpoint) {
+    journal_in_flight = true;
+    self
+      ->request(filesystem, caf::infinite, atom::write_v, index_filename(),
+                std::exchange(checkpoint, {}))
+      .then(
+        [=](atom::ok) {
+          VAST_DEBUG(self, "successfully persisted index state");
+          // Replacing the journal drops the entries of older generations and
+          // keeps those that arrived while writing the checkpoint.
+          auto chunk = chunk::make(std::exchange(journal_buffer, {}));
+          self
+            ->request(filesystem, caf::infinite, atom::write_v,
+                      journal_filename(), std::move(chunk))
+            .then(on_ok, on_error);
+        },
+        on_error);
+  } else if (!journal_buffer.empty()) {
+    journal_in_flight = true;
+    auto chunk = chunk::make(std::exchange(journal_buffer, {}));
+    self
+      ->request(filesystem, caf::infinite, atom::append_v, journal_filename(),
+                std::move(chunk))
+      .then(on_ok, on_error);
+  }
+}
+
+void index_state::unlink_partition(const uuid& partition) {
+  // Passive partitions read their value indexes from the file on demand, so
+  // the last of them removes the file instead.
+  if (auto i = partition_files.find(partition); i != partition_files.end()) {
+    auto file = i->second.lock();
+    partition_files.erase(i);
+    if (file) {
+      VAST_DEBUG(self, "defers unlinking partition", partition,
+                 "until it is unloaded");
+      file->obsolete = true;
+      return;
+    }
+  }
+  auto path = partition_path(partition);
+  if (!rm(path))
+    VAST_WARNING(self, "could not unlink partition at", path);
+}
+
+namespace {
+
+struct partition_compactor_state {
+  /// The events of the merged partitions.
+  std::vector<table_slice> slices;
+
+  /// The number of events in `slices`.
+  uint64_t events = 0;
+
+  /// Delivers the number of events once the archive sent all of them.
+  caf::typed_response_promise<uint64_t> promise;
+
+  static inline const char* name = "partition-compactor";
+};
+
+/// Reads the events with the given IDs from the ARCHIVE and streams them into
+/// a fresh partition.
+caf::behavior
+partition_compactor(caf::stateful_actor<partition_compactor_state>* self,
+                    archive_actor archive, active_partition_actor partition,
+                    vast::ids xs) {
+  return {
+    [=](atom::run) {
+      self->state.promise = self->make_response_promise<uint64_t>();
+      self->send(archive, atom::exporter_v, caf::actor_cast<caf::actor>(self));
+      self->send(archive, xs, caf::actor_cast<archive_client_actor>(self));
+      return self->state.promise;
+    },
+    [=](table_slice& slice) {
+      self->state.events += slice.rows();
+      self->state.slices.push_back(std::move(slice));
+    },
+    [=](atom::done, const caf::error& err) {
+      auto& st = self->state;
+      if (err && err != ec::no_error) {
+        st.promise.deliver(err);
+      } else if (st.slices.empty()) {
+        st.promise.deliver(
+          make_error(ec::lookup_error, "archive has no events to merge"));
+      } else {
+        detail::spawn_container_source(self->system(), std::move(st.slices),
+                                       partition);
+        st.promise.deliver(st.events);
+      }
+      self->quit();
+    },
+  };
+}
+
+} // namespace
+
+void index_state::compact() {
+  if (!archive)
+    return;
+  if (compaction) {
+    if (compaction->persisted)
+      finish_compaction();
+    return;
+  }
+  auto limit = compaction_budget > 0
+                 ? std::min(compaction_budget, partition_capacity)
+                 : partition_capacity;
+  // Merge the smallest partitions of a layout first.
+  std::unordered_map<std::string, std::vector<std::pair<uint64_t, uuid>>>
+    candidates;
+  for (auto& [id, info] : undersized_partitions)
+    candidates[info.layout].emplace_back(rank(info.ids), id);
+  for (auto& [layout, xs] : candidates) {
+    std::sort(xs.begin(), xs.end());
+    std::vector<uuid> sources;
+    uint64_t events = 0;
+    for (auto& [n, id] : xs) {
+      if (events + n > limit)
+        break;
+      events += n;
+      sources.push_back(id);
+    }
+    if (sources.size() < 2)
+      continue;
+    auto& c = compaction.emplace();
+    c.id = uuid::random();
+    c.layout = layout;
+    c.sources = std::move(sources);
+    for (auto& source : c.sources)
+      c.ids |= undersized_partitions[source].ids;
+    VAST_VERBOSE(self, "merges", c.sources.size(), "partitions with", events,
+                 "events of layout", layout, "into partition", c.id);
+    caf::settings index_opts;
+    index_opts["cardinality"] = partition_capacity;
+    auto part = self->spawn(active_partition, c.id, filesystem, index_opts,
+                            synopsis_options, indexing_workers);
+    auto compactor = self->spawn(partition_compactor, archive, part, c.ids);
+    auto on_error = [=](const caf::error& err) {
+      VAST_WARNING(self, "failed to merge partitions:", render(err));
+      // Do not attempt to merge the same partitions over and over again.
+      if (compaction)
+        for (auto& source : compaction->sources)
+          undersized_partitions.erase(source);
+      compaction.reset();
+      self->send_exit(part, caf::exit_reason::user_shutdown);
+    };
+    auto part_dir = partition_path(c.id);
+    self->request(compactor, caf::infinite, atom::run_v)
+      .then(
+        [=](uint64_t events) {
+          self->request(part, caf::infinite, atom::persist_v, part_dir, self)
+            .then(
+              [=](uint64_t flatbuffer_size) {
+                VAST_ASSERT(compaction);
+                partition_sizes[compaction->id] = flatbuffer_size;
+                compaction->events = events;
+                compaction->persisted = true;
+                finish_compaction();
+              },
+              on_error);
+        },
+        on_error);
+    return;
+  }
+}
+
+void index_state::finish_compaction() {
+  VAST_ASSERT(compaction && compaction->persisted);
+  auto& c = *compaction;
+  // The partition sends its synopsis separately from the persist response.
+  if (!c.synopsis)
+    return;
+  // Partitions erased during the merge would resurrect with the merged
+  // partition, so we discard it.
+  for (auto& source : c.sources) {
+    if (persisted_partitions.count(source) == 0) {
+      VAST_DEBUG(self, "discards merged partition", c.id,
+                 "because it contains erased partition", source);
+      obsolete_partitions.push_back(c.id);
+      partition_sizes.erase(c.id);
+      compaction.reset();
+      flush_journal();
+      return;
+    }
+  }
+  // Lookups in flight may still return the merged partitions as candidates,
+  // so we wait until they are done.
+  if (candidate_lookups > 0) {
+    VAST_DEBUG(self, "defers replacing merged partitions of partition", c.id,
+               "due to candidate lookups in flight");
+    return;
+  }
+  // Queries that already evaluated some of the merged partitions would get
+  // their results twice, so we wait until they are done.
+  for (auto& [_, query] : pending) {
+    for (auto& source : c.sources) {
+      auto& xs = query.partitions;
+      if (std::find(xs.begin(), xs.end(), source) != xs.end()) {
+        VAST_DEBUG(self, "defers replacing merged partitions of partition",
+                   c.id, "due to pending queries");
+        return;
+      }
+    }
+  }
+  VAST_DEBUG(self, "replaces", c.sources.size(), "partitions with", c.id);
+  for (auto& source : c.sources) {
+    persisted_partitions.erase(source);
+    partition_sizes.erase(source);
+    undersized_partitions.erase(source);
+    inmem_partitions.drop(source);
+    erase_synopsis(source);
+    obsolete_partitions.push_back(source);
+  }
+  persisted_partitions.insert(c.id);
+  merge_synopsis(c.id,
+                 std::shared_ptr<partition_synopsis>{std::move(c.synopsis)});
+  // The archive may have erased some events in the meantime.
+  auto expected = rank(c.ids);
+  if (expected > c.events)
+    stats.layouts[c.layout].count -= expected - c.events;
+  if (c.events * 2 <= partition_capacity)
+    undersized_partitions[c.id]
+      = undersized_partition_info{c.layout, std::move(c.ids)};
+  auto merged = std::exchange(compaction, std::nullopt);
+  // A single journal entry records the swap, such that a crash cannot leave
+  // both the merged partition and its sources behind. The entry must reach
+  // the disk before we unlink the sources, which flush_journal takes care of.
+  append_to_journal(merged->id, false, std::move(merged->sources));
 }
 
 index_actor::behavior_type
 index(index_actor::stateful_pointer<index_state> self,
       filesystem_actor filesystem, path dir, size_t partition_capacity,
-      size_t max_inmem_partitions, size_t taste_partitions,
-      size_t num_workers) {
+      size_t partition_cache_size, size_t taste_partitions,
+      size_t num_workers, size_t indexing_workers,
+      duration partition_window, size_t max_active_partitions,
+      duration active_partition_timeout, size_t compaction_budget,
+      size_t synopsis_loaders, bool lazy_synopses, size_t meta_index_shards) {
   VAST_TRACE(VAST_ARG(filesystem), VAST_ARG(dir), VAST_ARG(partition_capacity),
-             VAST_ARG(max_inmem_partitions), VAST_ARG(taste_partitions),
-             VAST_ARG(num_workers));
+             VAST_ARG(partition_cache_size), VAST_ARG(taste_partitions),
+             VAST_ARG(num_workers), VAST_ARG(indexing_workers),
+             VAST_ARG(partition_window), VAST_ARG(max_active_partitions),
+             VAST_ARG(active_partition_timeout), VAST_ARG(compaction_budget),
+             VAST_ARG(synopsis_loaders), VAST_ARG(lazy_synopses),
+             VAST_ARG(meta_index_shards));
   VAST_VERBOSE(self, "initializes index in", dir,
                "with a maximum partition size of", partition_capacity,
-               "events and", max_inmem_partitions, "resident partitions");
+               "events and", partition_cache_size,
+               "bytes of resident partitions");
   // Set members.
   self->state.self = self;
   self->state.filesystem = std::move(filesystem);
   self->state.dir = dir;
   self->state.partition_capacity = partition_capacity;
   self->state.taste_partitions = taste_partitions;
+  self->state.indexing_workers = indexing_workers;
+  self->state.partition_window = partition_window;
+  self->state.max_active_partitions
+    = std::max(size_t{1}, max_active_partitions);
+  self->state.active_partition_timeout = active_partition_timeout;
+  self->state.compaction_budget = compaction_budget;
+  self->state.lazy_synopses = lazy_synopses;
   self->state.inmem_partitions.factory().filesystem() = self->state.filesystem;
-  self->state.inmem_partitions.resize(max_inmem_partitions);
+  self->state.inmem_partitions.resize(partition_cache_size);
   // Read persistent state.
   if (auto err = self->state.load_from_disk()) {
     VAST_ERROR(self, "failed to load index state from disk:", render(err));
@@ -458,26 +1080,57 @@ index(index_actor::stateful_pointer<index_state> self,
     return index_actor::behavior_type::make_empty_behavior();
   }
   // This option must be kept in sync with vast/address_synopsis.hpp.
-  put(self->state.meta_idx.factory_options(), "max-partition-size",
-      partition_capacity);
-  // Creates a new active partition and updates index state.
-  auto create_active_partition = [=] {
+  put(self->state.synopsis_options, "max-partition-size", partition_capacity);
+  // Spread the synopses over multiple actors such that candidate lookups run
+  // in parallel and do not block the INDEX.
+  for (size_t i = 0; i < std::max(size_t{1}, meta_index_shards); ++i)
+    self->state.meta_index_shards.push_back(self->spawn(meta_index_shard));
+  self->state.load_synopses(synopsis_loaders);
+  // Creates a new active partition for a layout and updates index state.
+  auto create_active_partition = [=](const std::string& layout) {
     auto id = uuid::random();
     caf::settings index_opts;
     index_opts["cardinality"] = partition_capacity;
     auto part = self->spawn(active_partition, id, self->state.filesystem,
-                            index_opts, self->state.meta_idx.factory_options());
+                            index_opts, self->state.synopsis_options,
+                            self->state.indexing_workers);
     auto slot = self->state.stage->add_outbound_path(part);
-    self->state.active_partition.actor = part;
-    self->state.active_partition.stream_slot = slot;
-    self->state.active_partition.capacity = partition_capacity;
-    self->state.active_partition.id = id;
-    VAST_DEBUG(self, "created new partition", id);
+    self->state.stage->out().set_filter(slot, layout);
+    auto& active = self->state.active_partitions[layout];
+    active.actor = part;
+    active.stream_slot = slot;
+    active.capacity = partition_capacity;
+    active.id = id;
+    active.ids = {};
+    // Align the time window with multiples of its length, such that the
+    // partitions of all layouts cover the same time ranges.
+    if (partition_window > duration::zero()) {
+      vast::time now = std::chrono::system_clock::now();
+      auto since_epoch = now.time_since_epoch();
+      active.window_end
+        = vast::time{since_epoch - since_epoch % partition_window
+                     + partition_window};
+      // Roll over idle partitions as well, which would otherwise stay active
+      // until the next slice of their layout arrives.
+      self->delayed_send(self, active.window_end - now, atom::persist_v,
+                         layout, id);
+    }
+    // Persist the partition once its layout no longer arrives, even if there
+    // is no time window.
+    active.idle = true;
+    if (active_partition_timeout > duration::zero())
+      self->delayed_send(self, active_partition_timeout, atom::wakeup_v, layout,
+                         id);
+    // The partition builds the synopses for its events and hands them over
+    // once it persists; until then the meta index only knows its layout.
+    self->state.add_pending_synopsis(id, layout);
+    VAST_DEBUG(self, "created new partition", id, "for layout", layout);
   };
-  auto decomission_active_partition = [=] {
-    auto& active = self->state.active_partition;
+  auto decomission_active_partition = [=](const std::string& layout,
+                                          active_partition_info& active) {
     auto id = active.id;
     auto actor = std::exchange(active.actor, {});
+    auto ids = std::exchange(active.ids, {});
     self->state.unpersisted[id] = actor;
     // Send buffered batches.
     self->state.stage->out().fan_out_flush();
@@ -489,10 +1142,15 @@ index(index_actor::stateful_pointer<index_state> self,
     VAST_DEBUG(self, "persists active partition to", part_dir);
     self->request(actor, caf::infinite, atom::persist_v, part_dir, self)
       .then(
-        [=](atom::ok) {
+        [=](uint64_t flatbuffer_size) {
           VAST_DEBUG(self, "successfully persisted partition", id);
           self->state.unpersisted.erase(id);
           self->state.persisted_partitions.insert(id);
+          self->state.partition_sizes[id] = flatbuffer_size;
+          self->state.append_to_journal(id, false);
+          if (rank(ids) * 2 <= self->state.partition_capacity)
+            self->state.undersized_partitions[id]
+              = undersized_partition_info{layout, ids};
         },
         [=](const caf::error& err) {
           VAST_ERROR(self, "failed to persist partition", id,
@@ -508,18 +1166,50 @@ index(index_actor::stateful_pointer<index_state> self,
       VAST_ASSERT(x.encoding() != table_slice::encoding::none);
       auto&& layout = x.layout();
       self->state.stats.layouts[layout.name()].count += x.rows();
-      auto& active = self->state.active_partition;
+      auto& active = self->state.active_partitions[layout.name()];
       if (!active.actor) {
-        create_active_partition();
+        // Make room for the new partition by persisting the one that
+        // received events least recently.
+        auto& partitions = self->state.active_partitions;
+        auto lru = partitions.end();
+        size_t num_active = 0;
+        for (auto it = partitions.begin(); it != partitions.end(); ++it) {
+          if (!it->second.actor)
+            continue;
+          ++num_active;
+          if (lru == partitions.end()
+              || it->second.last_write < lru->second.last_write)
+            lru = it;
+        }
+        if (num_active >= self->state.max_active_partitions) {
+          VAST_DEBUG(self, "reached the maximum of", num_active,
+                     "active partitions and persists partition",
+                     lru->second.id);
+          decomission_active_partition(lru->first, lru->second);
+        }
+        create_active_partition(layout.name());
       } else if (x.rows() > active.capacity) {
         VAST_DEBUG(self, "exceeds active capacity by",
                    (x.rows() - active.capacity), "rows");
-        decomission_active_partition();
-        self->state.flush_to_disk();
-        create_active_partition();
+        decomission_active_partition(layout.name(), active);
+        create_active_partition(layout.name());
+      } else if (self->state.partition_window > duration::zero()
+                 && std::chrono::system_clock::now() >= active.window_end) {
+        VAST_DEBUG(self, "reached the end of the time window of partition",
+                   active.id);
+        decomission_active_partition(layout.name(), active);
+        create_active_partition(layout.name());
       }
       out.push(x);
-      self->state.meta_idx.add(active.id, x);
+      active.last_write = ++self->state.slice_sequence;
+      active.idle = false;
+      // The importer assigns increasing IDs, so we can usually append.
+      if (x.offset() >= active.ids.size()) {
+        active.ids.append_bits(false, x.offset() - active.ids.size());
+        active.ids.append_bits(true, x.rows());
+      } else {
+        active.ids |= make_ids(x);
+      }
       if (active.capacity == self->state.partition_capacity
           && x.rows() > active.capacity) {
         VAST_WARNING(self, "got table slice with", x.rows(),
@@ -549,7 +1239,11 @@ index(index_actor::stateful_pointer<index_state> self,
         self->send_exit(self, err);
       }
       VAST_DEBUG_ANON("index finalized streaming");
-    });
+    },
+    // Every active partition has an outbound path whose filter is the name of
+    // its layout, such that the stage routes every table slice to exactly one
+    // active partition.
+    caf::policy::arg<index_state::index_downstream_manager>{});
   self->set_exit_handler([=](const caf::exit_msg& msg) {
     VAST_DEBUG(self, "received EXIT from", msg.source,
                "with reason:", msg.reason);
@@ -558,9 +1252,10 @@ index(index_actor::stateful_pointer<index_state> self,
     self->state.stage->out().force_emit_batches();
     self->state.stage->out().close();
     self->state.stage->shutdown();
-    // Bring down active partition.
-    if (self->state.active_partition.actor)
-      decomission_active_partition();
+    // Bring down active partitions.
+    for (auto& [layout, active] : self->state.active_partitions)
+      if (active.actor)
+        decomission_active_partition(layout, active);
     // Collect partitions for termination.
     // TODO: We must actor_cast to caf::actor here because 'shutdown' operates
     // on 'std::vector<caf::actor>' only. That should probably be generalized in
@@ -583,6 +1278,10 @@ index(index_actor::stateful_pointer<index_state> self,
   // Launch workers for resolving queries.
   for (size_t i = 0; i < num_workers; ++i)
     self->spawn(query_supervisor, self);
+  // Start the compaction loop.
+  if (compaction_budget > 0)
+    self->delayed_send(self, defaults::system::partition_compaction_interval,
+                       atom::compact_v);
   return {
     [=](atom::worker, query_supervisor_actor worker) {
       if (!self->state.worker_available())
@@ -599,6 +1298,46 @@ index(index_actor::stateful_pointer<index_state> self,
     [=](accountant_actor accountant) {
       self->state.accountant = std::move(accountant);
     },
+    [=](archive_actor archive) {
+      self->state.archive = std::move(archive);
+    },
+    [=](atom::persist, const std::string& layout, const uuid& id) {
+      auto active = self->state.active_partitions.find(layout);
+      // Ignore the timer if the partition already rolled over otherwise.
+      if (active == self->state.active_partitions.end()
+          || !active->second.actor || active->second.id != id)
+        return;
+      VAST_DEBUG(self, "reached the end of the time window of idle partition",
+                 id);
+      decomission_active_partition(layout, active->second);
+    },
+    [=](atom::wakeup, const std::string& layout, const uuid& id) {
+      auto active = self->state.active_partitions.find(layout);
+      if (active == self->state.active_partitions.end()
+          || !active->second.actor || active->second.id != id)
+        return;
+      // Check again after another timeout if the partition received events
+      // since the last check.
+      if (!active->second.idle) {
+        active->second.idle = true;
+        self->delayed_send(self, self->state.active_partition_timeout,
+                           atom::wakeup_v, layout, id);
+        return;
+      }
+      VAST_DEBUG(self, "persists partition", id,
+                 "that received no events within",
+                 self->state.active_partition_timeout);
+      decomission_active_partition(layout, active->second);
+    },
+    [=](atom::compact) {
+      // Only the periodic trigger re-arms the loop; `vast send index compact`
+      // runs a single cycle.
+      if (self->current_sender() == self->ctrl() && compaction_budget > 0)
+        self->delayed_send(self,
+                           defaults::system::partition_compaction_interval,
+                           atom::compact_v);
+      self->state.compact();
+    },
     [=](atom::status, status_verbosity v) -> caf::config_value::dictionary {
       return self->state.status(v);
     },
@@ -608,8 +1347,13 @@ index(index_actor::stateful_pointer<index_state> self,
     [=](vast::expression expr) -> caf::result<void> {
       // TODO: This check is not required technically, but we use the query
       // supervisor availability to rate-limit meta-index lookups. Do we really
-      // need this?
-      if (!self->state.worker_available())
+      // need this? Every lookup in flight takes a worker once it completes,
+      // so we allow at most one lookup per available worker.
+      if (self->state.candidate_lookups >= self->state.idle_workers.size())
+        return caf::skip;
+      // Unless configured otherwise, queries wait until the meta index knows
+      // the synopses of all persisted partitions.
+      if (!self->state.lazy_synopses && self->state.pending_synopses > 0)
         return caf::skip;
       // Query handling
       auto mid = self->current_message_id();
@@ -634,33 +1378,45 @@ index(index_actor::stateful_pointer<index_state> self,
         respond(caf::sec::invalid_argument);
         return {};
       }
-      // Get all potentially matching partitions.
-      auto candidates = self->state.meta_idx.lookup(expr);
-      if (candidates.empty()) {
-        VAST_DEBUG(self, "returns without result: no partitions qualify");
-        no_result();
-        return {};
-      }
-      // Allows the client to query further results after initial taste.
-      auto query_id = uuid::random();
-      // Ensure the query id is unique.
-      while (self->state.pending.find(query_id) != self->state.pending.end()
-             || query_id == uuid::nil())
-        query_id = uuid::random();
-      auto total = candidates.size();
-      auto scheduled = detail::narrow<uint32_t>(
-        std::min(candidates.size(), self->state.taste_partitions));
-      auto lookup = query_state{query_id, expr, std::move(candidates)};
-      auto result = self->state.pending.emplace(query_id, std::move(lookup));
-      VAST_ASSERT(result.second);
-      // NOTE: The previous version of the index used to do much more
-      // validation before assigning a query id; in particular it did
-      // evaluate the entries of the pending query map and checked that
-      // at least one of them actually produced an evaluation triple.
-      // However, the query_processor doesnt really care about the id
-      // anyways, so hopefully that shouldnt make too big of a difference.
-      respond(query_id, detail::narrow<uint32_t>(total), scheduled);
-      self->delegate(caf::actor_cast<caf::actor>(self), query_id, scheduled);
+      // Get all potentially matching partitions. The META INDEX shards answer
+      // asynchronously, so the INDEX keeps serving other requests meanwhile.
+      self->state.lookup_candidates(expr, [=](caf::expected<std::vector<uuid>>
+                                                candidates) {
+        if (!candidates) {
+          VAST_ERROR(self, "failed to look up candidate partitions:",
+                     render(candidates.error()));
+          respond(std::move(candidates.error()));
+          return;
+        }
+        if (candidates->empty()) {
+          VAST_DEBUG(self, "returns without result: no partitions qualify");
+          no_result();
+          return;
+        }
+        // Allows the client to query further results after initial taste.
+        auto query_id = uuid::random();
+        // Ensure the query id is unique.
+        while (self->state.pending.find(query_id) != self->state.pending.end()
+               || query_id == uuid::nil())
+          query_id = uuid::random();
+        auto total = candidates->size();
+        auto scheduled = detail::narrow<uint32_t>(
+          std::min(candidates->size(), self->state.taste_partitions));
+        auto lookup = query_state{query_id, expr, std::move(*candidates)};
+        auto result = self->state.pending.emplace(query_id, std::move(lookup));
+        VAST_ASSERT(result.second);
+        // NOTE: The previous version of the index used to do much more
+        // validation before assigning a query id; in particular it did
+        // evaluate the entries of the pending query map and checked that
+        // at least one of them actually produced an evaluation triple.
+        // However, the query_processor doesnt really care about the id
+        // anyways, so hopefully that shouldnt make too big of a difference.
+        respond(query_id, detail::narrow<uint32_t>(total), scheduled);
+        // Schedule the taste on behalf of the client, which must remain the
+        // sender of the follow-up message.
+        caf::send_as(client, caf::actor_cast<caf::actor>(self), query_id,
+                     scheduled);
+      });
       return {};
     },
     [=](const uuid& query_id, uint32_t num_partitions) -> caf::result<void> {
@@ -748,9 +1504,21 @@ index(index_actor::stateful_pointer<index_state> self,
       }
       auto pu = std::make_unique<partition_synopsis>();
       std::swap(*ps, *pu);
-      self->state.meta_idx.replace(partition_id, std::move(pu));
+      // A merged partition becomes visible only together with the removal of
+      // the partitions it replaces.
+      if (auto& c = self->state.compaction; c && c->id == partition_id) {
+        c->synopsis = std::move(pu);
+        if (c->persisted)
+          self->state.finish_compaction();
+        return;
+      }
+      self->state.merge_synopsis(
+        partition_id, std::shared_ptr<partition_synopsis>{std::move(pu)});
     },
     [=](atom::erase, uuid partition_id) -> caf::result<ids> {
+      // Lookups in flight may still return the partition as a candidate.
+      if (self->state.candidate_lookups > 0)
+        return caf::skip;
       VAST_VERBOSE(self, "erases partition", partition_id);
       auto rp = self->make_response_promise<ids>();
       auto path = self->state.partition_path(partition_id);
@@ -767,41 +1535,61 @@ index(index_actor::stateful_pointer<index_state> self,
       }
       self->state.inmem_partitions.drop(partition_id);
       self->state.persisted_partitions.erase(partition_id);
-      self->request(self->state.filesystem, caf::infinite, atom::mmap_v, path)
+      self->state.partition_sizes.erase(partition_id);
+      self->state.undersized_partitions.erase(partition_id);
+      self->state.erase_synopsis(partition_id);
+      auto on_chunk = [=](chunk_ptr chunk) mutable {
+        // Adjust layout stats by subtracting the events of the removed
+        // partition.
+        auto partition = partition_flatbuffer(as_bytes(chunk));
+        if (!partition
+            || partition->partition_type() != fbs::partition::Partition::v0) {
+          rp.deliver(make_error(ec::format_error, "unexpected format "
+                                                  "version"));
+          return;
+        }
+        vast::ids all_ids;
+        auto partition_v0 = partition->partition_as_v0();
+        for (auto partition_stats : *partition_v0->type_ids()) {
+          auto name = partition_stats->name();
+          vast::ids ids;
+          if (auto error
+              = fbs::deserialize_bytes(partition_stats->ids(), ids)) {
+            rp.deliver(make_error(ec::format_error, "could not deserialize "
+                                                    "ids: "
+                                                      + render(error)));
+            return;
+          }
+          all_ids |= ids;
+          if (adjust_stats)
+            self->state.stats.layouts[name->str()].count -= rank(ids);
+        }
+        self->state.append_to_journal(partition_id, true);
+        self->state.unlink_partition(partition_id);
+        rp.deliver(std::move(all_ids));
+      };
+      auto on_error = [=](caf::error e) mutable { rp.deliver(e); };
+      // We only need the type ids from the partition flatbuffer, so we skip
+      // the value indexes that follow it.
+      auto fs = self->state.filesystem;
+      self
+        ->request(fs, caf::infinite, atom::read_v, path, uint64_t{0},
+                  uint64_t{partition_header_size})
         .then(
-          [=](chunk_ptr chunk) mutable {
-            // Adjust layout stats by subtracting the events of the removed
-            // partition.
-            auto partition = fbs::GetPartition(chunk->data());
-            if (partition->partition_type() != fbs::partition::Partition::v0) {
-              rp.deliver(make_error(ec::format_error, "unexpected format "
-                                                      "version"));
-              return;
-            }
-            vast::ids all_ids;
-            auto partition_v0 = partition->partition_as_v0();
-            for (auto partition_stats : *partition_v0->type_ids()) {
-              auto name = partition_stats->name();
-              vast::ids ids;
-              if (auto error
-                  = fbs::deserialize_bytes(partition_stats->ids(), ids)) {
-                rp.deliver(make_error(ec::format_error, "could not deserialize "
-                                                        "ids: "
-                                                          + render(error)));
-                return;
-              }
-              all_ids |= ids;
-              if (adjust_stats)
-                self->state.stats.layouts[name->str()].count -= rank(ids);
-            }
-            // Note that mmap's will increase the reference count of a file, so
-            // unlinking should not affect indexers that are currently loaded
-            // and answering a query.
-            if (!rm(path))
-              VAST_WARNING(self, "could not unlink partition at", path);
-            rp.deliver(std::move(all_ids));
+          [=](chunk_ptr header) mutable {
+            auto size = partition_flatbuffer_size(as_bytes(header));
+            if (!size)
+              return on_error(std::move(size.error()));
+            if (*size == 0)
+              self->request(fs, caf::infinite, atom::mmap_v, path)
+                .then(on_chunk, on_error);
+            else
+              self
+                ->request(fs, caf::infinite, atom::read_v, path, uint64_t{0},
+                          uint64_t{*size})
+                .then(on_chunk, on_error);
           },
-          [=](caf::error e) mutable { rp.deliver(e); });
+          on_error);
       return rp;
     },
   };
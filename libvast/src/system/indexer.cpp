@@ -23,6 +23,7 @@
 #include "vast/defaults.hpp"
 #include "vast/detail/assert.hpp"
 #include "vast/expression.hpp"
+#include "vast/fbs/utils.hpp"
 #include "vast/logger.hpp"
 #include "vast/path.hpp"
 #include "vast/system/accountant.hpp"
@@ -36,7 +37,6 @@
 #include "vast/view.hpp"
 
 #include <caf/attach_stream_sink.hpp>
-#include <caf/binary_serializer.hpp>
 
 #include <flatbuffers/flatbuffers.h>
 
@@ -45,12 +45,12 @@ namespace vast::system {
 namespace {
 
 vast::chunk_ptr chunkify(const value_index_ptr& idx) {
-  std::vector<char> buf;
-  caf::binary_serializer sink{nullptr, buf};
-  auto error = sink(idx);
-  if (error)
+  flatbuffers::FlatBufferBuilder builder;
+  auto value_index = pack(builder, idx);
+  if (!value_index)
     return nullptr;
-  return chunk::make(std::move(buf));
+  builder.Finish(*value_index);
+  return fbs::release(builder);
 }
 
 } // namespace
@@ -129,6 +129,101 @@ active_indexer(active_indexer_actor::stateful_pointer<indexer_state> self,
   };
 }
 
+indexing_worker_actor::behavior_type
+indexing_worker(indexing_worker_actor::stateful_pointer<indexing_worker_state>
+                  self,
+                uuid partition_id, caf::settings index_opts) {
+  self->state.partition_id = partition_id;
+  self->state.index_opts = std::move(index_opts);
+  // Serializes the value index of a field.
+  auto snapshot
+    = [=](const qualified_record_field& qf) -> caf::expected<chunk_ptr> {
+    auto it = self->state.entries.find(qf);
+    if (it == self->state.entries.end())
+      return make_error(ec::lookup_error, "no value index for field", qf.fqn());
+    return chunkify(it->second.idx);
+  };
+  return {
+    [=](caf::stream<table_slice_column> in)
+      -> caf::inbound_stream_slot<table_slice_column> {
+      VAST_DEBUG(self, "got a new stream");
+      self->state.stream_initiated = true;
+      auto result = caf::attach_stream_sink(
+        self, in,
+        [=](caf::unit_t&) {
+          // nop
+        },
+        [=](caf::unit_t&, const std::vector<table_slice_column>& columns) {
+          for (auto& column : columns) {
+            auto&& layout = column.slice().layout();
+            auto& field = layout.fields[column.index()];
+            auto qf = qualified_record_field{layout.name(), field};
+            auto it = self->state.entries.find(qf);
+            if (it == self->state.entries.end()) {
+              auto& opts = self->state.index_opts;
+              auto idx = factory<value_index>::make(field.type, opts);
+              if (!idx) {
+                VAST_ERROR(self, "failed to construct value index for",
+                           qf.fqn());
+                self->quit(make_error(ec::unspecified, "failed to construct "
+                                                       "value index"));
+                return;
+              }
+              auto skip = vast::has_skip_attribute(field.type);
+              it = self->state.entries
+                     .emplace(std::move(qf),
+                              indexing_worker_state::entry{std::move(idx),
+                                                           skip})
+                     .first;
+            }
+            // See the ACTIVE INDEXER for why we create value indexes for
+            // fields with the `#skip` attribute.
+            auto& [idx, has_skip_attribute] = it->second;
+            if (has_skip_attribute)
+              continue;
+            for (size_t i = 0; i < column.size(); ++i)
+              idx->append(column[i], column.slice().offset() + i);
+          }
+        },
+        [=](caf::unit_t&, const error& err) {
+          if (err) {
+            VAST_ERROR_ANON("indexing worker got a stream error:", render(err));
+            return;
+          }
+          for (auto& [qf, promise] : std::exchange(self->state.promises, {})) {
+            if (auto chunk = snapshot(qf))
+              promise.deliver(std::move(*chunk));
+            else
+              promise.deliver(std::move(chunk.error()));
+          }
+        });
+      return result.inbound_slot();
+    },
+    [=](const curried_predicate& pred,
+        const qualified_record_field& qf) -> caf::result<ids> {
+      VAST_DEBUG(self, "got predicate:", pred, "for field", qf.fqn());
+      auto it = self->state.entries.find(qf);
+      // Columns may still be on their way to this worker.
+      if (it == self->state.entries.end())
+        return ids{};
+      auto& idx = *it->second.idx;
+      auto rep = to_internal(idx.type(), make_view(pred.rhs));
+      return idx.lookup(pred.op, rep);
+    },
+    [=](atom::snapshot,
+        const qualified_record_field& qf) -> caf::result<chunk_ptr> {
+      // See the ACTIVE INDEXER for why we cannot rely on 'idle()' here.
+      if (self->state.stream_initiated
+          && (self->stream_managers().empty()
+              || self->stream_managers().begin()->second->done()))
+        return snapshot(qf);
+      auto promise = self->make_response_promise<chunk_ptr>();
+      self->state.promises.emplace_back(qf, promise);
+      return promise;
+    },
+  };
+}
+
 indexer_actor::behavior_type
 passive_indexer(indexer_actor::stateful_pointer<indexer_state> self,
                 uuid partition_id, value_index_ptr idx) {
@@ -152,4 +247,55 @@ passive_indexer(indexer_actor::stateful_pointer<indexer_state> self,
   };
 }
 
+indexer_actor::behavior_type
+lazy_passive_indexer(indexer_actor::stateful_pointer<indexer_state> self,
+                     uuid partition_id, filesystem_actor filesystem,
+                     partition_file_ptr file, uint64_t offset, uint64_t size) {
+  self->state.name = "indexer";
+  self->state.partition_id = partition_id;
+  // Awaiting the value index makes predicates wait until it is available. The
+  // response handler holds on to the partition file until then, so that the
+  // file outlives an erasure of the partition in the meantime.
+  auto filename = file->path;
+  self
+    ->request(filesystem, caf::infinite, atom::read_v, std::move(filename),
+              offset, size)
+    .await(
+      [=, file = std::move(file)](const chunk_ptr& chunk) {
+        auto index = fbs::as_flatbuffer<fbs::value_index::v0>(as_bytes(chunk));
+        if (!index) {
+          VAST_ERROR(self, "got invalid value index for partition",
+                     partition_id);
+          self->quit(make_error(ec::format_error, "invalid value index"));
+          return;
+        }
+        if (auto err = unpack(*index, self->state.idx, chunk)) {
+          VAST_ERROR(self, "failed to unpack value index:", render(err));
+          self->quit(std::move(err));
+          return;
+        }
+        if (!self->state.idx) {
+          VAST_ERROR(self, "got invalid value index pointer");
+          self->quit(make_error(ec::end_of_input, "invalid value index "
+                                                  "pointer"));
+          return;
+        }
+        self->state.name = "indexer-" + to_string(self->state.idx->type());
+      },
+      [=](const caf::error& err) {
+        VAST_ERROR(self, "failed to read value index:", render(err));
+        self->quit(err);
+      });
+  return {
+    [=](const curried_predicate& pred) {
+      VAST_DEBUG(self, "got predicate:", pred);
+      VAST_ASSERT(self->state.idx);
+      auto& idx = *self->state.idx;
+      auto rep = to_internal(idx.type(), make_view(pred.rhs));
+      return idx.lookup(pred.op, rep);
+    },
+    [=](atom::shutdown) { self->quit(caf::exit_reason::user_shutdown); },
+  };
+}
+
 } // namespace vast::system
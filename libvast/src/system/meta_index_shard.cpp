@@ -0,0 +1,50 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/meta_index_shard.hpp"
+
+#include "vast/fwd.hpp"
+
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/expression.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/expression.hpp"
+#include "vast/logger.hpp"
+
+#include <caf/typed_event_based_actor.hpp>
+
+namespace vast::system {
+
+meta_index_actor::behavior_type meta_index_shard(
+  meta_index_actor::stateful_pointer<meta_index_shard_state> self) {
+  return {
+    [=](atom::add, const uuid& partition, std::string& layout) {
+      self->state.meta_idx.add_pending(partition, std::move(layout));
+    },
+    [=](atom::replace, const uuid& partition,
+        std::shared_ptr<partition_synopsis>& ps) {
+      // The INDEX hands over unique ownership of the synopsis, so we can move
+      // from it.
+      VAST_DEBUG(self, "merges synopsis for partition", partition);
+      self->state.meta_idx.merge(partition, std::move(*ps));
+    },
+    [=](atom::erase, const uuid& partition) {
+      self->state.meta_idx.erase(partition);
+    },
+    [=](const expression& expr) {
+      return self->state.meta_idx.lookup(expr);
+    },
+  };
+}
+
+} // namespace vast::system
@@ -510,7 +510,15 @@ caf::behavior node(node_actor* self, std::string name, path dir,
     node_state::command_factory = std::move(extra);
   }
   // Initialize the file system with the node directory as root.
-  auto fs = self->spawn<linked + detached>(posix_filesystem, self->state.dir);
+  auto fs_workers = caf::get_or(content(self->system().config()),
+                                "vast.filesystem-workers",
+                                defaults::system::filesystem_workers);
+  if (fs_workers == 0) {
+    VAST_WARNING(self, "ignores invalid vast.filesystem-workers setting 0");
+    fs_workers = defaults::system::filesystem_workers;
+  }
+  auto fs = self->spawn<linked + detached>(posix_filesystem, self->state.dir,
+                                           fs_workers);
   self->state.registry.add(caf::actor_cast<caf::actor>(fs), "filesystem");
   // Remove monitored components.
   self->set_down_handler([=](const down_msg& msg) {
@@ -54,19 +54,39 @@
 #include <flatbuffers/base.h> // FLATBUFFERS_MAX_BUFFER_SIZE
 #include <flatbuffers/flatbuffers.h>
 
+#include <cstring>
+#include <functional>
 #include <memory>
+#include <string_view>
 
 using namespace std::chrono;
 using namespace caf;
 
-CAF_ALLOW_UNSAFE_MESSAGE_TYPE(std::shared_ptr<vast::partition_synopsis>)
-
 namespace vast::system {
 
-/// Gets the ACTIVE INDEXER at a certain position.
-active_indexer_actor active_partition_state::indexer_at(size_t position) const {
+/// Gets the INDEXER at a certain position.
+indexer_actor active_partition_state::indexer_at(size_t position) const {
   VAST_ASSERT(position < indexers.size());
-  return as_vector(indexers)[position].second;
+  auto& [qf, indexer] = as_vector(indexers)[position];
+  if (workers.empty())
+    return indexer;
+  // The INDEXING WORKER holds the value indexes of multiple fields, so we
+  // need to put the field next to every predicate for the EVALUATOR.
+  // TODO: Spawning a one-shot actor is quite expensive. Maybe the
+  //       partition could instead maintain this actor lazily.
+  auto worker = workers[worker_positions.at(qf)];
+  return self->spawn(
+    [worker, qf = qf](indexer_actor::pointer proxy)
+      -> indexer_actor::behavior_type {
+      return {
+        [=](const curried_predicate& pred) {
+          return proxy->delegate(worker, pred, qf);
+        },
+        [](atom::shutdown) {
+          VAST_DEBUG_ANON("one-shot indexer received shutdown request");
+        },
+      };
+    });
 }
 
 /// Gets the INDEXER at a certain position.
@@ -74,13 +94,21 @@ indexer_actor passive_partition_state::indexer_at(size_t position) const {
   VAST_ASSERT(position < indexers.size());
   auto& indexer = indexers[position];
   // Deserialize the value index and spawn a passive_indexer lazily when it is
-  // requested for the first time.
+  // requested for the first time. The bitmaps of the index borrow their blocks
+  // from the partition chunk, so this does not copy them.
   if (!indexer) {
     auto qualified_index = flatbuffer->indexes()->Get(position);
+    // Value indexes outside of the partition flatbuffer get read by the
+    // indexer itself, such that we only read the ones queries need.
+    if (auto location = qualified_index->location()) {
+      indexer = self->spawn(lazy_passive_indexer, id, filesystem, file,
+                            data_offset + location->offset(),
+                            location->size());
+      return indexer;
+    }
     auto index = qualified_index->index();
-    auto data = index->data();
     value_index_ptr state_ptr;
-    if (auto error = fbs::deserialize_bytes(data, state_ptr)) {
+    if (auto error = unpack(*index, state_ptr, partition_chunk)) {
       VAST_ERROR(self, "failed to deserialize indexer at", position,
                  "with error:", render(error));
       return {};
@@ -190,20 +218,58 @@ evaluate(const PartitionState& state, const expression& expr) {
 
 } // namespace
 
-bool partition_selector::operator()(const qualified_record_field& filter,
+namespace {
+
+/// Assigns a field to an INDEXING WORKER. We use the field name rather than the
+/// column position, which may differ between layouts of the same name.
+size_t worker_position(std::string_view field_name, size_t workers) {
+  return std::hash<std::string_view>{}(field_name) % workers;
+}
+
+} // namespace
+
+bool partition_selector::operator()(const indexer_filter& filter,
                                     const table_slice_column& column) const {
   auto&& layout = column.slice().layout();
+  if (filter.workers > 0) {
+    auto& field = layout.fields.at(column.index());
+    return worker_position(field.name, filter.workers) == filter.worker;
+  }
   // We don't create a temporary qualified_record_field here to avoid copying
   // a string and a record field on the heap. Instead, we compare each part
   // manually.
-  if (filter.layout_name != layout.name())
+  if (filter.field.layout_name != layout.name())
     return false;
   auto& field = layout.fields.at(column.index());
-  if (filter.field_name != field.name)
+  if (filter.field.field_name != field.name)
     return false;
-  return filter.type == field.type;
+  return filter.field.type == field.type;
+}
+
+namespace {
+
+/// Rounds up the size of a value index in a partition file such that the next
+/// value index starts at an 8-byte boundary, which allows for using the blocks
+/// of its bitmaps in place.
+size_t aligned_size(size_t size) {
+  constexpr auto alignment = size_t{8};
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/// Looks up the chunk that an indexer sent in response to `atom::snapshot`.
+caf::expected<chunk_ptr> indexer_chunk(const active_partition_state& x,
+                                       const qualified_record_field& y) {
+  auto chunk_it = x.chunks.find(y);
+  if (chunk_it == x.chunks.end())
+    return make_error(ec::logic_error, "no chunk for field " + y.fqn());
+  if (!chunk_it->second)
+    return make_error(ec::format_error, "invalid value index for field "
+                                          + y.fqn());
+  return chunk_it->second;
 }
 
+} // namespace
+
 caf::expected<flatbuffers::Offset<fbs::Partition>>
 pack(flatbuffers::FlatBufferBuilder& builder, const active_partition_state& x) {
   auto uuid = pack(builder, x.id);
@@ -211,23 +277,21 @@ pack(flatbuffers::FlatBufferBuilder& builder, const active_partition_state& x) {
     return uuid.error();
   std::vector<flatbuffers::Offset<fbs::qualified_value_index::v0>> indices;
   // Note that the deserialization code relies on the order of indexers within
-  // the flatbuffers being preserved.
+  // the flatbuffers being preserved. The value indexes themselves follow the
+  // flatbuffer in the partition file in the same order; we only record their
+  // locations here.
+  auto index_offset = size_t{0};
   for (auto& [qf, actor] : x.indexers) {
-    auto actor_id = actor.id();
-    auto chunk_it = x.chunks.find(actor_id);
-    if (chunk_it == x.chunks.end())
-      return make_error(ec::logic_error,
-                        "no chunk for for actor id " + to_string(actor_id));
-    auto& chunk = chunk_it->second;
-    auto data = builder.CreateVector(
-      reinterpret_cast<const uint8_t*>(chunk->data()), chunk->size());
+    auto chunk = indexer_chunk(x, qf);
+    if (!chunk)
+      return chunk.error();
     auto fqf = builder.CreateString(qf.field_name);
-    fbs::value_index::v0Builder vbuilder(builder);
-    vbuilder.add_data(data);
-    auto vindex = vbuilder.Finish();
+    auto location
+      = fbs::value_index_location::v0{index_offset, (*chunk)->size()};
+    index_offset += aligned_size((*chunk)->size());
     fbs::qualified_value_index::v0Builder qbuilder(builder);
     qbuilder.add_qualified_field_name(fqf);
-    qbuilder.add_index(vindex);
+    qbuilder.add_location(&location);
     auto qindex = qbuilder.Finish();
     indices.push_back(qindex);
   }
@@ -287,6 +351,8 @@ unpack(const fbs::partition::v0& partition, passive_partition_state& state) {
     if (!qualified_index->qualified_field_name())
       return make_error(ec::format_error, "missing field name in qualified "
                                           "index");
+    if (qualified_index->location())
+      continue;
     auto index = qualified_index->index();
     if (!index)
       return make_error(ec::format_error, "missing index name in qualified "
@@ -339,10 +405,96 @@ caf::error unpack(const fbs::partition::v0& x, partition_synopsis& ps) {
   return unpack(*x.partition_synopsis(), ps);
 }
 
+caf::expected<chunk_ptr>
+make_partition_flatbuffer(const active_partition_state& x) {
+  flatbuffers::FlatBufferBuilder builder;
+  auto partition = pack(builder, x);
+  if (!partition)
+    return partition.error();
+  fbs::FinishSizePrefixedPartitionBuffer(builder, *partition);
+  std::vector<char> buffer(aligned_size(builder.GetSize()));
+  std::memcpy(buffer.data(), builder.GetBufferPointer(), builder.GetSize());
+  return chunk::make(std::move(buffer));
+}
+
+caf::expected<size_t> partition_flatbuffer_size(span<const byte> header) {
+  if (header.size() < partition_header_size)
+    return make_error(ec::format_error, "partition file is too short");
+  auto data = header.data();
+  if (fbs::PartitionBufferHasIdentifier(data))
+    return size_t{0};
+  if (!flatbuffers::BufferHasIdentifier(data, fbs::PartitionIdentifier(),
+                                        true))
+    return make_error(ec::format_error, "not a partition file");
+  return sizeof(flatbuffers::uoffset_t)
+         + flatbuffers::ReadScalar<flatbuffers::uoffset_t>(data);
+}
+
+const fbs::Partition* partition_flatbuffer(span<const byte> xs) {
+  auto size = partition_flatbuffer_size(xs);
+  if (!size)
+    return nullptr;
+  if (*size == 0)
+    return fbs::GetPartition(xs.data());
+  if (*size > xs.size())
+    return nullptr;
+  return fbs::GetSizePrefixedPartition(xs.data());
+}
+
+size_t partition_data_offset(size_t flatbuffer_size) {
+  return aligned_size(flatbuffer_size);
+}
+
+namespace {
+
+/// Appends the value indexes of a partition to its file one after another,
+/// starting at `next`, and fulfills the persistence promise with the size of
+/// the partition flatbuffer afterwards.
+void append_value_indexes(
+  active_partition_actor::stateful_pointer<active_partition_state> self,
+  std::shared_ptr<std::vector<chunk_ptr>> chunks, size_t next,
+  uint64_t flatbuffer_size) {
+  auto& st = self->state;
+  if (next == chunks->size()) {
+    st.persistence_promise.deliver(flatbuffer_size);
+    return;
+  }
+  auto on_error = [=](caf::error& err) {
+    VAST_ERROR(self, "failed to append value index to partition file:",
+               render(err));
+    self->state.persistence_promise.deliver(std::move(err));
+  };
+  // Releasing each chunk once written lets the partition shrink while it
+  // writes its file.
+  auto chunk = std::exchange((*chunks)[next], nullptr);
+  auto padding = aligned_size(chunk->size()) - chunk->size();
+  self
+    ->request(st.filesystem, caf::infinite, atom::append_v, *st.persist_path,
+              std::move(chunk))
+    .then(
+      [=](atom::ok) {
+        if (padding == 0)
+          return append_value_indexes(self, chunks, next + 1,
+                                      flatbuffer_size);
+        auto zeros = chunk::make(std::vector<char>(padding));
+        self
+          ->request(self->state.filesystem, caf::infinite, atom::append_v,
+                    *self->state.persist_path, std::move(zeros))
+          .then(
+            [=](atom::ok) {
+              append_value_indexes(self, chunks, next + 1, flatbuffer_size);
+            },
+            on_error);
+      },
+      on_error);
+}
+
+} // namespace
+
 active_partition_actor::behavior_type active_partition(
   active_partition_actor::stateful_pointer<active_partition_state> self,
   uuid id, filesystem_actor filesystem, caf::settings index_opts,
-  caf::settings synopsis_opts) {
+  caf::settings synopsis_opts, size_t indexing_workers) {
   self->state.self = self;
   self->state.name = "partition-" + to_string(id);
   self->state.id = id;
@@ -354,6 +506,7 @@ active_partition_actor::behavior_type active_partition(
   self->state.synopsis = std::make_shared<partition_synopsis>();
   self->state.synopsis_opts = std::move(synopsis_opts);
   put(self->state.synopsis_opts, "buffer-ips", true);
+  put(self->state.synopsis_opts, "buffer-strings", true);
   // The active partition stage is a caf stream stage that takes
   // a stream of `table_slice` as input and produces several
   // streams of `table_slice_column` as output.
@@ -383,12 +536,24 @@ active_partition_actor::behavior_type active_partition(
       VAST_ASSERT(!layout.fields.empty());
       for (auto& field : layout.fields) {
         auto qf = qualified_record_field{layout.name(), field};
+        if (!self->state.workers.empty()) {
+          // The INDEXING WORKER for this column already gets it through its
+          // filter, so we only need to remember where the field lives.
+          auto position
+            = worker_position(field.name, self->state.workers.size());
+          if (self->state.worker_positions.emplace(qf, position).second) {
+            self->state.combined_layout.fields.push_back(as_record_field(qf));
+            self->state.indexers.emplace(std::move(qf), active_indexer_actor{});
+          }
+          out.push(table_slice_column{x, col++});
+          continue;
+        }
         auto& idx = self->state.indexers[qf];
         if (!idx) {
           self->state.combined_layout.fields.push_back(as_record_field(qf));
           idx = self->spawn(active_indexer, field.type, index_opts);
           auto slot = self->state.stage->add_outbound_path(idx);
-          self->state.stage->out().set_filter(slot, qf);
+          self->state.stage->out().set_filter(slot, indexer_filter{qf});
           VAST_DEBUG(self, "spawned new indexer for field", field.name,
                      "at slot", slot);
         }
@@ -410,7 +575,7 @@ active_partition_actor::behavior_type active_partition(
     // we have:
     //
     //   T:      vast::table_slice_column
-    //   Filter: vast::qualified_record_field
+    //   Filter: vast::system::indexer_filter
     //   Select: vast::system::partition_selector
     //
     // NOTE: The broadcast_downstream_manager has to iterate over all
@@ -418,7 +583,17 @@ active_partition_actor::behavior_type active_partition(
     // specialized downstream manager could optimize this by using e.g. a map
     // from qualified record fields to downstream indexers.
     caf::policy::arg<broadcast_downstream_manager<
-      table_slice_column, vast::qualified_record_field, partition_selector>>{});
+      table_slice_column, indexer_filter, partition_selector>>{});
+  // With a pool of INDEXING WORKERS, the partition sends each worker a single
+  // batch of columns at a time instead of one per field, and the number of
+  // actors no longer grows with the width of the layout.
+  for (size_t i = 0; i < indexing_workers; ++i) {
+    auto worker = self->spawn(indexing_worker, id, index_opts);
+    auto slot = self->state.stage->add_outbound_path(worker);
+    self->state.stage->out().set_filter(
+      slot, indexer_filter{{}, i, indexing_workers});
+    self->state.workers.push_back(std::move(worker));
+  }
   self->set_exit_handler([=](const caf::exit_msg& msg) {
     VAST_DEBUG(self, "received EXIT from", msg.source,
                "with reason:", msg.reason);
@@ -448,10 +623,14 @@ active_partition_actor::behavior_type active_partition(
     // on 'std::vector<caf::actor>' only. That should probably be generalized
     // in the future.
     auto indexers = std::vector<caf::actor>{};
-    indexers.reserve(self->state.indexers.size());
+    indexers.reserve(self->state.indexers.size()
+                     + self->state.workers.size());
     auto copy = std::exchange(self->state.indexers, {});
     for ([[maybe_unused]] auto&& [qf, indexer] : std::move(copy))
-      indexers.push_back(caf::actor_cast<caf::actor>(std::move(indexer)));
+      if (indexer)
+        indexers.push_back(caf::actor_cast<caf::actor>(std::move(indexer)));
+    for (auto&& worker : std::exchange(self->state.workers, {}))
+      indexers.push_back(caf::actor_cast<caf::actor>(std::move(worker)));
     shutdown<policy::parallel>(self, std::move(indexers));
   });
   return {
@@ -467,7 +646,7 @@ active_partition_actor::behavior_type active_partition(
       self->state.index = index;
       self->state.persist_path = part_dir;
       self->state.persisted_indexers = 0;
-      self->state.persistence_promise = self->make_response_promise<atom::ok>();
+      self->state.persistence_promise = self->make_response_promise<uint64_t>();
       // We use a high message priority here because we want to start persisting
       // as soon as possible in order to avoid shutdown delay.
       self->send<caf::message_priority::high>(self, atom::persist_v,
@@ -494,64 +673,90 @@ active_partition_actor::behavior_type active_partition(
       VAST_DEBUG(self, "sends 'snapshot' to", self->state.indexers.size(),
                  "indexers");
       for (auto& kv : self->state.indexers) {
-        self->request(kv.second, caf::infinite, atom::snapshot_v)
-          .then(
-            [=](chunk_ptr chunk) {
-              ++self->state.persisted_indexers;
-              if (!self->state.persistence_promise.pending()) {
-                VAST_WARNING(self, "ignores persisted indexer because the "
-                                   "persistence promise is already fulfilled");
-                return;
-              }
-              auto sender = self->current_sender()->id();
-              if (!chunk) {
-                VAST_ERROR(self, "failed to persist indexer", sender);
-                self->state.persistence_promise.deliver(caf::make_error(
-                  ec::unspecified, "failed to persist indexer", sender));
-                return;
-              }
-              VAST_DEBUG(self, "got chunk from", sender);
-              self->state.chunks.emplace(sender, chunk);
-              if (self->state.persisted_indexers
-                  < self->state.indexers.size()) {
-                VAST_DEBUG(self, "waits for more chunks after receiving",
-                           self->state.persisted_indexers, "out of",
-                           self->state.indexers.size());
-                return;
-              }
-              // Shrink synopses for addr fields to optimal size.
-              self->state.synopsis->shrink();
-              // Create the partition flatbuffer.
-              flatbuffers::FlatBufferBuilder builder;
-              auto partition = pack(builder, self->state);
-              if (!partition) {
-                VAST_ERROR(self, "failed to serialize", self->state.name,
-                           "with error:", render(partition.error()));
-                self->state.persistence_promise.deliver(partition.error());
-                return;
-              }
-              VAST_ASSERT(self->state.persist_path);
-              auto fbchunk = fbs::release(builder);
-              VAST_DEBUG(self, "persists partition with a total size of",
-                         fbchunk->size(), "bytes");
-              // Relinquish ownership and send the shrinked synopsis to the index.
-              if (self->state.index) {
-                self->send(self->state.index, atom::replace_v, self->state.id,
-                           self->state.synopsis);
-                self->state.synopsis.reset();
-              }
-              self->state.persistence_promise.delegate(
-                self->state.filesystem, atom::write_v,
-                *self->state.persist_path, fbchunk);
-              return;
-            },
-            [=](caf::error err) {
-              VAST_ERROR(self, "failed to persist indexer for", kv.first.fqn(),
-                         "with error:", render(err));
-              ++self->state.persisted_indexers;
-              if (!self->state.persistence_promise.pending())
+        auto on_chunk = [=](chunk_ptr chunk) {
+          ++self->state.persisted_indexers;
+          if (!self->state.persistence_promise.pending()) {
+            VAST_WARNING(self, "ignores persisted indexer because the "
+                               "persistence promise is already fulfilled");
+            return;
+          }
+          if (!chunk) {
+            VAST_ERROR(self, "failed to persist indexer for", kv.first.fqn());
+            self->state.persistence_promise.deliver(
+              caf::make_error(ec::unspecified, "failed to persist indexer for",
+                              kv.first.fqn()));
+            return;
+          }
+          VAST_DEBUG(self, "got chunk for", kv.first.fqn());
+          self->state.chunks.emplace(kv.first, chunk);
+          if (self->state.persisted_indexers < self->state.indexers.size()) {
+            VAST_DEBUG(self, "waits for more chunks after receiving",
+                       self->state.persisted_indexers, "out of",
+                       self->state.indexers.size());
+            return;
+          }
+          // Shrink synopses for addr fields to optimal size.
+          self->state.synopsis->shrink();
+          // Create the partition file.
+          auto fbchunk = make_partition_flatbuffer(self->state);
+          if (!fbchunk) {
+            VAST_ERROR(self, "failed to serialize", self->state.name,
+                       "with error:", render(fbchunk.error()));
+            self->state.persistence_promise.deliver(fbchunk.error());
+            return;
+          }
+          VAST_ASSERT(self->state.persist_path);
+          // The value indexes follow the flatbuffer in the order of the
+          // locations that it records. We write them one by one instead of
+          // assembling the whole file in memory.
+          auto chunks = std::make_shared<std::vector<chunk_ptr>>();
+          uint64_t flatbuffer_size = (*fbchunk)->size();
+          auto size = flatbuffer_size;
+          for (auto& [qf, indexer] : self->state.indexers) {
+            auto chunk = *indexer_chunk(self->state, qf);
+            size += aligned_size(chunk->size());
+            chunks->push_back(std::move(chunk));
+          }
+          self->state.chunks.clear();
+          VAST_DEBUG(self, "persists partition with a total size of", size,
+                     "bytes");
+          // Relinquish ownership and send the shrinked synopsis to the index.
+          if (self->state.index) {
+            self->send(self->state.index, atom::replace_v, self->state.id,
+                       self->state.synopsis);
+            self->state.synopsis.reset();
+          }
+          self
+            ->request(self->state.filesystem, caf::infinite, atom::write_v,
+                      *self->state.persist_path, std::move(*fbchunk))
+            .then(
+              [=](atom::ok) {
+                append_value_indexes(self, chunks, 0, flatbuffer_size);
+              },
+              [=](caf::error& err) {
+                VAST_ERROR(self, "failed to write partition file:",
+                           render(err));
                 self->state.persistence_promise.deliver(std::move(err));
-            });
+              });
+          return;
+        };
+        auto on_error = [=](caf::error err) {
+          VAST_ERROR(self, "failed to persist indexer for", kv.first.fqn(),
+                     "with error:", render(err));
+          ++self->state.persisted_indexers;
+          if (!self->state.persistence_promise.pending())
+            self->state.persistence_promise.deliver(std::move(err));
+        };
+        if (self->state.workers.empty()) {
+          self->request(kv.second, caf::infinite, atom::snapshot_v)
+            .then(on_chunk, on_error);
+          continue;
+        }
+        auto position = self->state.worker_positions.at(kv.first);
+        self
+          ->request(self->state.workers[position], caf::infinite,
+                    atom::snapshot_v, kv.first)
+          .then(on_chunk, on_error);
       }
     },
     [=](const expression& expr) { return evaluate(self->state, expr); },
@@ -560,7 +765,9 @@ active_partition_actor::behavior_type active_partition(
 
 partition_actor::behavior_type passive_partition(
   partition_actor::stateful_pointer<passive_partition_state> self, uuid id,
-  filesystem_actor filesystem, class path path) {
+  filesystem_actor filesystem, partition_file_ptr file) {
+  VAST_ASSERT(file != nullptr);
+  auto path = file->path;
   self->state.self = self;
   self->set_exit_handler([=](const caf::exit_msg& msg) {
     VAST_DEBUG(self, "received EXIT from", msg.source,
@@ -592,70 +799,99 @@ partition_actor::behavior_type passive_partition(
           self->quit(err);
         });
   });
-  // We send a "read" to the fs actor and upon receiving the result deserialize
-  // the flatbuffer and switch to the "normal" partition behavior for responding
-  // to queries.
-  self->request(filesystem, caf::infinite, atom::mmap_v, path)
+  self->state.filesystem = filesystem;
+  self->state.file = std::move(file);
+  // We read the partition flatbuffer from the fs actor and upon receiving the
+  // result deserialize it and switch to the "normal" partition behavior for
+  // responding to queries. The value indexes are read on demand later.
+  auto on_chunk = [=](chunk_ptr chunk) {
+    VAST_TRACE(self, VAST_ARG(chunk));
+    if (self->state.partition_chunk) {
+      VAST_WARNING(self, "ignores duplicate chunk");
+      return;
+    }
+    if (!chunk) {
+      VAST_ERROR(self, "got invalid chunk");
+      self->quit();
+      return;
+    }
+    // FlatBuffers <= 1.11 does not correctly use '::flatbuffers::soffset_t'
+    // over 'soffset_t' in FLATBUFFERS_MAX_BUFFER_SIZE.
+    using ::flatbuffers::soffset_t;
+    if (chunk->size() >= FLATBUFFERS_MAX_BUFFER_SIZE) {
+      VAST_ERROR("failed to load partition at", path, "because its size of",
+                 chunk->size(), "exceeds the maximum allowed size of",
+                 FLATBUFFERS_MAX_BUFFER_SIZE);
+      return self->quit();
+    }
+    // Deserialize chunk from the filesystem actor
+    auto partition = partition_flatbuffer(as_bytes(chunk));
+    if (!partition) {
+      VAST_ERROR(self, "failed to load partition at", path,
+                 "because it is not a partition file");
+      self->quit(make_error(ec::format_error, "not a partition file"));
+      return;
+    }
+    if (partition->partition_type() != fbs::partition::Partition::v0) {
+      VAST_ERROR(self, "found partition with invalid version of type:",
+                 partition->GetFullyQualifiedName());
+      self->quit();
+      return;
+    }
+    auto partition_v0 = partition->partition_as_v0();
+    self->state.partition_chunk = chunk;
+    self->state.flatbuffer = partition_v0;
+    if (auto error = unpack(*self->state.flatbuffer, self->state)) {
+      VAST_ERROR(self, "failed to unpack partition:", render(error));
+      self->quit(std::move(error));
+      return;
+    }
+    if (id != self->state.id)
+      VAST_WARNING(self, "encountered partition id mismatch: restored",
+                   self->state.id, "from disk, expected", id);
+    // Delegate all deferred evaluations now that we have the partition chunk.
+    VAST_DEBUG(self, "delegates", self->state.deferred_evaluations.size(),
+               "deferred evaluations");
+    for (auto&& [expr, rp] :
+         std::exchange(self->state.deferred_evaluations, {}))
+      rp.delegate(static_cast<partition_actor>(self), std::move(expr));
+  };
+  auto on_error = [=](caf::error err) {
+    VAST_ERROR(self, "failed to load partition:", render(err));
+    // Deliver the error for all deferred evaluations.
+    for (auto&& [expr, rp] :
+         std::exchange(self->state.deferred_evaluations, {})) {
+      // Because of a deficiency in the typed_response_promise API, we must
+      // access the underlying response_promise to deliver the error.
+      caf::response_promise& untyped_rp = rp;
+      untyped_rp.deliver(static_cast<partition_actor>(self), err);
+    }
+    // Quit the partition.
+    self->quit(std::move(err));
+  };
+  // The header of the partition file tells us how much we need to read.
+  // Partition files of older versions contain their value indexes inline,
+  // so we map them as a whole.
+  self
+    ->request(filesystem, caf::infinite, atom::read_v, path, uint64_t{0},
+              uint64_t{partition_header_size})
     .then(
-      [=](chunk_ptr chunk) {
-        VAST_TRACE(self, VAST_ARG(chunk));
-        if (self->state.partition_chunk) {
-          VAST_WARNING(self, "ignores duplicate chunk");
+      [=](chunk_ptr header) {
+        auto size = partition_flatbuffer_size(as_bytes(header));
+        if (!size)
+          return on_error(std::move(size.error()));
+        if (*size == 0) {
+          self->request(filesystem, caf::infinite, atom::mmap_v, path)
+            .then(on_chunk, on_error);
           return;
         }
-        if (!chunk) {
-          VAST_ERROR(self, "got invalid chunk");
-          self->quit();
-          return;
-        }
-        // FlatBuffers <= 1.11 does not correctly use '::flatbuffers::soffset_t'
-        // over 'soffset_t' in FLATBUFFERS_MAX_BUFFER_SIZE.
-        using ::flatbuffers::soffset_t;
-        if (chunk->size() >= FLATBUFFERS_MAX_BUFFER_SIZE) {
-          VAST_ERROR("failed to load partition at", path, "because its size of",
-                     chunk->size(), "exceeds the maximum allowed size of",
-                     FLATBUFFERS_MAX_BUFFER_SIZE);
-          return self->quit();
-        }
-        // Deserialize chunk from the filesystem actor
-        auto partition = fbs::GetPartition(chunk->data());
-        if (partition->partition_type() != fbs::partition::Partition::v0) {
-          VAST_ERROR(self, "found partition with invalid version of type:",
-                     partition->GetFullyQualifiedName());
-          self->quit();
-          return;
-        }
-        auto partition_v0 = partition->partition_as_v0();
-        self->state.partition_chunk = chunk;
-        self->state.flatbuffer = partition_v0;
-        if (auto error = unpack(*self->state.flatbuffer, self->state)) {
-          VAST_ERROR(self, "failed to unpack partition:", render(error));
-          self->quit(std::move(error));
-          return;
-        }
-        if (id != self->state.id)
-          VAST_WARNING(self, "encountered partition id mismatch: restored",
-                       self->state.id, "from disk, expected", id);
-        // Delegate all deferred evaluations now that we have the partition chunk.
-        VAST_DEBUG(self, "delegates", self->state.deferred_evaluations.size(),
-                   "deferred evaluations");
-        for (auto&& [expr, rp] :
-             std::exchange(self->state.deferred_evaluations, {}))
-          rp.delegate(static_cast<partition_actor>(self), std::move(expr));
+        self->state.data_offset = partition_data_offset(*size);
+        self
+          ->request(filesystem, caf::infinite, atom::read_v, path,
+                    uint64_t{0}, uint64_t{*size})
+          .then(on_chunk, on_error);
       },
-      [=](caf::error err) {
-        VAST_ERROR(self, "failed to load partition:", render(err));
-        // Deliver the error for all deferred evaluations.
-        for (auto&& [expr, rp] :
-             std::exchange(self->state.deferred_evaluations, {})) {
-          // Because of a deficiency in the typed_response_promise API, we must
-          // access the underlying response_promise to deliver the error.
-          caf::response_promise& untyped_rp = rp;
-          untyped_rp.deliver(static_cast<partition_actor>(self), err);
-        }
-        // Quit the partition.
-        self->quit(std::move(err));
-      });
+      on_error);
   return {
     [=](const expression& expr) -> caf::result<std::vector<evaluation_triple>> {
       VAST_TRACE(self, VAST_ARG(expr));
@@ -0,0 +1,30 @@
+/******************************************************************************
+
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#include "vast/system/partition_file.hpp"
+
+#include "vast/concept/printable/vast/filesystem.hpp"
+#include "vast/logger.hpp"
+
+namespace vast::system {
+
+partition_file::partition_file(vast::path path) : path{std::move(path)} {
+  // nop
+}
+
+partition_file::~partition_file() {
+  if (obsolete && !rm(path))
+    VAST_WARNING_ANON("could not unlink partition at", path);
+}
+
+} // namespace vast::system
@@ -17,56 +17,192 @@
 #include "vast/detail/assert.hpp"
 #include "vast/io/read.hpp"
 #include "vast/io/save.hpp"
+#include "vast/io/write.hpp"
+#include "vast/logger.hpp"
 
 #include <caf/config_value.hpp>
 #include <caf/dictionary.hpp>
 #include <caf/result.hpp>
 #include <caf/settings.hpp>
 
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <string>
+
 namespace vast::system {
 
+size_t posix_filesystem_state::next_worker() const {
+  auto i = std::min_element(pending.begin(), pending.end());
+  return static_cast<size_t>(i - pending.begin());
+}
+
+size_t posix_filesystem_state::writer_for(const path& filename) const {
+  return std::hash<std::string>{}(filename.str()) % workers.size();
+}
+
+void posix_filesystem_state::finish(size_t worker,
+                                    filesystem_statistics::ops& op,
+                                    stopwatch::time_point start,
+                                    uint64_t bytes) {
+  VAST_ASSERT(pending[worker] > 0);
+  --pending[worker];
+  auto latency = std::chrono::duration_cast<duration>(stopwatch::now() - start);
+  op.latency += latency;
+  op.max_latency = std::max(op.max_latency, latency);
+  op.bytes += bytes;
+}
+
 filesystem_actor::behavior_type posix_filesystem(
-  filesystem_actor::stateful_pointer<posix_filesystem_state> self, path root) {
+  filesystem_actor::stateful_pointer<posix_filesystem_state> self, path root,
+  size_t num_workers) {
+  VAST_ASSERT(num_workers > 0);
+  for (size_t i = 0; i < num_workers; ++i)
+    self->state.workers.push_back(
+      self->spawn<caf::linked + caf::detached>(posix_filesystem_worker, root));
+  self->state.pending.resize(num_workers);
   return {
     [=](atom::write, const path& filename,
         chunk_ptr chk) -> caf::result<atom::ok> {
       VAST_ASSERT(chk != nullptr);
-      auto path = filename.is_absolute() ? filename : root / filename;
-      if (auto err = io::save(path, as_bytes(chk))) {
-        ++self->state.stats.writes.failed;
-        return err;
-      } else {
-        ++self->state.stats.writes.successful;
-        ++self->state.stats.writes.bytes += chk->size();
-        return atom::ok_v;
-      }
+      auto& st = self->state;
+      auto rp = self->make_response_promise<atom::ok>();
+      auto worker = st.writer_for(filename);
+      auto start = stopwatch::now();
+      auto bytes = chk->size();
+      ++st.pending[worker];
+      self
+        ->request(st.workers[worker], caf::infinite, atom::write_v, filename,
+                  std::move(chk))
+        .then(
+          [=](atom::ok) mutable {
+            auto& st = self->state;
+            ++st.stats.writes.successful;
+            st.finish(worker, st.stats.writes, start, bytes);
+            rp.deliver(atom::ok_v);
+          },
+          [=](const caf::error& err) mutable {
+            auto& st = self->state;
+            ++st.stats.writes.failed;
+            st.finish(worker, st.stats.writes, start, 0);
+            rp.deliver(err);
+          });
+      return rp;
+    },
+    [=](atom::append, const path& filename,
+        chunk_ptr chk) -> caf::result<atom::ok> {
+      VAST_ASSERT(chk != nullptr);
+      auto& st = self->state;
+      auto rp = self->make_response_promise<atom::ok>();
+      auto worker = st.writer_for(filename);
+      auto start = stopwatch::now();
+      auto bytes = chk->size();
+      ++st.pending[worker];
+      self
+        ->request(st.workers[worker], caf::infinite, atom::append_v, filename,
+                  std::move(chk))
+        .then(
+          [=](atom::ok) mutable {
+            auto& st = self->state;
+            ++st.stats.writes.successful;
+            st.finish(worker, st.stats.writes, start, bytes);
+            rp.deliver(atom::ok_v);
+          },
+          [=](const caf::error& err) mutable {
+            auto& st = self->state;
+            ++st.stats.writes.failed;
+            st.finish(worker, st.stats.writes, start, 0);
+            rp.deliver(err);
+          });
+      return rp;
     },
     [=](atom::read, const path& filename) -> caf::result<chunk_ptr> {
-      auto path = filename.is_absolute() ? filename : root / filename;
-      if (auto bytes = io::read(path)) {
-        ++self->state.stats.reads.successful;
-        ++self->state.stats.reads.bytes += bytes->size();
-        return chunk::make(std::move(*bytes));
-      } else {
-        ++self->state.stats.reads.failed;
-        return bytes.error();
-      }
+      auto& st = self->state;
+      auto rp = self->make_response_promise<chunk_ptr>();
+      auto worker = st.next_worker();
+      auto start = stopwatch::now();
+      ++st.pending[worker];
+      self
+        ->request(st.workers[worker], caf::infinite, atom::read_v, filename)
+        .then(
+          [=](const chunk_ptr& chk) mutable {
+            auto& st = self->state;
+            ++st.stats.reads.successful;
+            st.finish(worker, st.stats.reads, start, chk->size());
+            rp.deliver(chk);
+          },
+          [=](const caf::error& err) mutable {
+            auto& st = self->state;
+            ++st.stats.reads.failed;
+            st.finish(worker, st.stats.reads, start, 0);
+            rp.deliver(err);
+          });
+      return rp;
+    },
+    [=](atom::read, const path& filename, uint64_t offset,
+        uint64_t size) -> caf::result<chunk_ptr> {
+      auto& st = self->state;
+      auto rp = self->make_response_promise<chunk_ptr>();
+      auto worker = st.next_worker();
+      auto start = stopwatch::now();
+      ++st.pending[worker];
+      self
+        ->request(st.workers[worker], caf::infinite, atom::read_v, filename,
+                  offset, size)
+        .then(
+          [=](const chunk_ptr& chk) mutable {
+            auto& st = self->state;
+            ++st.stats.reads.successful;
+            st.finish(worker, st.stats.reads, start, chk->size());
+            rp.deliver(chk);
+          },
+          [=](const caf::error& err) mutable {
+            auto& st = self->state;
+            ++st.stats.reads.failed;
+            st.finish(worker, st.stats.reads, start, 0);
+            rp.deliver(err);
+          });
+      return rp;
     },
     [=](atom::mmap, const path& filename) -> caf::result<chunk_ptr> {
-      auto path = filename.is_absolute() ? filename : root / filename;
-      if (auto chk = chunk::mmap(path)) {
-        ++self->state.stats.mmaps.successful;
-        ++self->state.stats.mmaps.bytes += chk->size();
-        return chk;
-      } else {
-        ++self->state.stats.mmaps.failed;
-        return nullptr;
-      }
+      auto& st = self->state;
+      auto rp = self->make_response_promise<chunk_ptr>();
+      auto worker = st.next_worker();
+      auto start = stopwatch::now();
+      ++st.pending[worker];
+      self
+        ->request(st.workers[worker], caf::infinite, atom::mmap_v, filename)
+        .then(
+          [=](const chunk_ptr& chk) mutable {
+            auto& st = self->state;
+            if (chk) {
+              ++st.stats.mmaps.successful;
+              st.finish(worker, st.stats.mmaps, start, chk->size());
+            } else {
+              ++st.stats.mmaps.failed;
+              st.finish(worker, st.stats.mmaps, start, 0);
+            }
+            rp.deliver(chk);
+          },
+          [=](const caf::error& err) mutable {
+            auto& st = self->state;
+            ++st.stats.mmaps.failed;
+            st.finish(worker, st.stats.mmaps, start, 0);
+            rp.deliver(err);
+          });
+      return rp;
     },
     [=](atom::status, status_verbosity v) {
+      auto& st = self->state;
       auto result = caf::settings{};
       if (v >= status_verbosity::info)
         caf::put(result, "filesystem.type", "POSIX");
+      if (v >= status_verbosity::detailed) {
+        caf::put(result, "filesystem.workers", st.workers.size());
+        caf::put(result, "filesystem.queue-depth",
+                 std::accumulate(st.pending.begin(), st.pending.end(),
+                                 size_t{0}));
+      }
       if (v >= status_verbosity::debug) {
         auto& ops = put_dictionary(result, "filesystem.operations");
         auto add_stats = [&](auto& name, auto& stats) {
@@ -74,14 +210,64 @@ filesystem_actor::behavior_type posix_filesystem(
           caf::put(dict, "successful", stats.successful);
           caf::put(dict, "failed", stats.failed);
           caf::put(dict, "bytes", stats.bytes);
+          auto& latency = put_dictionary(dict, "latency");
+          auto total = stats.successful + stats.failed;
+          caf::put(latency, "mean",
+                   total > 0 ? stats.latency / total : duration::zero());
+          caf::put(latency, "max", stats.max_latency);
         };
-        add_stats("writes", self->state.stats.writes);
-        add_stats("reads", self->state.stats.reads);
-        add_stats("mmaps", self->state.stats.mmaps);
+        add_stats("writes", st.stats.writes);
+        add_stats("reads", st.stats.reads);
+        add_stats("mmaps", st.stats.mmaps);
       }
       return result;
     },
   };
 }
 
+filesystem_actor::behavior_type
+posix_filesystem_worker(filesystem_actor::pointer self, path root) {
+  return {
+    [=](atom::write, const path& filename,
+        chunk_ptr chk) -> caf::result<atom::ok> {
+      VAST_ASSERT(chk != nullptr);
+      auto path = filename.is_absolute() ? filename : root / filename;
+      if (auto err = io::save(path, as_bytes(chk)))
+        return err;
+      return atom::ok_v;
+    },
+    [=](atom::append, const path& filename,
+        chunk_ptr chk) -> caf::result<atom::ok> {
+      VAST_ASSERT(chk != nullptr);
+      auto path = filename.is_absolute() ? filename : root / filename;
+      if (auto err = io::append(path, as_bytes(chk)))
+        return err;
+      return atom::ok_v;
+    },
+    [=](atom::read, const path& filename) -> caf::result<chunk_ptr> {
+      auto path = filename.is_absolute() ? filename : root / filename;
+      auto bytes = io::read(path);
+      if (!bytes)
+        return bytes.error();
+      return chunk::make(std::move(*bytes));
+    },
+    [=](atom::read, const path& filename, uint64_t offset,
+        uint64_t size) -> caf::result<chunk_ptr> {
+      auto path = filename.is_absolute() ? filename : root / filename;
+      auto bytes = io::read(path, offset, size);
+      if (!bytes)
+        return bytes.error();
+      return chunk::make(std::move(*bytes));
+    },
+    [=](atom::mmap, const path& filename) -> caf::result<chunk_ptr> {
+      auto path = filename.is_absolute() ? filename : root / filename;
+      return chunk::mmap(path);
+    },
+    [=](atom::status, status_verbosity) {
+      VAST_DEBUG(self, "ignores status request");
+      return caf::settings{};
+    },
+  };
+}
+
 } // namespace vast::system
@@ -37,12 +37,40 @@ maybe_actor spawn_archive(node_actor* self, spawn_arguments& args) {
   namespace sd = vast::defaults::system;
   if (!args.empty())
     return unexpected_arguments(args);
-  auto segments = get_or(args.inv.options, "vast.segments", sd::segments);
+  auto segment_cache_size
+    = 1_MiB
+      * get_or(args.inv.options, "vast.segment-cache-size",
+               sd::segment_cache_size);
   auto max_segment_size
     = 1_MiB
       * get_or(args.inv.options, "vast.max-segment-size", sd::max_segment_size);
-  auto handle
-    = self->spawn(archive, args.dir / args.label, segments, max_segment_size);
+  if (auto segments = caf::get_if<size_t>(&args.inv.options, "vast.segments")) {
+    VAST_WARNING(self, "got the deprecated option vast.segments; use "
+                       "vast.segment-cache-size instead");
+    // The maximum segment size refers to the table slices before
+    // compression, whereas the cache weighs segments by the size of their
+    // compressed files. This keeps about as many segments cached as the
+    // former option did, or more.
+    if (!caf::get_if(&args.inv.options, "vast.segment-cache-size"))
+      segment_cache_size = *segments * max_segment_size;
+  }
+  if (segment_cache_size == 0)
+    return make_error(ec::invalid_configuration,
+                      "vast.segment-cache-size must be positive");
+  auto max_sessions = get_or(args.inv.options, "vast.max-archive-sessions",
+                             sd::max_archive_sessions);
+  if (max_sessions == 0)
+    return make_error(ec::invalid_configuration,
+                      "vast.max-archive-sessions must be positive");
+  auto read_ahead = get_or(args.inv.options, "vast.segment-read-ahead",
+                           sd::segment_read_ahead);
+  auto compaction_budget
+    = 1_MiB
+      * get_or(args.inv.options, "vast.segment-compaction-budget",
+               sd::segment_compaction_budget);
+  auto handle = self->spawn(archive, args.dir / args.label, segment_cache_size,
+                            max_segment_size, max_sessions, read_ahead,
+                            compaction_budget);
   VAST_VERBOSE(self, "spawned the archive");
   if (auto accountant = self->state.registry.find_by_label("accountant"))
     self->send(handle, caf::actor_cast<accountant_actor>(accountant));
@@ -13,13 +13,18 @@
 
 #include "vast/system/spawn_index.hpp"
 
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/time.hpp"
 #include "vast/defaults.hpp"
 #include "vast/error.hpp"
 #include "vast/logger.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/index.hpp"
 #include "vast/system/node.hpp"
 #include "vast/system/spawn_arguments.hpp"
 
+using namespace vast::binary_byte_literals;
+
 namespace vast::system {
 
 maybe_actor spawn_index(node_actor* self, spawn_arguments& args) {
@@ -33,15 +38,54 @@ maybe_actor spawn_index(node_actor* self, spawn_arguments& args) {
   if (!filesystem)
     return make_error(ec::lookup_error, "failed to find filesystem actor");
   namespace sd = vast::defaults::system;
+  auto partition_window = duration{sd::partition_window};
+  if (auto str = caf::get_if<std::string>(&args.inv.options,
+                                          "vast.partition-window")) {
+    auto parsed = to<duration>(*str);
+    if (!parsed)
+      return parsed.error();
+    partition_window = *parsed;
+  }
+  auto active_partition_timeout = duration{sd::active_partition_timeout};
+  if (auto str = caf::get_if<std::string>(&args.inv.options,
+                                          "vast.active-partition-timeout")) {
+    auto parsed = to<duration>(*str);
+    if (!parsed)
+      return parsed.error();
+    active_partition_timeout = *parsed;
+  }
+  auto partition_cache_size
+    = opt("vast.partition-cache-size", sd::partition_cache_size);
+  if (auto partitions = caf::get_if<size_t>(&args.inv.options,
+                                            "vast.max-resident-partitions")) {
+    VAST_WARNING(self, "got the deprecated option "
+                       "vast.max-resident-partitions; use "
+                       "vast.partition-cache-size instead");
+    // Scale the default cache size, which corresponds to the former default
+    // number of partitions, unless the new option is set as well.
+    if (!caf::get_if(&args.inv.options, "vast.partition-cache-size"))
+      partition_cache_size = *partitions * sd::partition_cache_size
+                             / sd::max_in_mem_partitions;
+  }
   auto handle = self->spawn(
     index, filesystem, args.dir / args.label,
     opt("vast.max-partition-size", sd::max_partition_size),
-    opt("vast.max-resident-partitions", sd::max_in_mem_partitions),
+    1_MiB * partition_cache_size,
     opt("vast.max-taste-partitions", sd::taste_partitions),
-    opt("vast.max-queries", sd::num_query_supervisors));
+    opt("vast.max-queries", sd::num_query_supervisors),
+    opt("vast.indexing-workers", sd::indexing_workers), partition_window,
+    opt("vast.max-active-partitions", sd::max_active_partitions),
+    active_partition_timeout,
+    opt("vast.partition-compaction-budget", sd::partition_compaction_budget),
+    opt("vast.synopsis-loaders", sd::synopsis_loaders),
+    opt("vast.lazy-synopses", sd::lazy_synopses),
+    opt("vast.meta-index-shards", sd::meta_index_shards));
   VAST_VERBOSE(self, "spawned the index");
   if (auto accountant = self->state.registry.find_by_label("accountant"))
     self->send(handle, caf::actor_cast<accountant_actor>(accountant));
+  // The index reads the events of the partitions it merges from the archive.
+  if (auto archive = self->state.registry.find_by_label("archive"))
+    self->send(handle, caf::actor_cast<archive_actor>(archive));
   return caf::actor_cast<caf::actor>(handle);
 }
 
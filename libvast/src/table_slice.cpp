@@ -16,6 +16,7 @@
 #include "vast/chunk.hpp"
 #include "vast/defaults.hpp"
 #include "vast/detail/assert.hpp"
+#include "vast/detail/lz4.hpp"
 #include "vast/detail/overload.hpp"
 #include "vast/error.hpp"
 #include "vast/expression.hpp"
@@ -204,6 +205,16 @@ table_slice::table_slice(const fbs::FlatTableSlice& flat_slice,
   *this = table_slice{std::move(chunk), verify};
 }
 
+table_slice::table_slice(const fbs::CompressedTableSlice& compressed_slice,
+                         enum verify verify) noexcept {
+  const auto* compressed = compressed_slice.data();
+  if (!compressed)
+    return;
+  *this = decompress(span{reinterpret_cast<const byte*>(compressed->data()),
+                          compressed->size()},
+                     compressed_slice.uncompressed_size(), verify);
+}
+
 table_slice::table_slice(const table_slice& other) noexcept
   : chunk_{other.chunk_}, offset_{other.offset_}, state_{other.state_} {
   // nop
@@ -532,6 +543,29 @@ split(const table_slice& slice, size_t partition_point) {
   return {std::move(xs.front()), std::move(xs.back())};
 }
 
+table_slice decompress(span<const byte> compressed, size_t uncompressed_size,
+                       enum table_slice::verify verify) noexcept {
+  // The size comes from disk, so we reject sizes that no valid table slice
+  // can have before allocating the buffer.
+  // FlatBuffers <= 1.11 does not correctly use '::flatbuffers::soffset_t' over
+  // 'soffset_t' in FLATBUFFERS_MAX_BUFFER_SIZE.
+  using ::flatbuffers::soffset_t;
+  auto max_size = detail::lz4::decompress_bound(compressed.size());
+  if (uncompressed_size > max_size
+      || uncompressed_size >= FLATBUFFERS_MAX_BUFFER_SIZE) {
+    VAST_ERROR_ANON("failed to decompress table slice of invalid size",
+                    uncompressed_size);
+    return {};
+  }
+  auto buffer = std::vector<byte>(uncompressed_size);
+  if (detail::lz4::decompress(compressed, as_writeable_bytes(buffer))
+      != buffer.size()) {
+    VAST_ERROR_ANON("failed to decompress table slice");
+    return {};
+  }
+  return table_slice{chunk::make(std::move(buffer)), verify};
+}
+
 uint64_t rows(const std::vector<table_slice>& slices) {
   auto result = uint64_t{0};
   for (auto& slice : slices)
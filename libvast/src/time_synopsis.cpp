@@ -22,6 +22,7 @@ time_synopsis::time_synopsis(vast::type x)
 
 time_synopsis::time_synopsis(time start, time end)
   : min_max_synopsis<time>{time_type{}, start, end} {
+  has_nil_ = true;
 }
 
 bool time_synopsis::equals(const synopsis& other) const noexcept {
@@ -13,11 +13,16 @@
 
 #include "vast/value_index.hpp"
 
+#include "vast/chunk.hpp"
+#include "vast/fbs/utils.hpp"
 #include "vast/value_index_factory.hpp"
 
+#include <caf/binary_serializer.hpp>
 #include <caf/deserializer.hpp>
 #include <caf/serializer.hpp>
 
+#include <cstdint>
+
 namespace vast {
 
 value_index::value_index(vast::type t, caf::settings opts)
@@ -145,4 +150,57 @@ caf::error inspect(caf::deserializer& source, value_index_ptr& x) {
   return x->deserialize(source);
 }
 
+caf::expected<flatbuffers::Offset<fbs::value_index::v0>>
+pack(flatbuffers::FlatBufferBuilder& builder, const value_index_ptr& x) {
+  // Serialize the index with a bitmap table in place, which moves the blocks
+  // of all bitmaps out of the byte stream.
+  std::vector<char> buf;
+  ewah_bitmap_table table;
+  caf::binary_serializer sink{nullptr, buf};
+  if (auto error = sink(x))
+    return error;
+  std::vector<flatbuffers::Offset<fbs::ewah_bitmap::v0>> bitmaps;
+  bitmaps.reserve(table.bitmaps().size());
+  for (auto& bm : table.bitmaps()) {
+    auto blocks = bm.blocks();
+    auto blocks_offset = builder.CreateVector(blocks.data(), blocks.size());
+    bitmaps.push_back(fbs::ewah_bitmap::Createv0(builder, blocks_offset,
+                                                 bm.last_marker(), bm.size()));
+  }
+  auto bitmaps_offset = builder.CreateVector(bitmaps);
+  auto data = builder.CreateVector(reinterpret_cast<const uint8_t*>(buf.data()),
+                                   buf.size());
+  fbs::value_index::v0Builder value_index_builder(builder);
+  value_index_builder.add_data(data);
+  value_index_builder.add_bitmaps(bitmaps_offset);
+  return value_index_builder.Finish();
+}
+
+caf::error
+unpack(const fbs::value_index::v0& x, value_index_ptr& y, chunk_ptr owner) {
+  if (!x.data())
+    return make_error(ec::format_error, "missing data in value index");
+  // Indexes without a bitmap table contain their bitmaps in the byte stream.
+  if (!x.bitmaps())
+    return fbs::deserialize_bytes(x.data(), y);
+  std::vector<ewah_bitmap> bitmaps;
+  bitmaps.reserve(x.bitmaps()->size());
+  for (auto bm : *x.bitmaps()) {
+    auto blocks = bm->blocks();
+    if (!blocks)
+      return make_error(ec::format_error, "missing blocks in bitmap");
+    if (reinterpret_cast<uintptr_t>(blocks->data())
+          % alignof(ewah_bitmap::block_type)
+        != 0)
+      return make_error(ec::format_error, "misaligned blocks in bitmap");
+    if (bm->num_bits() > 0 && bm->last_marker() + 1 >= blocks->size())
+      return make_error(ec::format_error, "invalid last marker in bitmap");
+    auto view = span<const ewah_bitmap::block_type>{blocks->data(),
+                                                    blocks->size()};
+    bitmaps.emplace_back(view, bm->last_marker(), bm->num_bits(), owner);
+  }
+  ewah_bitmap_table table{std::move(bitmaps)};
+  return fbs::deserialize_bytes(x.data(), y);
+}
+
 } // namespace vast
@@ -24,6 +24,8 @@
 #include "vast/concept/hashable/xxhash.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
+#include "vast/concept/parseable/vast/subnet.hpp"
+#include "vast/defaults.hpp"
 #include "vast/si_literals.hpp"
 #include "vast/synopsis.hpp"
 #include "vast/synopsis_factory.hpp"
@@ -89,9 +91,11 @@ TEST(construction based on partition size) {
 }
 
 TEST(updated params after shrinking) {
-  opts["buffer-ips"] = true;
-  opts["max-partition-size"] = 1_Mi;
-  auto ptr = factory<synopsis>::make(address_type{}, opts);
+  // Without room for an exact set, shrinking produces a Bloom filter.
+  bloom_filter_parameters xs;
+  xs.p = defaults::system::address_synopsis_fprate;
+  auto ptr = make_buffered_address_synopsis<xxhash64>(address_type{}, xs, 0);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
   ptr->add(to_addr_view("192.168.0.1"));
   ptr->add(to_addr_view("192.168.0.2"));
   ptr->add(to_addr_view("192.168.0.3"));
@@ -112,4 +116,26 @@ TEST(updated params after shrinking) {
   CHECK(!r2);
 }
 
+TEST(exact set after shrinking) {
+  using namespace vast::test::nft;
+  opts["buffer-ips"] = true;
+  opts["max-partition-size"] = 1_Mi;
+  auto ptr = factory<synopsis>::make(address_type{}, opts);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  ptr->add(to_addr_view("192.168.0.1"));
+  ptr->add(to_addr_view("192.168.0.2"));
+  auto shrinked = ptr->shrink();
+  REQUIRE_NOT_EQUAL(shrinked, nullptr);
+  CHECK(has_set_attribute(shrinked->type()));
+  auto recovered = roundtrip(std::move(shrinked));
+  REQUIRE(recovered);
+  auto verify = verifier{recovered.get()};
+  verify(to_addr_view("192.168.0.1"), {N, N, N, N, N, N, T, T, N, N, N, N});
+  verify(to_addr_view("192.168.0.3"), {N, N, N, N, N, N, F, T, N, N, N, N});
+  MESSAGE("subnet membership");
+  auto sn = unbox(to<subnet>("192.168.0.0/24"));
+  CHECK_EQUAL(recovered->lookup(in, make_data_view(sn)), T);
+  CHECK_EQUAL(recovered->lookup(not_in, make_data_view(sn)), F);
+}
+
 FIXTURE_SCOPE_END()
@@ -12,15 +12,23 @@
  ******************************************************************************/
 
 #include "vast/bitmap.hpp"
+#include "vast/chunk.hpp"
 #include "vast/ewah_bitmap.hpp"
 #include "vast/ids.hpp"
 #include "vast/null_bitmap.hpp"
 #include "vast/concept/printable/to_string.hpp"
 #include "vast/concept/printable/vast/bitmap.hpp"
+#include "vast/detail/deserialize.hpp"
+#include "vast/detail/serialize.hpp"
 
 #define SUITE bitmap
 #include "vast/test/test.hpp"
 
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <vector>
+
 using namespace vast;
 using namespace std::string_literals;
 
@@ -912,3 +920,91 @@ TEST(EWAH RLE print 2) {
   //CHECK_EQUAL(str, "1F1T421F2T");
   CHECK_EQUAL(str, "1F1T62F320F39F2T");
 }
+
+TEST(EWAH borrowed blocks) {
+  ewah_bitmap bm;
+  bm.append_bits(true, 10);
+  bm.append_bits(false, 1000);
+  bm.append_block(0xf00);
+  auto blocks = std::vector<ewah_bitmap::block_type>(bm.blocks().begin(),
+                                                     bm.blocks().end());
+  auto owner = chunk::make(blocks.data(),
+                           blocks.size() * sizeof(ewah_bitmap::block_type),
+                           []() noexcept {});
+  auto view = span<const ewah_bitmap::block_type>{blocks};
+  ewah_bitmap borrowed{view, bm.last_marker(), bm.size(), owner};
+  CHECK(borrowed.borrowed());
+  CHECK_EQUAL(borrowed, bm);
+  CHECK_EQUAL(rank<1>(borrowed), rank<1>(bm));
+  CHECK_EQUAL(to_string(borrowed), to_string(bm));
+  CHECK_EQUAL(borrowed.blocks().data(), blocks.data());
+  MESSAGE("copies share the borrowed blocks");
+  auto copy = borrowed;
+  CHECK(copy.borrowed());
+  CHECK_EQUAL(copy.blocks().data(), blocks.data());
+  MESSAGE("modifications copy the borrowed blocks");
+  copy.append_bits(true, 42);
+  bm.append_bits(true, 42);
+  CHECK(!copy.borrowed());
+  CHECK_EQUAL(copy, bm);
+  CHECK_EQUAL(borrowed.size(), bm.size() - 42);
+  CHECK(std::equal(blocks.begin(), blocks.end(), borrowed.blocks().begin()));
+}
+
+TEST(EWAH serialization format) {
+  ewah_bitmap bm;
+  bm.append_bits(true, 10);
+  bm.append_bits(false, 1000);
+  bm.append_block(0xf00);
+  auto blocks = ewah_bitmap::block_vector(bm.blocks().begin(),
+                                          bm.blocks().end());
+  auto last_marker = bm.last_marker();
+  auto num_bits = bm.size();
+  std::vector<char> expected;
+  REQUIRE_EQUAL(detail::serialize(expected, blocks, last_marker, num_bits),
+                caf::none);
+  std::vector<char> buffer;
+  REQUIRE_EQUAL(detail::serialize(buffer, bm), caf::none);
+  CHECK(buffer == expected);
+  MESSAGE("borrowed blocks serialize like owned blocks");
+  auto owner = chunk::make(blocks.data(),
+                           blocks.size() * sizeof(ewah_bitmap::block_type),
+                           []() noexcept {});
+  auto view = span<const ewah_bitmap::block_type>{blocks};
+  ewah_bitmap borrowed{view, last_marker, num_bits, owner};
+  buffer.clear();
+  REQUIRE_EQUAL(detail::serialize(buffer, borrowed), caf::none);
+  CHECK(buffer == expected);
+  MESSAGE("tables of other threads do not apply");
+  std::promise<void> installed;
+  std::promise<void> serialized;
+  auto other_bitmaps = size_t{0};
+  auto other = std::thread{[&] {
+    ewah_bitmap_table table;
+    installed.set_value();
+    serialized.get_future().wait();
+    other_bitmaps = table.bitmaps().size();
+  }};
+  installed.get_future().wait();
+  buffer.clear();
+  auto err = detail::serialize(buffer, bm);
+  serialized.set_value();
+  other.join();
+  REQUIRE_EQUAL(err, caf::none);
+  CHECK_EQUAL(other_bitmaps, 0u);
+  CHECK(buffer == expected);
+  ewah_bitmap copy;
+  REQUIRE_EQUAL(detail::deserialize(buffer, copy), caf::none);
+  CHECK_EQUAL(copy, bm);
+  MESSAGE("tables replace the blocks with a position");
+  {
+    ewah_bitmap_table table;
+    buffer.clear();
+    REQUIRE_EQUAL(detail::serialize(buffer, bm), caf::none);
+    REQUIRE_EQUAL(table.bitmaps().size(), 1u);
+    CHECK_EQUAL(table.bitmaps()[0], bm);
+    expected.clear();
+    REQUIRE_EQUAL(detail::serialize(expected, uint64_t{0}), caf::none);
+    CHECK(buffer == expected);
+  }
+}
@@ -115,3 +115,59 @@ TEST(MRU cache insertion) {
 }
 
 FIXTURE_SCOPE_END()
+
+TEST(weighted cache) {
+  auto weigh = [](const std::string&, const int& x) -> size_t { return x; };
+  detail::cache<std::string, int> xs{10, weigh};
+  CHECK(xs.emplace("foo", 3).second);
+  CHECK(xs.emplace("bar", 4).second);
+  CHECK_EQUAL(xs.weight(), 7u);
+  // Exceeding the capacity evicts the least recently used element.
+  CHECK(xs.emplace("baz", 5).second);
+  CHECK_EQUAL(xs.size(), 2u);
+  CHECK_EQUAL(xs.weight(), 9u);
+  CHECK(xs.find("foo") == xs.end());
+  // An element that exceeds the capacity on its own evicts everything else.
+  CHECK(xs.emplace("qux", 11).second);
+  CHECK_EQUAL(xs.size(), 1u);
+  CHECK_EQUAL(xs.weight(), 11u);
+  CHECK_EQUAL(xs.erase("qux"), 1u);
+  CHECK_EQUAL(xs.weight(), 0u);
+}
+
+TEST(2Q cache scan resistance) {
+  detail::cache<std::string, int, detail::two_queue> xs{4};
+  CHECK(xs.emplace("foo", 1).second);
+  CHECK(xs.emplace("bar", 2).second);
+  // Accessing elements again protects them.
+  CHECK(xs.find("foo") != xs.end());
+  CHECK(xs.find("bar") != xs.end());
+  // A sweep over many elements only evicts elements on probation.
+  for (auto i = 0; i < 10; ++i)
+    xs.emplace("sweep" + std::to_string(i), i);
+  CHECK_EQUAL(xs.size(), 4u);
+  CHECK(xs.contains("foo"));
+  CHECK(xs.contains("bar"));
+  CHECK(xs.contains("sweep9"));
+  CHECK(!xs.contains("sweep0"));
+  CHECK_EQUAL(xs.statistics().hits, 2u);
+  CHECK_EQUAL(xs.statistics().misses, 0u);
+  CHECK_EQUAL(xs.statistics().evictions, 8u);
+}
+
+TEST(2Q cache promotes recently evicted elements) {
+  detail::cache<std::string, int, detail::two_queue> xs{2};
+  CHECK(xs.emplace("foo", 1).second);
+  CHECK(xs.emplace("bar", 2).second);
+  CHECK(xs.emplace("baz", 3).second);
+  CHECK(!xs.contains("foo"));
+  CHECK(xs.find("foo") == xs.end());
+  CHECK_EQUAL(xs.statistics().misses, 1u);
+  // The element returns shortly after its eviction, so it becomes protected
+  // and survives further insertions.
+  CHECK(xs.emplace("foo", 1).second);
+  CHECK(xs.emplace("qux", 4).second);
+  CHECK(xs.emplace("quux", 5).second);
+  CHECK(xs.contains("foo"));
+  CHECK(xs.contains("quux"));
+}
@@ -66,3 +66,44 @@ TEST(resizing) {
   cache.resize(0);
   CHECK_EQUAL(cache.size(), 0u);
 }
+
+struct value_weigher {
+  size_t operator()(int, int x) const {
+    return x;
+  }
+};
+
+TEST(weighing) {
+  vast::detail::lru_cache<int, int, int_factory, value_weigher> cache(
+    10, int_factory{});
+  cache.get_or_load(3);
+  cache.get_or_load(4);
+  CHECK_EQUAL(cache.weight(), 7u);
+  // Check that exceeding the maximum weight dropped the oldest element.
+  cache.get_or_load(5);
+  CHECK_EQUAL(cache.size(), 2u);
+  CHECK_EQUAL(cache.weight(), 9u);
+  CHECK(!cache.contains(3));
+  // Check that an element that exceeds the maximum weight on its own remains.
+  cache.get_or_load(11);
+  CHECK_EQUAL(cache.size(), 1u);
+  CHECK_EQUAL(cache.weight(), 11u);
+  cache.drop(11);
+  CHECK_EQUAL(cache.weight(), 0u);
+}
+
+TEST(statistics) {
+  vast::detail::lru_cache<int, int, int_factory, vast::detail::unit_weigher,
+                          vast::detail::two_queue>
+    cache(2, int_factory{});
+  cache.get_or_load(0);
+  cache.get_or_load(0);
+  cache.get_or_load(1);
+  cache.get_or_load(2);
+  CHECK_EQUAL(cache.statistics().hits, 1u);
+  CHECK_EQUAL(cache.statistics().misses, 3u);
+  CHECK_EQUAL(cache.statistics().evictions, 1u);
+  // The sweep over 1 and 2 did not evict the protected element 0.
+  CHECK(cache.contains(0));
+  CHECK(cache.contains(2));
+}
@@ -14,6 +14,8 @@
 #include "vast/fwd.hpp"
 
 #include "vast/chunk.hpp"
+#include "vast/concept/parseable/to.hpp"
+#include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/defaults.hpp"
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/expression.hpp"
@@ -57,9 +59,9 @@ TEST(uuid roundtrip) {
 
 TEST(index roundtrip) {
   vast::system::index_state state(/*self = */ nullptr);
-  // The active partition is not supposed to appear in the
+  // The active partitions are not supposed to appear in the
   // created flatbuffer
-  state.active_partition.id = vast::uuid::random();
+  state.active_partitions["zeek.conn"].id = vast::uuid::random();
   // Both unpersisted and persisted partitions should show up in the created
   // flatbuffer.
   state.unpersisted[vast::uuid::random()] = nullptr;
@@ -184,7 +186,7 @@ TEST(full partition roundtrip) {
     directory); // `directory` is provided by the unit test fixture
   auto partition_uuid = vast::uuid::random();
   auto partition = sys.spawn(vast::system::active_partition, partition_uuid, fs,
-                             caf::settings{}, caf::settings{});
+                             caf::settings{}, caf::settings{}, size_t{0});
   run();
   REQUIRE(partition);
   // Add data to the partition.
@@ -204,13 +206,14 @@ TEST(full partition roundtrip) {
     = self->request(partition, caf::infinite, vast::atom::persist_v,
                     persist_path, vast::system::index_actor{});
   run();
-  persist_promise.receive([](vast::atom::ok) { CHECK("persisting done"); },
+  persist_promise.receive([](uint64_t) { CHECK("persisting done"); },
                           [](caf::error err) { FAIL(err); });
   self->send_exit(partition, caf::exit_reason::user_shutdown);
   // Spawn a read-only partition from this chunk and try to query the data we
   // added. We make two queries, one "#type"-query and one "normal" query
-  auto readonly_partition = sys.spawn(vast::system::passive_partition,
-                                      partition_uuid, fs, persist_path);
+  auto readonly_partition = sys.spawn(
+    vast::system::passive_partition, partition_uuid, fs,
+    std::make_shared<vast::system::partition_file>(persist_path));
   REQUIRE(readonly_partition);
   run();
   auto test_expression = [&](const vast::expression& expression,
@@ -261,4 +264,75 @@ TEST(full partition roundtrip) {
   run();
 }
 
+// This test does the same for a partition that indexes its fields with a pool
+// of indexing workers, and additionally queries the active partition.
+TEST(full partition roundtrip with indexing workers) {
+  auto fs = self->spawn(vast::system::posix_filesystem, directory);
+  auto partition_uuid = vast::uuid::random();
+  auto partition = sys.spawn(vast::system::active_partition, partition_uuid, fs,
+                             caf::settings{}, caf::settings{}, size_t{2});
+  run();
+  REQUIRE(partition);
+  auto layout = vast::record_type{
+    {"x", vast::count_type{}},
+    {"y", vast::count_type{}},
+    {"z", vast::count_type{}},
+  }.name("w");
+  auto builder = vast::msgpack_table_slice_builder::make(layout);
+  CHECK(builder->add(0u, 1u, 2u));
+  CHECK(builder->add(1u, 2u, 3u));
+  auto slice = builder->finish();
+  slice.offset(0);
+  auto data = std::vector<vast::table_slice>{slice};
+  auto src = vast::detail::spawn_container_source(sys, data, partition);
+  REQUIRE(src);
+  run();
+  auto test_expression = [&](const auto& partition, std::string_view query,
+                             size_t expected_ids) {
+    auto expr = unbox(vast::to<vast::expression>(query));
+    auto rp = self->request(partition, caf::infinite, expr);
+    run();
+    rp.receive(
+      [&](std::vector<vast::system::evaluation_triple> triples) {
+        REQUIRE_EQUAL(triples.size(), 1u);
+        auto& [position, curried_predicate, actor] = triples[0];
+        auto rp = self->request(actor, caf::infinite, curried_predicate);
+        run();
+        rp.receive(
+          [&](vast::ids ids) { CHECK_EQUAL(rank(ids), expected_ids); },
+          [](caf::error err) { FAIL(err); });
+      },
+      [](caf::error err) { FAIL(err); });
+  };
+  test_expression(partition, "y == 2", 1u);
+  test_expression(partition, "z > 1", 2u);
+  vast::path persist_path = "test-partition";
+  auto persist_promise
+    = self->request(partition, caf::infinite, vast::atom::persist_v,
+                    persist_path, vast::system::index_actor{});
+  run();
+  persist_promise.receive([](uint64_t) { CHECK("persisting done"); },
+                          [](caf::error err) { FAIL(err); });
+  self->send_exit(partition, caf::exit_reason::user_shutdown);
+  auto file = std::make_shared<vast::system::partition_file>(
+    (directory / persist_path).complete());
+  auto readonly_partition = sys.spawn(vast::system::passive_partition,
+                                      partition_uuid, fs, file);
+  REQUIRE(readonly_partition);
+  run();
+  MESSAGE("erasing a loaded partition keeps its file until it is unloaded");
+  auto filename = file->path;
+  file->obsolete = true;
+  file.reset();
+  test_expression(readonly_partition, "x == 1", 1u);
+  test_expression(readonly_partition, "y == 2", 1u);
+  test_expression(readonly_partition, "z > 1", 2u);
+  CHECK(exists(filename));
+  self->send_exit(readonly_partition, caf::exit_reason::user_shutdown);
+  run();
+  CHECK(!exists(filename));
+  self->send_exit(fs, caf::exit_reason::user_shutdown);
+  run();
+}
+
 FIXTURE_SCOPE_END()
@@ -92,7 +92,7 @@ struct mock_partition {
   interval range;
 };
 
-struct fixture {
+struct fixture : fixtures::deterministic_actor_system {
   fixture() {
     MESSAGE("register synopsis factory");
     factory<synopsis>::initialize();
@@ -211,6 +211,23 @@ TEST(attribute extractor - type) {
   CHECK_EQUAL(lookup("#type !~ /x/"), ids);
 }
 
+TEST(erase) {
+  MESSAGE("erased partitions are no longer candidates");
+  meta_idx.erase(ids[1]);
+  CHECK_EQUAL(attr_time_query("00:00:25"), empty());
+  CHECK_EQUAL(lookup("#type == \"foobar\""), std::vector<uuid>{ids[3]});
+  auto expected = std::vector<uuid>{ids[0], ids[2]};
+  CHECK_EQUAL(attr_time_query("00:00:10", "00:01:00"), expected);
+}
+
+TEST(serialization) {
+  MESSAGE("a deserialized meta index rebuilds its field columns");
+  meta_idx = roundtrip(meta_idx);
+  CHECK_EQUAL(attr_time_query("00:00:25"), slice(1));
+  CHECK_EQUAL(attr_time_query("00:00:10", "00:00:30"), slice(0, 2));
+  CHECK_EQUAL(lookup("#type == \"foo\""), (std::vector<uuid>{ids[0], ids[2]}));
+}
+
 FIXTURE_SCOPE_END()
 
 TEST(meta index with bool synopsis) {
@@ -236,22 +253,30 @@ TEST(meta index with bool synopsis) {
   meta_idx.add(id3, slice);
   MESSAGE("test custom synopsis");
   auto lookup = [&](std::string_view expr) {
-    return meta_idx.lookup(unbox(to<expression>(expr)));
+    auto result = meta_idx.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto sorted = [](std::vector<uuid> xs) {
+    std::sort(xs.begin(), xs.end());
+    return xs;
   };
   auto expected1 = std::vector<uuid>{id1};
   auto expected2 = std::vector<uuid>{id2};
+  // The partition with a nil value matches both negations.
+  auto expected3 = sorted({id1, id3});
+  auto expected4 = sorted({id2, id3});
   // Check by field name field.
   CHECK_EQUAL(lookup("x == T"), expected1);
-  CHECK_EQUAL(lookup("x != F"), expected1);
+  CHECK_EQUAL(lookup("x != F"), expected3);
   CHECK_EQUAL(lookup("x == F"), expected2);
-  CHECK_EQUAL(lookup("x != T"), expected2);
+  CHECK_EQUAL(lookup("x != T"), expected4);
   // Same as above, different extractor.
   CHECK_EQUAL(lookup(":bool == T"), expected1);
-  CHECK_EQUAL(lookup(":bool != F"), expected1);
+  CHECK_EQUAL(lookup(":bool != F"), expected3);
   CHECK_EQUAL(lookup(":bool == F"), expected2);
-  CHECK_EQUAL(lookup(":bool != T"), expected2);
-  auto all = std::vector<uuid>{id1, id2, id3};
-  std::sort(all.begin(), all.end());
+  CHECK_EQUAL(lookup(":bool != T"), expected4);
+  auto all = sorted({id1, id2, id3});
   // Invalid schema: y does not a valid field
   CHECK_EQUAL(lookup("y == T"), all);
   CHECK_EQUAL(lookup("y != F"), all);
@@ -259,6 +284,168 @@ TEST(meta index with bool synopsis) {
   CHECK_EQUAL(lookup("y != T"), all);
 }
 
+TEST(meta index with string synopsis) {
+  MESSAGE("generate slice data and add it to the meta index");
+  meta_index meta_idx;
+  put(meta_idx.factory_options(), "max-partition-size", 1024);
+  auto layout = record_type{{"host", string_type{}}}.name("test");
+  auto builder = factory<table_slice_builder>::make(
+    defaults::import::table_slice_type, layout);
+  CHECK(builder->add(make_data_view("foo.com")));
+  auto slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id1 = uuid::random();
+  meta_idx.add(id1, slice);
+  CHECK(builder->add(make_data_view("evil.com")));
+  slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id2 = uuid::random();
+  meta_idx.add(id2, slice);
+  auto lookup = [&](std::string_view expr) {
+    return meta_idx.lookup(unbox(to<expression>(expr)));
+  };
+  auto all = std::vector<uuid>{id1, id2};
+  std::sort(all.begin(), all.end());
+  MESSAGE("equality queries prune partitions");
+  CHECK_EQUAL(lookup("host == \"evil.com\""), std::vector<uuid>{id2});
+  CHECK_EQUAL(lookup(":string == \"foo.com\""), std::vector<uuid>{id1});
+  MESSAGE("other queries cannot rule out any partition");
+  CHECK_EQUAL(lookup("host != \"evil.com\""), all);
+  CHECK_EQUAL(lookup("host == /evil.*/"), all);
+}
+
+TEST(meta index with arithmetic synopses) {
+  MESSAGE("generate slice data and add it to the meta index");
+  meta_index meta_idx;
+  auto layout = record_type{{"port", count_type{}}}.name("test");
+  auto builder = factory<table_slice_builder>::make(
+    defaults::import::table_slice_type, layout);
+  CHECK(builder->add(make_data_view(count{80})));
+  CHECK(builder->add(make_data_view(count{80})));
+  auto slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id1 = uuid::random();
+  meta_idx.add(id1, slice);
+  CHECK(builder->add(make_data_view(count{80})));
+  CHECK(builder->add(make_data_view(count{443})));
+  slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id2 = uuid::random();
+  meta_idx.add(id2, slice);
+  CHECK(builder->add(make_data_view(count{80})));
+  CHECK(builder->add(make_data_view(caf::none)));
+  slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id3 = uuid::random();
+  meta_idx.add(id3, slice);
+  auto lookup = [&](std::string_view expr) {
+    auto result = meta_idx.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto sorted = [](std::vector<uuid> xs) {
+    std::sort(xs.begin(), xs.end());
+    return xs;
+  };
+  auto all = sorted({id1, id2, id3});
+  MESSAGE("range queries");
+  CHECK_EQUAL(lookup("port > 80"), std::vector<uuid>{id2});
+  CHECK_EQUAL(lookup("port < 80"), std::vector<uuid>{});
+  CHECK_EQUAL(lookup("port <= 80"), all);
+  CHECK_EQUAL(lookup("port in [22, 443]"), std::vector<uuid>{id2});
+  MESSAGE("negations");
+  auto differ = sorted({id2, id3});
+  CHECK_EQUAL(lookup("port != 80"), differ);
+  CHECK_EQUAL(lookup("! (port == 80)"), differ);
+  CHECK_EQUAL(lookup("! (port > 80)"), all);
+  CHECK_EQUAL(lookup("port !in [80]"), differ);
+}
+
+TEST(meta index with set synopses) {
+  MESSAGE("build shrinked partition synopses as active partitions do");
+  meta_index meta_idx;
+  caf::settings opts;
+  put(opts, "max-partition-size", 1024);
+  put(opts, "buffer-strings", true);
+  auto layout = record_type{{"proto", string_type{}}}.name("test");
+  auto builder = factory<table_slice_builder>::make(
+    defaults::import::table_slice_type, layout);
+  auto make_synopsis = [&](std::vector<data> xs) {
+    partition_synopsis ps;
+    for (auto& x : xs)
+      CHECK(builder->add(make_view(x)));
+    ps.add(builder->finish(), opts);
+    ps.shrink();
+    return ps;
+  };
+  auto id1 = uuid::random();
+  meta_idx.merge(id1, make_synopsis({"tcp"s, "tcp"s}));
+  auto id2 = uuid::random();
+  meta_idx.merge(id2, make_synopsis({"tcp"s, "udp"s}));
+  auto lookup = [&](std::string_view expr) {
+    auto result = meta_idx.lookup(unbox(to<expression>(expr)));
+    std::sort(result.begin(), result.end());
+    return result;
+  };
+  auto sorted = [](std::vector<uuid> xs) {
+    std::sort(xs.begin(), xs.end());
+    return xs;
+  };
+  auto all = sorted({id1, id2});
+  MESSAGE("exact sets prune negated predicates");
+  CHECK_EQUAL(lookup("proto == \"tcp\""), all);
+  CHECK_EQUAL(lookup("proto != \"tcp\""), std::vector<uuid>{id2});
+  CHECK_EQUAL(lookup("! (proto == \"tcp\")"), std::vector<uuid>{id2});
+  CHECK_EQUAL(lookup("proto !in [\"tcp\", \"udp\"]"), std::vector<uuid>{});
+  CHECK_EQUAL(lookup("proto == \"icmp\""), std::vector<uuid>{});
+  MESSAGE("nil values match negated predicates");
+  auto id3 = uuid::random();
+  meta_idx.merge(id3, make_synopsis({"tcp"s, caf::none}));
+  auto id4 = uuid::random();
+  meta_idx.merge(id4, make_synopsis({caf::none, caf::none}));
+  CHECK_EQUAL(lookup("proto == \"tcp\""), sorted({id1, id2, id3}));
+  CHECK_EQUAL(lookup("proto != \"tcp\""), sorted({id2, id3, id4}));
+  CHECK_EQUAL(lookup("! (proto == \"tcp\")"), sorted({id2, id3, id4}));
+  CHECK_EQUAL(lookup("proto !in [\"tcp\", \"udp\"]"), sorted({id3, id4}));
+}
+
+TEST(meta index with pending partitions) {
+  MESSAGE("add one partition with synopses and one without");
+  meta_index meta_idx;
+  auto layout = record_type{{"x", bool_type{}}}.name("test");
+  auto builder = factory<table_slice_builder>::make(
+    defaults::import::table_slice_type, layout);
+  CHECK(builder->add(make_data_view(true)));
+  auto slice = builder->finish();
+  REQUIRE(slice.encoding() != table_slice::encoding::none);
+  auto id1 = uuid::random();
+  meta_idx.add(id1, slice);
+  auto id2 = uuid::random();
+  meta_idx.add_pending(id2, "test");
+  auto lookup = [&](std::string_view expr) {
+    return meta_idx.lookup(unbox(to<expression>(expr)));
+  };
+  auto all = std::vector<uuid>{id1, id2};
+  std::sort(all.begin(), all.end());
+  MESSAGE("pending partitions are candidates unless their layout mismatches");
+  CHECK_EQUAL(lookup("x == T"), all);
+  CHECK_EQUAL(lookup("x == F"), std::vector<uuid>{id2});
+  CHECK_EQUAL(lookup("#type == \"test\""), all);
+  CHECK_EQUAL(lookup("#type == \"foo\""), std::vector<uuid>{});
+  MESSAGE("pending partitions of unknown layout are always candidates");
+  auto id3 = uuid::random();
+  meta_idx.add_pending(id3, {});
+  CHECK_EQUAL(lookup("#type == \"foo\""), std::vector<uuid>{id3});
+  meta_idx.erase(id3);
+  MESSAGE("replacing the synopses of a pending partition");
+  auto ps = std::make_unique<partition_synopsis>();
+  CHECK(builder->add(make_data_view(true)));
+  ps->add(builder->finish(), caf::settings{});
+  meta_idx.replace(id2, std::move(ps));
+  CHECK_EQUAL(lookup("x == T"), all);
+  CHECK_EQUAL(lookup("x == F"), std::vector<uuid>{});
+}
+
 TEST(option setting and retrieval) {
   meta_index meta_idx;
   auto& opts = meta_idx.factory_options();
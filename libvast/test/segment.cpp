@@ -18,6 +18,7 @@
 #include "vast/test/fixtures/events.hpp"
 #include "vast/test/test.hpp"
 
+#include "vast/bitmap_algorithms.hpp"
 #include "vast/detail/deserialize.hpp"
 #include "vast/detail/serialize.hpp"
 #include "vast/ids.hpp"
@@ -44,6 +45,29 @@ TEST(construction and querying) {
   CHECK_EQUAL(slices[1], zeek_conn_log[2]);
 }
 
+TEST(lookup decompresses only selected slices) {
+  segment_builder builder{1024};
+  size_t uncompressed_size = 0;
+  for (auto& slice : zeek_conn_log) {
+    uncompressed_size += as_bytes(slice).size();
+    if (auto err = builder.add(slice))
+      FAIL(err);
+  }
+  CHECK_EQUAL(builder.table_slice_bytes(), uncompressed_size);
+  auto x = builder.finish();
+  CHECK_EQUAL(x.num_events(), rank(x.ids()));
+  MESSAGE("lookup a single slice");
+  auto slices = unbox(x.lookup(make_ids({{8, 16}})));
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_EQUAL(slices[0], zeek_conn_log[1]);
+  CHECK_EQUAL(slices[0].offset(), zeek_conn_log[1].offset());
+  MESSAGE("lookup all slices");
+  slices = unbox(x.lookup(x.ids()));
+  REQUIRE_EQUAL(slices.size(), zeek_conn_log.size());
+  for (size_t i = 0; i < slices.size(); ++i)
+    CHECK_EQUAL(slices[i], zeek_conn_log[i]);
+}
+
 TEST(serialization) {
   segment_builder builder{1024};
   auto slice = zeek_conn_log[0];
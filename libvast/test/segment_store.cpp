@@ -24,6 +24,8 @@
 #include "vast/detail/narrow.hpp"
 #include "vast/directory.hpp"
 #include "vast/ids.hpp"
+#include "vast/io/read.hpp"
+#include "vast/io/save.hpp"
 #include "vast/si_literals.hpp"
 #include "vast/table_slice.hpp"
 
@@ -34,7 +36,7 @@ namespace {
 
 struct fixture : fixtures::deterministic_actor_system_and_events {
   fixture() {
-    store = segment_store::make(directory / "segments", 512_KiB, 2);
+    store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
     if (store == nullptr)
       FAIL("segment_store::make failed to allocate a segment store");
     segment_path = store->segment_path();
@@ -189,6 +191,17 @@ TEST(sessionized extraction on filled segment store) {
   CHECK_EQUAL(slices[1].offset(), 16u);
 }
 
+TEST(sessionized extraction on persisted segments) {
+  for (auto& slice : zeek_conn_log)
+    put_cold({slice});
+  CHECK_EQUAL(segment_files().size(), zeek_conn_log.size());
+  auto session = store->extract(everything);
+  std::vector<table_slice> slices;
+  for (auto x = session->next(); x.engaged(); x = session->next())
+    slices.emplace_back(unbox(x));
+  CHECK(deep_compare(zeek_conn_log, slices));
+}
+
 TEST(erase on empty segment store) {
   erase(make_ids({0, 6, 19, 21}));
   auto slices = get(everything);
@@ -292,4 +305,183 @@ TEST(erase slice part from persisted segment) {
   CHECK_SLICE(slices[3], 2, 0);
 }
 
+TEST(erase with tombstones survives a restart) {
+  put_cold(zeek_conn_log);
+  auto files = segment_files();
+  REQUIRE_EQUAL(files.size(), 1u);
+  erase(make_ids({{10, 14}}));
+  // Erasing a minority of the events only marks them as erased.
+  REQUIRE_EQUAL(segment_files().size(), 1u);
+  CHECK_EQUAL(segment_files().front(), files.front());
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 4u);
+  CHECK_SLICE(slices[0], 0, 0);
+  CHECK_SLICE(slices[1], 1, 0, 2);
+  CHECK_SLICE(slices[2], 1, 6, 2);
+  CHECK_SLICE(slices[3], 2, 0);
+}
+
+TEST(erase rewrites mostly dead segments) {
+  put_cold(zeek_conn_log);
+  auto files = segment_files();
+  REQUIRE_EQUAL(files.size(), 1u);
+  erase(make_ids({{8, 16}}));
+  REQUIRE_EQUAL(segment_files().size(), 1u);
+  CHECK_EQUAL(segment_files().front(), files.front());
+  erase(make_ids({{0, 8}}));
+  // The erasure only schedules the rewrite, which runs separately.
+  REQUIRE_EQUAL(segment_files().size(), 1u);
+  CHECK_EQUAL(segment_files().front(), files.front());
+  auto rewrites = store->take_rewrites();
+  REQUIRE_EQUAL(rewrites.size(), 1u);
+  auto result = unbox(segment_store::rewrite(rewrites[0],
+                                             store->rewrite_path()));
+  if (auto err = store->finish_rewrite(rewrites[0].id(),
+                                       rewrites[0].tombstones(), result))
+    FAIL("failed to finish rewrite: " << err);
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_SLICE(slices[0], 2, 0);
+  store = nullptr;
+  REQUIRE_EQUAL(segment_files().size(), 1u);
+  CHECK_NOT_EQUAL(segment_files().front(), files.front());
+}
+
+TEST(erase during rewrite survives the swap) {
+  put_cold(zeek_conn_log);
+  erase(make_ids({{0, 16}}));
+  auto rewrites = store->take_rewrites();
+  REQUIRE_EQUAL(rewrites.size(), 1u);
+  auto result = unbox(segment_store::rewrite(rewrites[0],
+                                             store->rewrite_path()));
+  // Erase more events after the rewrite took its snapshot.
+  erase(make_ids({{16, 20}}));
+  CHECK(store->take_rewrites().empty());
+  if (auto err = store->finish_rewrite(rewrites[0].id(),
+                                       rewrites[0].tombstones(), result))
+    FAIL("failed to finish rewrite: " << err);
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_SLICE(slices[0], 2, 4);
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_SLICE(slices[0], 2, 4);
+}
+
+TEST(erase during extraction with read-ahead) {
+  // A cache that fits a single segment makes the extraction use prefetched
+  // copies of the remaining candidates.
+  store = segment_store::make(directory / "segments", 512_KiB, 1);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  for (auto& slice : zeek_conn_log)
+    put_cold({slice});
+  auto session = store->extract(everything);
+  std::vector<table_slice> slices;
+  slices.emplace_back(unbox(session->next()));
+  MESSAGE("drop the second segment and erase from the third one");
+  erase(make_ids({{8, 18}}));
+  for (auto x = session->next(); x.engaged(); x = session->next())
+    slices.emplace_back(unbox(x));
+  REQUIRE_EQUAL(slices.size(), 2u);
+  CHECK_SLICE(slices[0], 0, 0);
+  CHECK_SLICE(slices[1], 2, 2);
+}
+
+TEST(restart from segment catalog) {
+  put_cold(zeek_conn_log);
+  auto catalog = store->catalog_path();
+  REQUIRE(exists(catalog));
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  CHECK_EQUAL(get(everything).size(), 3u);
+}
+
+TEST(restart from segment catalog journal) {
+  for (auto& slice : zeek_conn_log)
+    put_cold({slice});
+  // Flushing a segment only appends to the journal.
+  REQUIRE(exists(store->catalog_journal_path()));
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  CHECK(!exists(store->catalog_journal_path()));
+  CHECK_EQUAL(get(everything).size(), 3u);
+}
+
+TEST(restart without segment catalog) {
+  put_cold(zeek_conn_log);
+  auto catalog = store->catalog_path();
+  store = nullptr;
+  REQUIRE(rm(catalog));
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  CHECK(exists(catalog));
+  CHECK_EQUAL(get(everything).size(), 3u);
+}
+
+TEST(restart with outdated segment catalog) {
+  put_cold(zeek_conn_log);
+  auto catalog = store->catalog_path();
+  auto outdated = unbox(io::read(catalog));
+  erase(make_ids({{0, 16}}));
+  store = nullptr;
+  if (auto err = io::save(catalog, as_bytes(outdated)))
+    FAIL("failed to restore the outdated catalog: " << err);
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_SLICE(slices[0], 2, 0);
+}
+
+TEST(compaction merges small segments) {
+  for (auto& slice : zeek_conn_log)
+    put_cold({slice});
+  REQUIRE_EQUAL(segment_files().size(), 3u);
+  CHECK_EQUAL(unbox(store->compact(0)), 0u);
+  CHECK_EQUAL(segment_files().size(), 3u);
+  CHECK_GREATER(unbox(store->compact(1_MiB)), 0u);
+  CHECK_EQUAL(segment_files().size(), 1u);
+  CHECK(!exists(store->compaction_path()));
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 3u);
+  CHECK_SLICE(slices[0], 0, 0);
+  CHECK_SLICE(slices[1], 1, 0);
+  CHECK_SLICE(slices[2], 2, 0);
+  store = segment_store::make(directory / "segments", 512_KiB, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  CHECK_EQUAL(get(everything).size(), 3u);
+}
+
+TEST(compaction skips full segments) {
+  // Every slice fills a segment on its own, but the compressed segment files
+  // are considerably smaller than the maximum segment size.
+  auto max_segment_size = std::numeric_limits<size_t>::max();
+  for (auto& slice : zeek_conn_log)
+    max_segment_size = std::min(max_segment_size, as_bytes(slice).size());
+  store = segment_store::make(directory / "segments", max_segment_size, 1_MiB);
+  REQUIRE_NOT_EQUAL(store, nullptr);
+  put(zeek_conn_log);
+  REQUIRE_EQUAL(segment_files().size(), 3u);
+  CHECK_EQUAL(unbox(store->compact(1_MiB)), 0u);
+  CHECK_EQUAL(segment_files().size(), 3u);
+}
+
+TEST(compaction drops erased events) {
+  for (auto& slice : zeek_conn_log)
+    put_cold({slice});
+  erase(make_ids({{10, 14}}));
+  CHECK_GREATER(unbox(store->compact(1_MiB)), 0u);
+  CHECK_EQUAL(segment_files().size(), 1u);
+  auto slices = get(everything);
+  REQUIRE_EQUAL(slices.size(), 4u);
+  CHECK_SLICE(slices[0], 0, 0);
+  CHECK_SLICE(slices[1], 1, 0, 2);
+  CHECK_SLICE(slices[2], 1, 6, 2);
+  CHECK_SLICE(slices[3], 2, 0);
+}
+
 FIXTURE_SCOPE_END()
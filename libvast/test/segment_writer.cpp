@@ -0,0 +1,103 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE segment_writer
+
+#include "vast/segment_writer.hpp"
+
+#include "vast/test/fixtures/events.hpp"
+#include "vast/test/fixtures/filesystem.hpp"
+#include "vast/test/test.hpp"
+
+#include "vast/concept/printable/to_string.hpp"
+#include "vast/concept/printable/vast/uuid.hpp"
+#include "vast/directory.hpp"
+#include "vast/ids.hpp"
+#include "vast/segment.hpp"
+#include "vast/table_slice.hpp"
+
+using namespace vast;
+
+namespace {
+
+struct fixture : fixtures::events, fixtures::filesystem {
+  fixture() : writer{directory / "active"} {
+    // nop
+  }
+
+  /// @returns the number of files in *dir*.
+  size_t num_files(const path& dir) {
+    auto result = size_t{0};
+    for (auto file : vast::directory{dir})
+      if (file.is_regular_file())
+        ++result;
+    return result;
+  }
+
+  segment_writer writer;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(segment_writer_tests, fixture)
+
+TEST(lookup before and after finish) {
+  size_t uncompressed_size = 0;
+  for (auto& slice : zeek_conn_log) {
+    uncompressed_size += as_bytes(slice).size();
+    if (auto err = writer.add(slice))
+      FAIL(err);
+  }
+  CHECK_EQUAL(writer.table_slice_bytes(), uncompressed_size);
+  CHECK_EQUAL(writer.num_events(), rank(writer.ids()));
+  CHECK_EQUAL(num_files(directory / "active"), 1u);
+  MESSAGE("lookup IDs in the segment under construction");
+  auto slices = unbox(writer.lookup(make_ids({0, 6, 19, 21})));
+  REQUIRE_EQUAL(slices.size(), 2u); // [0,8), [16,24)
+  CHECK_EQUAL(slices[0], zeek_conn_log[0]);
+  CHECK_EQUAL(slices[1], zeek_conn_log[2]);
+  MESSAGE("finish the segment");
+  auto id = writer.id();
+  auto ids = writer.ids();
+  auto filename = directory / "segments" / to_string(id);
+  auto x = unbox(writer.finish(filename));
+  CHECK_EQUAL(num_files(directory / "active"), 0u);
+  CHECK(exists(filename));
+  CHECK_NOT_EQUAL(writer.id(), id);
+  CHECK_EQUAL(writer.num_events(), 0u);
+  CHECK_EQUAL(x.id(), id);
+  CHECK_EQUAL(x.ids(), ids);
+  CHECK_EQUAL(x.num_slices(), zeek_conn_log.size());
+  MESSAGE("lookup IDs in the finished segment");
+  slices = unbox(x.lookup(make_ids({{8, 16}})));
+  REQUIRE_EQUAL(slices.size(), 1u);
+  CHECK_EQUAL(slices[0], zeek_conn_log[1]);
+  CHECK_EQUAL(slices[0].offset(), zeek_conn_log[1].offset());
+  MESSAGE("load the finished segment from disk");
+  auto y = unbox(segment::make(chunk::mmap(filename)));
+  slices = unbox(y.lookup(y.ids()));
+  REQUIRE_EQUAL(slices.size(), zeek_conn_log.size());
+  for (size_t i = 0; i < slices.size(); ++i)
+    CHECK_EQUAL(slices[i], zeek_conn_log[i]);
+}
+
+TEST(reset removes the unfinished segment) {
+  REQUIRE(!writer.add(zeek_conn_log[0]));
+  CHECK_EQUAL(num_files(directory / "active"), 1u);
+  writer.reset();
+  CHECK_EQUAL(num_files(directory / "active"), 0u);
+  CHECK_EQUAL(writer.num_events(), 0u);
+  CHECK_EQUAL(rank(writer.ids()), 0u);
+}
+
+FIXTURE_SCOPE_END()
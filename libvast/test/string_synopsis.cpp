@@ -0,0 +1,138 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#define SUITE string_synopsis
+
+#include "vast/string_synopsis.hpp"
+
+#include "vast/test/fixtures/actor_system.hpp"
+#include "vast/test/synopsis.hpp"
+#include "vast/test/test.hpp"
+
+#include "vast/concept/hashable/hash_append.hpp"
+#include "vast/concept/hashable/xxhash.hpp"
+#include "vast/defaults.hpp"
+#include "vast/si_literals.hpp"
+#include "vast/synopsis.hpp"
+#include "vast/synopsis_factory.hpp"
+#include "vast/type.hpp"
+
+using namespace std::string_literals;
+using namespace vast;
+using namespace vast::test;
+using namespace vast::si_literals;
+
+TEST(failed construction) {
+  // If there's no type attribute with Bloom filter parameters present,
+  // construction fails.
+  auto x = make_string_synopsis<xxhash64>(string_type{}, caf::settings{});
+  CHECK_EQUAL(x, nullptr);
+}
+
+namespace {
+
+struct fixture : fixtures::deterministic_actor_system {
+  fixture() {
+    factory<synopsis>::add(string_type{}, make_string_synopsis<xxhash64>);
+  }
+  caf::settings opts;
+};
+
+} // namespace
+
+FIXTURE_SCOPE(string_synopsis_tests, fixture)
+
+TEST(construction via custom factory) {
+  using namespace vast::test::nft;
+  auto t = string_type{}.attributes({{"synopsis", "bloomfilter(1000,0.1)"}});
+  auto x = factory<synopsis>::make(t, opts);
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(make_data_view("foo"));
+  auto verify = verifier{x.get()};
+  verify(make_data_view("foo"), {N, N, N, N, N, N, T, N, N, N, N, N});
+  MESSAGE("patterns cannot be answered by the Bloom filter");
+  auto pat = pattern{"f.*"};
+  verify(make_data_view(pat), {N, N, N, N, N, N, N, N, N, N, N, N});
+  MESSAGE("lists of strings");
+  auto xs = list{"bar"s, "foo"s};
+  CHECK_EQUAL(x->lookup(in, make_data_view(xs)), T);
+}
+
+TEST(serialization with custom attribute type) {
+  auto t = string_type{}.attributes({{"synopsis", "bloomfilter(1000,0.1)"}});
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(t, opts));
+}
+
+TEST(construction based on partition size) {
+  opts["max-partition-size"] = 1_Mi;
+  auto ptr = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  CHECK_ROUNDTRIP_DEREF(std::move(ptr));
+}
+
+TEST(updated params after shrinking) {
+  // Without room for an exact set, shrinking produces a Bloom filter.
+  bloom_filter_parameters xs;
+  xs.p = defaults::system::string_synopsis_fprate;
+  auto ptr = make_buffered_string_synopsis<xxhash64>(string_type{}, xs, 0);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  for (auto str : {"foo", "bar", "baz", "qux", "quux"})
+    ptr->add(make_data_view(str));
+  // Duplicates do not contribute to the size of the Bloom filter.
+  ptr->add(make_data_view("foo"));
+  auto shrinked = ptr->shrink();
+  REQUIRE_NOT_EQUAL(shrinked, nullptr);
+  auto type = shrinked->type();
+  auto params = unbox(parse_parameters(type));
+  // The size will be rounded up to the next power of two.
+  CHECK_EQUAL(*params.n, 8u);
+  CHECK_LESS(shrinked->size_bytes(), 1_Ki);
+  auto recovered = roundtrip(std::move(shrinked));
+  REQUIRE(recovered);
+  auto r1 = unbox(recovered->lookup(equal, make_data_view("foo")));
+  auto r2 = unbox(recovered->lookup(equal, make_data_view("evil.com")));
+  CHECK(r1);
+  CHECK(!r2);
+}
+
+TEST(exact set after shrinking) {
+  using namespace vast::test::nft;
+  opts["buffer-strings"] = true;
+  opts["max-partition-size"] = 1_Mi;
+  auto ptr = factory<synopsis>::make(string_type{}, opts);
+  REQUIRE_NOT_EQUAL(ptr, nullptr);
+  ptr->add(make_data_view("tcp"));
+  ptr->add(make_data_view("udp"));
+  ptr->add(make_data_view("tcp"));
+  auto shrinked = ptr->shrink();
+  REQUIRE_NOT_EQUAL(shrinked, nullptr);
+  CHECK(has_set_attribute(shrinked->type()));
+  auto recovered = roundtrip(std::move(shrinked));
+  REQUIRE(recovered);
+  auto verify = verifier{recovered.get()};
+  verify(make_data_view("tcp"), {N, N, N, N, N, N, T, T, N, N, N, N});
+  verify(make_data_view("icmp"), {N, N, N, N, N, N, F, T, N, N, N, N});
+  MESSAGE("lists of strings");
+  auto xs = list{"tcp"s, "udp"s};
+  CHECK_EQUAL(recovered->lookup(in, make_data_view(xs)), T);
+  CHECK_EQUAL(recovered->lookup(not_in, make_data_view(xs)), F);
+  auto ys = list{"icmp"s, "tcp"s};
+  CHECK_EQUAL(recovered->lookup(in, make_data_view(ys)), T);
+  CHECK_EQUAL(recovered->lookup(not_in, make_data_view(ys)), T);
+  MESSAGE("a single value rules out inequality");
+  auto single = set_synopsis<std::string>{string_type{}, {"tcp"}};
+  CHECK_EQUAL(single.lookup(not_equal, make_data_view("tcp")), F);
+  CHECK_EQUAL(single.lookup(not_equal, make_data_view("udp")), T);
+}
+
+FIXTURE_SCOPE_END()
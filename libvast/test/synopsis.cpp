@@ -22,7 +22,11 @@
 #include <caf/binary_deserializer.hpp>
 #include <caf/binary_serializer.hpp>
 
+#include <flatbuffers/flatbuffers.h>
+
+#include "vast/arithmetic_synopsis.hpp"
 #include "vast/bool_synopsis.hpp"
+#include "vast/qualified_record_field.hpp"
 #include "vast/synopsis_factory.hpp"
 #include "vast/time_synopsis.hpp"
 
@@ -50,24 +54,24 @@ TEST(min-max synopsis) {
   verify(zero, {N, N, N, N, N, N, F, T, F, F, T, T});
   MESSAGE("[4,7] op 4");
   time four = epoch + 4s;
-  verify(four, {N, N, N, N, N, N, T, F, F, T, T, T});
+  verify(four, {N, N, N, N, N, N, T, T, F, T, T, T});
   MESSAGE("[4,7] op 6");
   time six = epoch + 6s;
-  verify(six, {N, N, N, N, N, N, T, F, T, T, T, T});
+  verify(six, {N, N, N, N, N, N, T, T, T, T, T, T});
   MESSAGE("[4,7] op 7");
   time seven = epoch + 7s;
-  verify(seven, {N, N, N, N, N, N, T, F, T, T, F, T});
+  verify(seven, {N, N, N, N, N, N, T, T, T, T, F, T});
   MESSAGE("[4,7] op 9");
   time nine = epoch + 9s;
   verify(nine, {N, N, N, N, N, N, F, T, T, T, F, F});
   MESSAGE("[4,7] op [0, 4]");
   auto zero_four = data{list{zero, four}};
   auto zero_four_view = make_view(zero_four);
-  verify(zero_four_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(zero_four_view, {N, N, T, T, N, N, N, N, N, N, N, N});
   MESSAGE("[4,7] op [7, 9]");
   auto seven_nine = data{list{seven, nine}};
   auto seven_nine_view = make_view(seven_nine);
-  verify(seven_nine_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(seven_nine_view, {N, N, T, T, N, N, N, N, N, N, N, N});
   MESSAGE("[4,7] op [0, 9]");
   auto zero_nine = data{list{zero, nine}};
   auto zero_nine_view = make_view(zero_nine);
@@ -79,7 +83,62 @@ TEST(min-max synopsis) {
   MESSAGE("[4,7] op [count{5}, 7]");
   auto heterogeneous = data{list{c, seven}};
   auto heterogeneous_view = make_view(heterogeneous);
-  verify(heterogeneous_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+  verify(heterogeneous_view, {N, N, T, T, N, N, N, N, N, N, N, N});
+  MESSAGE("[4,4] op 4");
+  auto y = factory<synopsis>::make(time_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(y, nullptr);
+  y->add(four);
+  verify = verifier{y.get()};
+  verify(four, {N, N, N, N, N, N, T, F, F, T, F, T});
+  MESSAGE("[4,4] op [0, 4]");
+  verify(zero_four_view, {N, N, T, F, N, N, N, N, N, N, N, N});
+}
+
+TEST(arithmetic synopses) {
+  using namespace nft;
+  factory<synopsis>::initialize();
+  MESSAGE("count");
+  auto x = factory<synopsis>::make(count_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(count{80});
+  x->add(count{443});
+  auto verify = verifier{x.get()};
+  verify(count{22}, {N, N, N, N, N, N, F, T, F, F, T, T});
+  verify(count{80}, {N, N, N, N, N, N, T, T, F, T, T, T});
+  verify(count{8080}, {N, N, N, N, N, N, F, T, T, T, F, F});
+  MESSAGE("integer");
+  x = factory<synopsis>::make(integer_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(integer{-3});
+  x->add(integer{3});
+  verify = verifier{x.get()};
+  verify(integer{-4}, {N, N, N, N, N, N, F, T, F, F, T, T});
+  verify(integer{0}, {N, N, N, N, N, N, T, T, T, T, T, T});
+  MESSAGE("real");
+  x = factory<synopsis>::make(real_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(real{0.5});
+  verify = verifier{x.get()};
+  verify(real{0.5}, {N, N, N, N, N, N, T, F, F, T, F, T});
+  verify(real{1.5}, {N, N, N, N, N, N, F, T, T, T, F, F});
+  MESSAGE("duration");
+  x = factory<synopsis>::make(duration_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(duration{10s});
+  x->add(duration{20s});
+  verify = verifier{x.get()};
+  verify(duration{1min}, {N, N, N, N, N, N, F, T, T, T, F, F});
+  MESSAGE("no implicit conversions");
+  verify(count{15}, {N, N, N, N, N, N, N, N, N, N, N, N});
+  MESSAGE("nil values match negated predicates");
+  x = factory<synopsis>::make(count_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(count{80});
+  x->add_nil();
+  verify = verifier{x.get()};
+  verify(count{80}, {N, N, N, N, N, N, T, T, F, T, F, T});
+  auto eighty = data{list{count{80}}};
+  verify(make_view(eighty), {N, N, T, T, N, N, N, N, N, N, N, N});
 }
 
 FIXTURE_SCOPE(synopsis_tests, fixtures::deterministic_actor_system)
@@ -89,6 +148,49 @@ TEST(serialization) {
   CHECK_ROUNDTRIP(synopsis_ptr{});
   CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(bool_type{}, caf::settings{}));
   CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(time_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(factory<synopsis>::make(count_type{}, caf::settings{}));
+  CHECK_ROUNDTRIP_DEREF(
+    factory<synopsis>::make(duration_type{}, caf::settings{}));
+}
+
+TEST(flatbuffer roundtrip) {
+  using namespace nft;
+  factory<synopsis>::initialize();
+  auto roundtrip = [](const synopsis_ptr& x) {
+    auto field = record_field{"x", x->type()};
+    auto fqf = qualified_record_field{"test", field};
+    flatbuffers::FlatBufferBuilder builder;
+    auto offset = unbox(pack(builder, x, fqf));
+    builder.Finish(offset);
+    auto fb
+      = flatbuffers::GetRoot<fbs::synopsis::v0>(builder.GetBufferPointer());
+    synopsis_ptr result;
+    REQUIRE_EQUAL(unpack(*fb, result), caf::none);
+    REQUIRE_NOT_EQUAL(result, nullptr);
+    return result;
+  };
+  MESSAGE("time");
+  auto x = factory<synopsis>::make(time_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  auto four = vast::time{epoch + 4s};
+  x->add(four);
+  auto y = roundtrip(x);
+  CHECK(*y == *x);
+  MESSAGE("restored time synopses assume nil values");
+  auto verify = verifier{y.get()};
+  verify(four, {N, N, N, N, N, N, T, T, F, T, F, T});
+  MESSAGE("bool");
+  x = factory<synopsis>::make(bool_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(x, nullptr);
+  x->add(true);
+  verify = verifier{x.get()};
+  verify(true, {N, N, N, N, N, N, T, F, N, N, N, N});
+  y = roundtrip(x);
+  CHECK(*y == *x);
+  MESSAGE("restored bool synopses assume nil values");
+  verify = verifier{y.get()};
+  verify(true, {N, N, N, N, N, N, T, T, N, N, N, N});
+  verify(false, {N, N, N, N, N, N, F, T, N, N, N, N});
 }
 
 FIXTURE_SCOPE_END()
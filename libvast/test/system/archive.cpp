@@ -15,15 +15,21 @@
 
 #include "vast/concept/printable/stream.hpp"
 #include "vast/detail/spawn_container_source.hpp"
+#include "vast/directory.hpp"
 #include "vast/ids.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/table_slice.hpp"
 
 #define SUITE archive
 #include "vast/test/fixtures/actor_system_and_events.hpp"
 #include "vast/test/test.hpp"
 
+#include <chrono>
+#include <thread>
+
 using namespace caf;
 using namespace vast;
+using namespace vast::binary_byte_literals;
 
 namespace {
 
@@ -31,7 +37,7 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   system::archive_actor a;
 
   fixture() {
-    a = self->spawn(system::archive, directory, 10, 1024 * 1024);
+    a = self->spawn(system::archive, directory, 10_MiB, 1024 * 1024, 2, 2, 0);
     self->send(a, atom::exporter_v, self);
   }
 
@@ -59,6 +65,23 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
   std::vector<table_slice> query(std::initializer_list<id_range> ranges) {
     return query(make_ids(ranges));
   }
+
+  /// @returns the number of regular files in a directory.
+  static size_t num_files(const path& dir) {
+    size_t result = 0;
+    for (auto file : vast::directory{dir})
+      if (file.is_regular_file())
+        ++result;
+    return result;
+  }
+
+  /// Waits until a detached actor of an archive staged a rewritten or merged
+  /// segment in `dir` and terminated after responding.
+  void await_staged(const path& dir, size_t detached) {
+    while (num_files(dir / "rewrites") == 0
+           || sys.detached_actors() > detached)
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
 };
 
 } // namespace
@@ -92,4 +115,90 @@ TEST(archiving and querying) {
   self->send_exit(a, exit_reason::user_shutdown);
 }
 
+TEST(queued queries) {
+  push_to_archive(zeek_conn_log);
+  MESSAGE("send two queries at once");
+  self->send(a, make_ids({{0, 4}}));
+  self->send(a, make_ids({{12, 20}}));
+  run();
+  size_t done = 0;
+  std::vector<table_slice> result;
+  self
+    ->do_receive(
+      [&](vast::atom::done, const caf::error& err) {
+        REQUIRE(!err);
+        ++done;
+      },
+      [&](table_slice slice) { result.push_back(std::move(slice)); })
+    .until([&] { return done == 2; });
+  CHECK_EQUAL(rows(result), 4u + 8u);
+  self->send_exit(a, exit_reason::user_shutdown);
+}
+
+TEST(erasure during extraction) {
+  MESSAGE("spawn an archive that stores every slice in its own segment");
+  auto dir = directory / "erasure";
+  auto b = self->spawn(system::archive, dir, 10_MiB, 1, 2, 0, 0);
+  self->send(b, atom::exporter_v, self);
+  vast::detail::spawn_container_source(sys, zeek_conn_log, b);
+  run();
+  MESSAGE("erase most events of the last segment after starting a session");
+  self->send(b, make_ids({{0, 20}}));
+  expect((ids), from(self).to(b));
+  self->send(b, atom::erase_v, make_ids({{16, 19}}));
+  expect((ids, system::archive_client_actor), from(b).to(b));
+  auto detached = sys.detached_actors();
+  expect((atom::erase, ids), from(self).to(b));
+  await_staged(dir, detached);
+  MESSAGE("the rewrite waits for the session to end");
+  expect((ids, system::archive_client_actor, uint64_t), from(b).to(b));
+  expect((uuid), from(_).to(b));
+  CHECK_EQUAL(num_files(dir / "rewrites"), 1u);
+  run();
+  std::vector<table_slice> result;
+  bool done = false;
+  self
+    ->do_receive(
+      [&](vast::atom::done, const caf::error& err) {
+        REQUIRE(!err);
+        done = true;
+      },
+      [&](vast::atom::done) {
+        // The erasure completed.
+      },
+      [&](table_slice slice) { result.push_back(std::move(slice)); })
+    .until(done);
+  CHECK_EQUAL(rows(result), 20u - 3u);
+  CHECK_EQUAL(num_files(dir / "rewrites"), 0u);
+  self->send_exit(b, exit_reason::user_shutdown);
+}
+
+TEST(background compaction) {
+  auto dir = directory / "compaction";
+  auto spawn_archive = [&] {
+    return self->spawn(system::archive, dir, 10_MiB, 1_MiB, 2, 0, 1_MiB);
+  };
+  MESSAGE("write every slice into its own segment by restarting the archive");
+  for (auto& slice : zeek_conn_log) {
+    auto b = spawn_archive();
+    vast::detail::spawn_container_source(sys, std::vector{slice}, b);
+    run();
+    self->send_exit(b, exit_reason::user_shutdown);
+    run();
+  }
+  REQUIRE_EQUAL(num_files(dir / "segments"), 3u);
+  MESSAGE("merge the segments without blocking the archive");
+  auto b = spawn_archive();
+  run();
+  auto detached = sys.detached_actors();
+  self->send(b, atom::compact_v);
+  run();
+  CHECK_EQUAL(num_files(dir / "segments"), 3u);
+  await_staged(dir, detached);
+  run();
+  CHECK_EQUAL(num_files(dir / "segments"), 1u);
+  CHECK_EQUAL(num_files(dir / "rewrites"), 0u);
+  self->send_exit(b, exit_reason::user_shutdown);
+}
+
 FIXTURE_SCOPE_END()
@@ -27,6 +27,7 @@
 #include "vast/ids.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/index.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/posix_filesystem.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/uuid.hpp"
@@ -37,6 +38,7 @@
 
 using namespace vast;
 using namespace system;
+using namespace vast::binary_byte_literals;
 
 using vast::expression;
 using vast::ids;
@@ -67,10 +69,15 @@ struct fixture : fixtures::deterministic_actor_system_and_events {
     MESSAGE("spawn INDEX ingest 4 slices with 100 rows (= 1 partition) each");
     auto fs = self->spawn(vast::system::posix_filesystem, directory);
     index = self->spawn(system::index, fs, directory / "index",
-                        defaults::import::table_slice_size, 100, 3, 1);
+                        defaults::import::table_slice_size, 1_GiB, 3, 1,
+                        defaults::system::indexing_workers, duration::zero(),
+                        defaults::system::max_active_partitions,
+                        duration::zero(), size_t{0}, 1, false, 1);
     archive = self->spawn(system::archive, directory / "archive",
-                          defaults::system::segments,
-                          defaults::system::max_segment_size);
+                          defaults::system::segment_cache_size * 1_MiB,
+                          defaults::system::max_segment_size,
+                          defaults::system::max_archive_sessions,
+                          defaults::system::segment_read_ahead, 0);
     client = sys.spawn(mock_client);
     // Fill the INDEX with 400 rows from the Zeek conn log.
     detail::spawn_container_source(sys, take(zeek_conn_log_full, 4), index);
@@ -28,6 +28,7 @@
 #include "vast/error.hpp"
 #include "vast/expression.hpp"
 #include "vast/ids.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/index.hpp"
 #include "vast/system/posix_filesystem.hpp"
@@ -35,6 +36,7 @@
 
 using namespace std::literals::chrono_literals;
 using namespace vast;
+using namespace vast::binary_byte_literals;
 
 namespace {
 
@@ -196,8 +198,10 @@ TEST(eraser on actual INDEX with Zeek conn logs) {
   auto slices = take(zeek_conn_log_full, 4);
   MESSAGE("spawn INDEX ingest 4 slices with 100 rows (= 1 partition) each");
   auto fs = self->spawn(vast::system::posix_filesystem, directory);
-  index = self->spawn(system::index, fs, directory / "index", slice_size, 100,
-                      taste_count, 1);
+  index = self->spawn(system::index, fs, directory / "index", slice_size, 1_GiB,
+                      taste_count, 1, defaults::system::indexing_workers,
+                      duration::zero(), defaults::system::max_active_partitions,
+                      duration::zero(), size_t{0}, 1, false, 1);
   detail::spawn_container_source(sys, std::move(slices), index);
   run();
   // Predicate for running all actors *except* aut.
@@ -21,8 +21,10 @@
 
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/expression.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/query_options.hpp"
+#include "vast/si_literals.hpp"
 #include "vast/system/archive.hpp"
 #include "vast/system/filesystem_actor.hpp"
 #include "vast/system/importer.hpp"
@@ -33,6 +35,7 @@
 
 using namespace caf;
 using namespace vast;
+using namespace vast::binary_byte_literals;
 
 using std::string;
 using std::chrono_literals::operator""ms;
@@ -62,11 +65,15 @@ struct fixture : fixture_base {
 
   void spawn_index() {
     auto fs = self->spawn(system::posix_filesystem, directory);
-    index = self->spawn(system::index, fs, directory / "index", 10000, 5, 5, 1);
+    index = self->spawn(system::index, fs, directory / "index", 10000, 1_GiB, 5,
+                        1, 0, vast::duration::zero(),
+                        defaults::system::max_active_partitions,
+                        vast::duration::zero(), size_t{0}, 1, false, 1);
   }
 
   void spawn_archive() {
-    archive = self->spawn(system::archive, directory / "archive", 1, 1024);
+    archive = self->spawn(system::archive, directory / "archive", 1_MiB, 1024,
+                          1, 2, 0);
   }
 
   void spawn_importer() {
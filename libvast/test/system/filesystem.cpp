@@ -57,6 +57,27 @@ TEST(read) {
       [&](const caf::error& err) { FAIL(err); });
 }
 
+TEST(ranged read) {
+  MESSAGE("create file");
+  auto foobar = "foobar"s;
+  auto filename = directory / foobar;
+  auto bytes = span<const char>{foobar.data(), foobar.size()};
+  auto err = io::write(filename, as_bytes(bytes));
+  REQUIRE(err == caf::none);
+  MESSAGE("read file range via actor");
+  self
+    ->request(filesystem, caf::infinite, atom::read_v, path{foobar},
+              uint64_t{3}, uint64_t{3})
+    .receive(
+      [&](const chunk_ptr& chk) {
+        CHECK_EQUAL(as_bytes(chk), as_bytes(bytes.subspan(3, 3)));
+      },
+      [&](const caf::error& err) { FAIL(err); });
+  MESSAGE("read past the end of the file");
+  auto tail = unbox(io::read(filename, 4, 10));
+  CHECK_EQUAL(span<const byte>{tail}, as_bytes(bytes.subspan(4)));
+}
+
 TEST(write) {
   auto foo = "foo"s;
   auto copy = foo;
@@ -75,6 +96,29 @@ TEST(write) {
   CHECK_EQUAL(span<const byte>{bytes}, as_bytes(chk));
 }
 
+TEST(append) {
+  auto foo = "foo"s;
+  auto filename = directory / "append";
+  MESSAGE("append to a new file and an existing file via actor");
+  for (auto i = 0; i < 2; ++i) {
+    auto copy = foo;
+    auto chk = chunk::make(std::move(copy));
+    self
+      ->request(filesystem, caf::infinite, atom::append_v, path{"append"},
+                chk)
+      .receive(
+        [&](atom::ok) {
+          // all good
+        },
+        [&](const caf::error& err) { FAIL(err); });
+  }
+  MESSAGE("verify file contents");
+  auto bytes = unbox(io::read(filename));
+  auto foofoo = foo + foo;
+  CHECK_EQUAL(span<const byte>{bytes},
+              as_bytes(span<const char>{foofoo.data(), foofoo.size()}));
+}
+
 TEST(mmap) {
   MESSAGE("create file");
   auto foo = "foo"s;
@@ -110,4 +154,34 @@ TEST(status) {
       [&](const caf::error& err) { FAIL(err); });
 }
 
+TEST(worker pool) {
+  MESSAGE("read files via actor");
+  for (auto i = 0; i < 10; ++i) {
+    auto foo = "foo" + std::to_string(i);
+    auto bytes = span<const char>{foo.data(), foo.size()};
+    REQUIRE(io::write(directory / foo, as_bytes(bytes)) == caf::none);
+    self->request(filesystem, caf::infinite, atom::read_v, path{foo})
+      .receive(
+        [&](const chunk_ptr& chk) {
+          CHECK_EQUAL(as_bytes(chk), as_bytes(bytes));
+        },
+        [&](const caf::error& err) { FAIL(err); });
+  }
+  MESSAGE("check statistics");
+  self
+    ->request(filesystem, caf::infinite, atom::status_v,
+              status_verbosity::debug)
+    .receive(
+      [&](const caf::dictionary<caf::config_value>& status) {
+        auto workers = caf::get<uint64_t>(status, "filesystem.workers");
+        CHECK_EQUAL(workers, defaults::system::filesystem_workers);
+        auto depth = caf::get<uint64_t>(status, "filesystem.queue-depth");
+        CHECK_EQUAL(depth, 0u);
+        auto successful = caf::get<uint64_t>(
+          status, "filesystem.operations.reads.successful");
+        CHECK_EQUAL(successful, 10u);
+      },
+      [&](const caf::error& err) { FAIL(err); });
+}
+
 FIXTURE_SCOPE_END()
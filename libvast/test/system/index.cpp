@@ -22,33 +22,59 @@
 #include "vast/concept/parseable/vast/expression.hpp"
 #include "vast/concept/printable/std/chrono.hpp"
 #include "vast/concept/printable/to_string.hpp"
+#include "vast/defaults.hpp"
 #include "vast/detail/spawn_container_source.hpp"
 #include "vast/detail/spawn_generator_source.hpp"
+#include "vast/fbs/index.hpp"
+#include "vast/fbs/uuid.hpp"
 #include "vast/fwd.hpp"
 #include "vast/ids.hpp"
+#include "vast/io/write.hpp"
 #include "vast/query_options.hpp"
+#include "vast/si_literals.hpp"
+#include "vast/system/archive_client_actor.hpp"
 #include "vast/system/posix_filesystem.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/table_slice_builder.hpp"
 
+#include <flatbuffers/flatbuffers.h>
+
+#include <limits>
+
 using caf::after;
 using std::chrono_literals::operator""s;
 
 using namespace vast;
 using namespace std::chrono;
+using namespace vast::binary_byte_literals;
 
 namespace {
 
 struct fixture : fixtures::deterministic_actor_system_and_events {
-  static constexpr uint32_t in_mem_partitions = 8;
+  static constexpr size_t partition_cache_size = 1_GiB;
   static constexpr uint32_t taste_count = 4;
   static constexpr size_t num_query_supervisors = 1;
+  static constexpr size_t indexing_workers = 0;
+  static constexpr vast::duration partition_window = vast::duration::zero();
+  static constexpr size_t max_active_partitions
+    = defaults::system::max_active_partitions;
+  static constexpr vast::duration active_partition_timeout
+    = vast::duration::zero();
+  static constexpr size_t compaction_budget
+    = defaults::system::partition_compaction_budget;
+  static constexpr size_t synopsis_loaders = 1;
+  static constexpr bool lazy_synopses = false;
+  static constexpr size_t meta_index_shards = 1;
 
   fixture() {
     directory /= "index";
     auto fs = self->spawn(system::posix_filesystem, directory);
     index = self->spawn(system::index, fs, directory / "index", slice_size,
-                        in_mem_partitions, taste_count, num_query_supervisors);
+                        partition_cache_size, taste_count,
+                        num_query_supervisors, indexing_workers,
+                        partition_window, max_active_partitions,
+                        active_partition_timeout, compaction_budget,
+                        synopsis_loaders, lazy_synopses, meta_index_shards);
   }
 
   ~fixture() {
@@ -213,4 +239,270 @@ TEST(iterable zeek conn log query result) {
   }
 }
 
+TEST(active partitions by layout) {
+  MESSAGE("ingest slices of two layouts");
+  auto slices = first_n(alternating_integers, 1);
+  slices.insert(slices.end(), zeek_conn_log.begin(), zeek_conn_log.end());
+  detail::spawn_container_source(sys, slices, index);
+  run();
+  REQUIRE_EQUAL(state().active_partitions.size(), 2u);
+  auto& conn = state().active_partitions["zeek.conn"];
+  auto& ints = state().active_partitions[slices[0].layout().name()];
+  CHECK_NOT_EQUAL(conn.id, ints.id);
+  MESSAGE("query the partition of a single layout");
+  auto [query_id, hits, scheduled] = query("#type == \"zeek.conn\"");
+  CHECK_EQUAL(hits, 1u);
+  auto result = receive_result(query_id, hits, scheduled);
+  CHECK_EQUAL(rank(result), rows(zeek_conn_log));
+}
+
+TEST(partition windows) {
+  MESSAGE("spawn an index whose partitions fit all slices");
+  auto dir = directory / "windows";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto window = vast::duration{std::chrono::nanoseconds{1}};
+  auto idx = self->spawn(system::index, fs, dir, 10 * slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers, window,
+                         max_active_partitions, active_partition_timeout,
+                         compaction_budget, synopsis_loaders, lazy_synopses,
+                         meta_index_shards);
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  MESSAGE("roll over when a slice arrives after the end of the time window");
+  auto slices = rebase(first_n(alternating_integers, 2));
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  CHECK_EQUAL(st.active_partitions.size(), 1u);
+  CHECK_EQUAL(st.unpersisted.size() + st.persisted_partitions.size(), 1u);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(idle partitions roll over) {
+  MESSAGE("spawn an index with a long time window");
+  auto dir = directory / "idle";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto window = vast::duration{std::chrono::hours{1}};
+  auto idx = self->spawn(system::index, fs, dir, 10 * slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers, window,
+                         max_active_partitions, active_partition_timeout,
+                         size_t{0}, synopsis_loaders, lazy_synopses,
+                         meta_index_shards);
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  auto slices = rebase(first_n(alternating_integers, 1));
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  auto layout = alternating_integers[0].layout().name();
+  REQUIRE_EQUAL(st.active_partitions.count(layout), 1u);
+  CHECK(st.active_partitions[layout].actor != nullptr);
+  MESSAGE("roll over without further slices at the end of the time window");
+  sched.trigger_timeouts();
+  run();
+  CHECK(st.active_partitions[layout].actor == nullptr);
+  CHECK_EQUAL(st.unpersisted.size() + st.persisted_partitions.size(), 1u);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(idle timeout) {
+  MESSAGE("spawn an index without time windows");
+  auto dir = directory / "timeout";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto timeout = vast::duration{std::chrono::minutes{1}};
+  auto idx = self->spawn(system::index, fs, dir, 10 * slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers,
+                         partition_window, max_active_partitions, timeout,
+                         size_t{0}, synopsis_loaders, lazy_synopses,
+                         meta_index_shards);
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  auto slices = rebase(first_n(alternating_integers, 1));
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  auto layout = slices[0].layout().name();
+  REQUIRE_EQUAL(st.active_partitions.count(layout), 1u);
+  MESSAGE("keep the partition active if it received events since the timer");
+  sched.trigger_timeouts();
+  run();
+  CHECK(st.active_partitions[layout].actor != nullptr);
+  MESSAGE("persist the partition after a timeout without events");
+  sched.trigger_timeouts();
+  run();
+  CHECK(st.active_partitions[layout].actor == nullptr);
+  CHECK_EQUAL(st.unpersisted.size() + st.persisted_partitions.size(), 1u);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(active partition limit) {
+  MESSAGE("spawn an index with a single active partition");
+  auto dir = directory / "limit";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto idx = self->spawn(system::index, fs, dir, 10 * slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers,
+                         partition_window, size_t{1}, active_partition_timeout,
+                         size_t{0}, synopsis_loaders, lazy_synopses,
+                         meta_index_shards);
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  auto slices = first_n(alternating_integers, 1);
+  slices.insert(slices.end(), zeek_conn_log.begin(), zeek_conn_log.end());
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  MESSAGE("a new layout replaces the least recently written partition");
+  auto ints = slices[0].layout().name();
+  CHECK(st.active_partitions[ints].actor == nullptr);
+  CHECK(st.active_partitions["zeek.conn"].actor != nullptr);
+  CHECK_EQUAL(st.unpersisted.size() + st.persisted_partitions.size(), 1u);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(undersized partitions) {
+  MESSAGE("spawn an index that rolls over after every slice");
+  auto dir = directory / "undersized";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto window = vast::duration{std::chrono::nanoseconds{1}};
+  auto idx = self->spawn(system::index, fs, dir, 10 * slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers, window,
+                         max_active_partitions, active_partition_timeout,
+                         size_t{0}, synopsis_loaders, lazy_synopses,
+                         meta_index_shards);
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  auto slices = rebase(first_n(alternating_integers, 3));
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  MESSAGE("persisted partitions with few events are merge candidates");
+  CHECK_EQUAL(st.undersized_partitions.size(), st.persisted_partitions.size());
+  for (auto& [id, info] : st.undersized_partitions) {
+    CHECK_EQUAL(info.layout, slices[0].layout().name());
+    CHECK_EQUAL(rank(info.ids), slice_size);
+  }
+  MESSAGE("the index cannot merge partitions without an archive");
+  self->send(idx, atom::compact_v);
+  run();
+  CHECK(!st.compaction);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(compaction) {
+  MESSAGE("spawn an index that rolls over after every slice");
+  auto dir = directory / "compaction";
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto window = vast::duration{std::chrono::nanoseconds{1}};
+  auto spawn_index = [&] {
+    return self->spawn(system::index, fs, dir, 10 * slice_size,
+                       partition_cache_size, taste_count,
+                       num_query_supervisors, indexing_workers, window,
+                       max_active_partitions, active_partition_timeout,
+                       size_t{0}, synopsis_loaders, lazy_synopses,
+                       meta_index_shards);
+  };
+  auto idx = spawn_index();
+  auto slices = rebase(first_n(alternating_integers, 3));
+  detail::spawn_container_source(sys, slices, idx);
+  run();
+  auto st = &deref<caf::stateful_actor<system::index_state>>(idx).state;
+  auto sources = std::vector<uuid>{st->persisted_partitions.begin(),
+                                   st->persisted_partitions.end()};
+  REQUIRE_EQUAL(sources.size(), 2u);
+  MESSAGE("merge the persisted partitions with events from an archive");
+  auto archive = sys.spawn([=](caf::event_based_actor* mock) -> caf::behavior {
+    return {
+      [](atom::exporter, const caf::actor&) {},
+      [=](const ids& xs, system::archive_client_actor client) {
+        for (auto& slice : slices)
+          if (rank(make_ids(slice) & xs) > 0)
+            mock->send(client, slice);
+        mock->send(client, atom::done_v, caf::error{});
+      },
+    };
+  });
+  self->send(idx, caf::actor_cast<system::archive_actor>(archive));
+  self->send(idx, atom::compact_v);
+  run();
+  CHECK(!st->compaction);
+  REQUIRE_EQUAL(st->persisted_partitions.size(), 1u);
+  auto merged = *st->persisted_partitions.begin();
+  MESSAGE("the merged partition replaces its sources");
+  CHECK(exists(dir / to_string(merged)));
+  for (auto& source : sources) {
+    CHECK_NOT_EQUAL(merged, source);
+    CHECK(!exists(dir / to_string(source)));
+  }
+  MESSAGE("the swap replays from the journal after a restart");
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+  run();
+  idx = spawn_index();
+  run();
+  st = &deref<caf::stateful_actor<system::index_state>>(idx).state;
+  CHECK(st->persisted_partitions.count(merged));
+  for (auto& source : sources)
+    CHECK(!st->persisted_partitions.count(source));
+  anon_send_exit(archive, caf::exit_reason::user_shutdown);
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
+TEST(journal replay) {
+  auto dir = directory / "journal";
+  auto a = uuid::random();
+  auto b = uuid::random();
+  auto c = uuid::random();
+  for (auto& id : {a, b, c}) {
+    auto foo = std::string{"foo"};
+    auto bytes = span<const char>{foo.data(), foo.size()};
+    REQUIRE_EQUAL(io::write(dir / to_string(id), as_bytes(bytes)), caf::none);
+  }
+  MESSAGE("write a checkpoint of the first generation");
+  {
+    auto builder = flatbuffers::FlatBufferBuilder{};
+    auto partitions = builder.CreateVector(
+      std::vector<flatbuffers::Offset<fbs::uuid::v0>>{unbox(pack(builder, a))});
+    auto stats = builder.CreateVector(
+      std::vector<flatbuffers::Offset<fbs::layout_statistics::v0>>{});
+    auto index_v0 = fbs::index::Createv0(builder, partitions, stats, 1);
+    fbs::FinishIndexBuffer(
+      builder, fbs::CreateIndex(builder, fbs::index::Index::v0,
+                                index_v0.Union()));
+    auto buffer = span<const uint8_t>{builder.GetBufferPointer(),
+                                      builder.GetSize()};
+    REQUIRE_EQUAL(io::write(dir / "index.bin", as_bytes(buffer)), caf::none);
+  }
+  MESSAGE("append journal entries that end with an incomplete one");
+  auto append = [&](system::index_journal_entry entry, size_t max_size) {
+    auto builder = flatbuffers::FlatBufferBuilder{};
+    builder.FinishSizePrefixed(unbox(pack(builder, entry)));
+    auto size = std::min(size_t{builder.GetSize()}, max_size);
+    auto buffer = span<const uint8_t>{builder.GetBufferPointer(), size};
+    REQUIRE_EQUAL(io::append(dir / "index.journal", as_bytes(buffer)),
+                  caf::none);
+  };
+  auto stats = system::index_statistics{};
+  stats.layouts["foo"].count = 42;
+  auto complete = std::numeric_limits<size_t>::max();
+  append({0, a, true, {}}, complete);
+  append({1, b, false, stats}, complete);
+  append({1, c, false, {}}, 10);
+  MESSAGE("load the index state");
+  auto fs = self->spawn(system::posix_filesystem, dir);
+  auto idx = self->spawn(system::index, fs, dir, slice_size,
+                         partition_cache_size, taste_count,
+                         num_query_supervisors, indexing_workers,
+                         partition_window, max_active_partitions,
+                         active_partition_timeout, compaction_budget,
+                         synopsis_loaders, lazy_synopses, meta_index_shards);
+  run();
+  auto& st = deref<caf::stateful_actor<system::index_state>>(idx).state;
+  MESSAGE("entries of older generations are part of the checkpoint");
+  CHECK(st.persisted_partitions.count(a));
+  MESSAGE("entries of the current generation replay");
+  CHECK(st.persisted_partitions.count(b));
+  CHECK_EQUAL(st.stats.layouts["foo"].count, 42u);
+  MESSAGE("incomplete entries do not replay");
+  CHECK(!st.persisted_partitions.count(c));
+  MESSAGE("the replayed journal is folded into a new checkpoint");
+  CHECK_EQUAL(st.journal_generation, 2u);
+  CHECK(exists(dir / "index.bin"));
+  CHECK(!exists(dir / "index.journal"));
+  anon_send_exit(idx, caf::exit_reason::user_shutdown);
+}
+
 FIXTURE_SCOPE_END()
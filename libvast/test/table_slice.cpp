@@ -18,6 +18,7 @@
 #include "vast/test/fixtures/table_slices.hpp"
 #include "vast/test/test.hpp"
 
+#include "vast/detail/lz4.hpp"
 #include "vast/ids.hpp"
 #include "vast/table_slice_column.hpp"
 #include "vast/table_slice_row.hpp"
@@ -184,4 +185,23 @@ TEST(split) {
   CHECK_EQUAL(split_sut(7), manual_split_sut(7));
 }
 
+TEST(decompress) {
+  auto sut = zeek_conn_log[0];
+  auto bytes = as_bytes(sut);
+  auto buffer = std::vector<byte>(detail::lz4::compress_bound(bytes.size()));
+  auto size = detail::lz4::compress(bytes, as_writeable_bytes(buffer));
+  REQUIRE_NOT_EQUAL(size, 0u);
+  auto compressed = span<const byte>{buffer.data(), size};
+  auto slice = decompress(compressed, bytes.size(), table_slice::verify::yes);
+  REQUIRE_NOT_EQUAL(slice.encoding(), table_slice::encoding::none);
+  CHECK_EQUAL(to_data(slice), to_data(sut));
+  MESSAGE("reject sizes beyond the maximum expansion without allocating");
+  auto corrupt = std::numeric_limits<size_t>::max();
+  slice = decompress(compressed, corrupt, table_slice::verify::yes);
+  CHECK_EQUAL(slice.encoding(), table_slice::encoding::none);
+  slice = decompress(compressed, detail::lz4::decompress_bound(size) + 1,
+                     table_slice::verify::yes);
+  CHECK_EQUAL(slice.encoding(), table_slice::encoding::none);
+}
+
 FIXTURE_SCOPE_END()
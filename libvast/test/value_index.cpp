@@ -18,6 +18,7 @@
 #include "vast/test/fixtures/events.hpp"
 #include "vast/test/test.hpp"
 
+#include "vast/chunk.hpp"
 #include "vast/concept/parseable/to.hpp"
 #include "vast/concept/parseable/vast/address.hpp"
 #include "vast/concept/parseable/vast/data.hpp"
@@ -27,6 +28,8 @@
 #include "vast/concept/printable/vast/bitmap.hpp"
 #include "vast/detail/deserialize.hpp"
 #include "vast/detail/serialize.hpp"
+#include "vast/fbs/utils.hpp"
+#include "vast/fbs/value_index.hpp"
 #include "vast/table_slice.hpp"
 #include "vast/value_index_factory.hpp"
 
@@ -126,4 +129,44 @@ TEST(regression - checking the result single bitmap) {
   CHECK_EQUAL(bm.size(), 6465u);
 }
 
+TEST(flatbuffer roundtrip) {
+  auto idx = factory<value_index>::make(string_type{}, caf::settings{});
+  REQUIRE_NOT_EQUAL(idx, nullptr);
+  REQUIRE(idx->append(make_data_view("foo")));
+  REQUIRE(idx->append(make_data_view("bar")));
+  REQUIRE(idx->append(make_data_view(caf::none)));
+  REQUIRE(idx->append(make_data_view("foobar")));
+  REQUIRE(idx->append(make_data_view("foo")));
+  MESSAGE("pack");
+  flatbuffers::FlatBufferBuilder builder;
+  auto offset = unbox(pack(builder, idx));
+  builder.Finish(offset);
+  auto chk = fbs::release(builder);
+  auto fb = fbs::as_flatbuffer<fbs::value_index::v0>(as_bytes(chk));
+  REQUIRE(fb);
+  REQUIRE(fb->bitmaps());
+  CHECK_GREATER(fb->bitmaps()->size(), 0u);
+  MESSAGE("unpack");
+  value_index_ptr idx2;
+  REQUIRE_EQUAL(unpack(*fb, idx2, chk), caf::none);
+  REQUIRE_NOT_EQUAL(idx2, nullptr);
+  auto foo = unbox(idx2->lookup(equal, make_data_view("foo")));
+  CHECK_EQUAL(to_string(foo), "10001");
+  auto not_foo = unbox(idx2->lookup(not_equal, make_data_view("foo")));
+  CHECK_EQUAL(to_string(not_foo), "01110");
+  auto nil = unbox(idx2->lookup(equal, make_data_view(caf::none)));
+  CHECK_EQUAL(to_string(nil), "00100");
+  MESSAGE("repack");
+  flatbuffers::FlatBufferBuilder builder2;
+  auto offset2 = unbox(pack(builder2, idx2));
+  builder2.Finish(offset2);
+  auto chk2 = fbs::release(builder2);
+  auto fb2 = fbs::as_flatbuffer<fbs::value_index::v0>(as_bytes(chk2));
+  REQUIRE(fb2);
+  value_index_ptr idx3;
+  REQUIRE_EQUAL(unpack(*fb2, idx3, chk2), caf::none);
+  foo = unbox(idx3->lookup(equal, make_data_view("foo")));
+  CHECK_EQUAL(to_string(foo), "10001");
+}
+
 FIXTURE_SCOPE_END()
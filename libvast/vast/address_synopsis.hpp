@@ -15,7 +15,9 @@
 
 #include "vast/bloom_filter_parameters.hpp"
 #include "vast/bloom_filter_synopsis.hpp"
+#include "vast/defaults.hpp"
 #include "vast/fwd.hpp"
+#include "vast/set_synopsis.hpp"
 
 #include <caf/config_value.hpp>
 #include <caf/settings.hpp>
@@ -27,21 +29,6 @@
 
 namespace vast {
 
-namespace detail {
-
-// Because VAST deserializes a synopsis with empty options and
-// construction of an address synopsis fails without any sizing
-// information, we augment the type with the synopsis options.
-inline type annotate_type(type type, const bloom_filter_parameters& params) {
-  using namespace std::string_literals;
-  auto v = "bloomfilter("s + std::to_string(*params.n) + ','
-           + std::to_string(*params.p) + ')';
-  // Replaces any previously existing attributes.
-  return std::move(type).attributes({{"synopsis", std::move(v)}});
-}
-
-} // namespace detail
-
 template <class HashFunction>
 synopsis_ptr
 make_address_synopsis(vast::type type, bloom_filter_parameters params,
@@ -70,86 +57,10 @@ public:
   }
 };
 
-/// A synopsis for IP addresses that stores a full copy of the input in a hash
-/// table to be able to construct a smaller bloom filter synopsis for this data
-/// at a later point in time using the `shrink` function.
+/// A synopsis for IP addresses that buffers the input until it shrinks.
 template <class HashFunction>
-class buffered_address_synopsis : public synopsis {
-public:
-  buffered_address_synopsis(vast::type x, double p)
-    : synopsis{std::move(x)}, p_{p} {
-  }
-
-  synopsis_ptr shrink() const override {
-    size_t next_power_of_two = 1ull;
-    while (ips_.size() > next_power_of_two)
-      next_power_of_two *= 2;
-    bloom_filter_parameters params;
-    params.p = p_;
-    params.n = next_power_of_two;
-    VAST_DEBUG_ANON("shrinked address synopsis to", params.n, "elements");
-    auto type = detail::annotate_type(this->type(), params);
-    auto shrinked_synopsis
-      = make_address_synopsis<xxhash64>(type, std::move(params));
-    if (!shrinked_synopsis)
-      return nullptr;
-    for (auto addr : ips_)
-      shrinked_synopsis->add(addr);
-    return shrinked_synopsis;
-  }
-
-  // Implementation of the remainder of the `synopsis` API.
-  void add(data_view x) override {
-    auto addr_view = caf::get_if<view<address>>(&x);
-    VAST_ASSERT(addr_view);
-    ips_.insert(*addr_view);
-  }
-
-  size_t size_bytes() const override {
-    return sizeof(buffered_address_synopsis)
-      + ips_.size() * sizeof(typename decltype(ips_)::node_type);
-  }
-
-  caf::optional<bool>
-  lookup(relational_operator op, data_view rhs) const override {
-    switch (op) {
-      default:
-        return caf::none;
-      case equal:
-        return ips_.count(caf::get<view<address>>(rhs));
-      case in: {
-        if (auto xs = caf::get_if<view<list>>(&rhs)) {
-          for (auto x : **xs)
-            if (ips_.count(caf::get<view<address>>(x)))
-              return true;
-          return false;
-        }
-        return caf::none;
-      }
-    }
-  }
-
-  caf::error serialize(caf::serializer&) const override {
-    return make_error(ec::logic_error, "attempted to serialize a "
-                                       "buffered_address_synopsis; did you "
-                                       "forget to shrink?");
-  }
-
-  caf::error deserialize(caf::deserializer&) override {
-    return make_error(ec::logic_error, "attempted to deserialize a "
-                                       "buffered_address_synopsis");
-  }
-
-  bool equals(const synopsis& other) const noexcept override {
-    if (auto* p = dynamic_cast<const buffered_address_synopsis*>(&other))
-      return ips_ == p->ips_;
-    return false;
-  }
-
-private:
-  double p_;
-  std::unordered_set<vast::address> ips_;
-};
+using buffered_address_synopsis
+  = buffered_synopsis<address, address_synopsis<HashFunction>>;
 
 /// Factory to construct an IP address synopsis.
 /// @tparam HashFunction The hash function to use for the Bloom filter.
@@ -177,19 +88,22 @@ make_address_synopsis(vast::type type, bloom_filter_parameters params,
 /// @tparam HashFunction The hash function to use for the Bloom filter.
 /// @param type A type instance carrying an `address_type`.
 /// @param params The Bloom filter parameters.
-/// @param seeds The seeds for the Bloom filter hasher.
+/// @param max_set_size The maximum number of distinct addresses for which
+///        shrinking produces an exact set instead of a Bloom filter.
 /// @returns A type-erased pointer to a synopsis.
 /// @pre `caf::holds_alternative<address_type>(type)`.
 /// @relates address_synopsis
 template <class HashFunction>
-synopsis_ptr make_buffered_address_synopsis(vast::type type,
-                                            bloom_filter_parameters params) {
+synopsis_ptr make_buffered_address_synopsis(
+  vast::type type, bloom_filter_parameters params,
+  size_t max_set_size = defaults::system::max_set_synopsis_size) {
   VAST_ASSERT(caf::holds_alternative<address_type>(type));
   if (!params.p) {
     return nullptr;
   }
   using synopsis_type = buffered_address_synopsis<HashFunction>;
-  return std::make_unique<synopsis_type>(std::move(type), *params.p);
+  return std::make_unique<synopsis_type>(std::move(type), *params.p,
+                                         max_set_size);
 }
 
 /// Factory to construct an IP address synopsis. This overload looks for a type
@@ -201,6 +115,8 @@ synopsis_ptr make_buffered_address_synopsis(vast::type type,
 template <class HashFunction>
 synopsis_ptr make_address_synopsis(vast::type type, const caf::settings& opts) {
   VAST_ASSERT(caf::holds_alternative<address_type>(type));
+  if (has_set_attribute(type))
+    return std::make_unique<set_synopsis<address>>(std::move(type));
   if (auto xs = parse_parameters(type))
     return make_address_synopsis<HashFunction>(std::move(type), std::move(*xs));
   // If no explicit Bloom filter parameters were attached to the type, we try
@@ -0,0 +1,80 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/aliases.hpp"
+#include "vast/min_max_synopsis.hpp"
+#include "vast/synopsis.hpp"
+#include "vast/time.hpp"
+
+#include <limits>
+#include <type_traits>
+
+namespace vast {
+
+/// A synopsis for ordered arithmetic types that keeps track of the minimum and
+/// maximum value.
+template <class T>
+class arithmetic_synopsis final : public min_max_synopsis<T> {
+public:
+  using super = min_max_synopsis<T>;
+
+  explicit arithmetic_synopsis(vast::type x)
+    : super{std::move(x), upper_bound(), lower_bound()} {
+    // nop
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(arithmetic_synopsis))
+      return false;
+    auto& dref = static_cast<const arithmetic_synopsis&>(other);
+    return this->type() == dref.type() && this->min() == dref.min()
+           && this->max() == dref.max() && this->has_nil_ == dref.has_nil_;
+  }
+
+  caf::error serialize(caf::serializer& sink) const override {
+    if (auto err = super::serialize(sink))
+      return err;
+    return sink(this->has_nil_);
+  }
+
+  caf::error deserialize(caf::deserializer& source) override {
+    if (auto err = super::deserialize(source))
+      return err;
+    return source(this->has_nil_);
+  }
+
+private:
+  static constexpr T upper_bound() {
+    if constexpr (std::is_same_v<T, duration>)
+      return duration::max();
+    else
+      return std::numeric_limits<T>::max();
+  }
+
+  static constexpr T lower_bound() {
+    if constexpr (std::is_same_v<T, duration>)
+      return duration::min();
+    else
+      return std::numeric_limits<T>::lowest();
+  }
+};
+
+using integer_synopsis = arithmetic_synopsis<integer>;
+using count_synopsis = arithmetic_synopsis<count>;
+using real_synopsis = arithmetic_synopsis<real>;
+using duration_synopsis = arithmetic_synopsis<duration>;
+using enumeration_synopsis = arithmetic_synopsis<enumeration>;
+
+} // namespace vast
@@ -14,16 +14,41 @@
 #pragma once
 
 #include "vast/bloom_filter.hpp"
+#include "vast/bloom_filter_parameters.hpp"
+#include "vast/set_synopsis.hpp"
 
 #include <caf/deserializer.hpp>
 #include <caf/optional.hpp>
 #include <caf/serializer.hpp>
 
+#include <vast/detail/assert.hpp>
+#include <vast/error.hpp>
+#include <vast/logger.hpp>
 #include <vast/synopsis.hpp>
 #include <vast/type.hpp>
+#include <vast/view.hpp>
+
+#include <string>
+#include <type_traits>
+#include <unordered_set>
 
 namespace vast {
 
+namespace detail {
+
+// Because VAST deserializes a synopsis with empty options and
+// construction of a Bloom filter synopsis fails without any sizing
+// information, we augment the type with the synopsis options.
+inline type annotate_type(type type, const bloom_filter_parameters& params) {
+  using namespace std::string_literals;
+  auto v = "bloomfilter("s + std::to_string(*params.n) + ','
+           + std::to_string(*params.p) + ')';
+  // Replaces any previously existing attributes.
+  return std::move(type).attributes({{"synopsis", std::move(v)}});
+}
+
+} // namespace detail
+
 /// A Bloom filter synopsis.
 template <class T, class HashFunction>
 class bloom_filter_synopsis : public synopsis {
@@ -42,16 +67,22 @@ public:
 
   caf::optional<bool>
   lookup(relational_operator op, data_view rhs) const override {
+    // Operands of other types, e.g., patterns for string fields, are beyond
+    // the capabilities of the Bloom filter.
     switch (op) {
       default:
         return caf::none;
       case equal:
-        return bloom_filter_.lookup(caf::get<view<T>>(rhs));
+        if (auto x = caf::get_if<view<T>>(&rhs))
+          return bloom_filter_.lookup(*x);
+        return caf::none;
       case in: {
         if (auto xs = caf::get_if<view<list>>(&rhs)) {
-          for (auto x : **xs)
-            if (bloom_filter_.lookup(caf::get<view<T>>(x)))
+          for (auto x : **xs) {
+            auto y = caf::get_if<view<T>>(&x);
+            if (!y || bloom_filter_.lookup(*y))
               return true;
+          }
           return false;
         }
         return caf::none;
@@ -82,6 +113,117 @@ protected:
   bloom_filter<HashFunction> bloom_filter_;
 };
 
+/// A synopsis that stores a full copy of the input in a hash table to be able
+/// to construct a smaller Bloom filter synopsis for this data at a later point
+/// in time using the `shrink` function. If there are only few distinct values,
+/// shrinking produces an exact set synopsis instead.
+/// @tparam T The type of the buffered values.
+/// @tparam Synopsis The Bloom filter synopsis that shrinking produces.
+template <class T, class Synopsis>
+class buffered_synopsis : public synopsis {
+public:
+  using hash_function = typename Synopsis::bloom_filter_type::hash_function;
+
+  buffered_synopsis(vast::type x, double p, size_t max_set_size)
+    : synopsis{std::move(x)}, p_{p}, max_set_size_{max_set_size} {
+  }
+
+  synopsis_ptr shrink() const override {
+    // Few distinct values fit into an exact set, which also answers negated
+    // predicates.
+    if (values_.size() <= max_set_size_) {
+      VAST_DEBUG_ANON("shrinked synopsis to a set of", values_.size(),
+                      "elements");
+      return make_set_synopsis(this->type(), values_, has_nil_);
+    }
+    size_t next_power_of_two = 1ull;
+    while (values_.size() > next_power_of_two)
+      next_power_of_two *= 2;
+    bloom_filter_parameters params;
+    params.p = p_;
+    params.n = next_power_of_two;
+    VAST_DEBUG_ANON("shrinked synopsis to", params.n, "elements");
+    auto type = detail::annotate_type(this->type(), params);
+    auto bf = make_bloom_filter<hash_function>(std::move(params));
+    if (!bf) {
+      VAST_WARNING_ANON(__func__, "failed to construct Bloom filter");
+      return nullptr;
+    }
+    auto shrinked_synopsis
+      = std::make_unique<Synopsis>(std::move(type), std::move(*bf));
+    for (auto& x : values_)
+      shrinked_synopsis->add(make_view(x));
+    return shrinked_synopsis;
+  }
+
+  // Implementation of the remainder of the `synopsis` API.
+  void add(data_view x) override {
+    auto y = caf::get_if<view<T>>(&x);
+    VAST_ASSERT(y);
+    values_.insert(materialize(*y));
+  }
+
+  void add_nil() override {
+    has_nil_ = true;
+  }
+
+  size_t size_bytes() const override {
+    size_t result = sizeof(buffered_synopsis)
+                    + values_.size()
+                        * sizeof(typename decltype(values_)::node_type);
+    if constexpr (std::is_same_v<T, std::string>)
+      for (auto& x : values_)
+        result += x.capacity();
+    return result;
+  }
+
+  caf::optional<bool>
+  lookup(relational_operator op, data_view rhs) const override {
+    switch (op) {
+      default:
+        return caf::none;
+      case equal:
+        if (auto x = caf::get_if<view<T>>(&rhs))
+          return values_.count(materialize(*x)) > 0;
+        return caf::none;
+      case in: {
+        if (auto xs = caf::get_if<view<list>>(&rhs)) {
+          for (auto x : **xs) {
+            auto y = caf::get_if<view<T>>(&x);
+            if (!y || values_.count(materialize(*y)) > 0)
+              return true;
+          }
+          return false;
+        }
+        return caf::none;
+      }
+    }
+  }
+
+  caf::error serialize(caf::serializer&) const override {
+    return make_error(ec::logic_error, "attempted to serialize a "
+                                       "buffered synopsis; did you "
+                                       "forget to shrink?");
+  }
+
+  caf::error deserialize(caf::deserializer&) override {
+    return make_error(ec::logic_error, "attempted to deserialize a "
+                                       "buffered synopsis");
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (auto* p = dynamic_cast<const buffered_synopsis*>(&other))
+      return values_ == p->values_ && has_nil_ == p->has_nil_;
+    return false;
+  }
+
+private:
+  double p_;
+  size_t max_set_size_;
+  std::unordered_set<T> values_;
+  bool has_nil_ = false;
+};
+
 /// Parses Bloom filter parameters from type attributes of the form
 /// `#synopsis=bloom_filter(n,p)`.
 /// @param x The type whose attributes to parse.
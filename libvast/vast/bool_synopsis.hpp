@@ -22,10 +22,14 @@ class bool_synopsis : public synopsis {
 public:
   explicit bool_synopsis(vast::type x);
 
+  /// Restores a synopsis from its flatbuffer representation, which does not
+  /// record nil values. The synopsis assumes that the column has some.
   bool_synopsis(bool true_, bool false_);
 
   void add(data_view x) override;
 
+  void add_nil() override;
+
   caf::optional<bool> lookup(relational_operator op,
                              data_view rhs) const override;
 
@@ -44,6 +48,7 @@ public:
 private:
   bool true_ = false;
   bool false_ = false;
+  bool nil_ = false;
 };
 
 } // namespace vast
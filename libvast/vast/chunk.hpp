@@ -143,6 +143,16 @@ public:
   slice(size_type start, size_type length
                          = std::numeric_limits<size_type>::max()) const;
 
+  /// Advises the operating system that a range of the chunk will be accessed
+  /// soon. For memory-mapped chunks, this starts reading the affected pages
+  /// from disk in the background.
+  /// @param start The offset from the beginning where to begin the range.
+  /// @param length The length of the range, beginning at *start*.
+  /// @pre `start < size()`
+  void prefetch(size_type start = 0,
+                size_type length
+                = std::numeric_limits<size_type>::max()) const noexcept;
+
   /// Adds an additional step for deleting this chunk.
   /// @param step Function object that gets called after all previous deletion
   /// steps ran. It must be nothrow-invocable, as it gets called during the
@@ -350,21 +350,88 @@ constexpr std::chrono::seconds disk_scan_interval = std::chrono::minutes{1};
 /// Maximum number of events per INDEX partition.
 constexpr size_t max_partition_size = 1'048'576; // 1_Mi
 
-/// Maximum number of in-memory INDEX partitions.
+/// Maximum size of the in-memory INDEX partitions in MiB.
+constexpr size_t partition_cache_size = 1'024;
+
+/// Maximum number of in-memory INDEX partitions for the deprecated option
+/// `vast.max-resident-partitions`, which corresponds to the default
+/// `partition_cache_size`.
 constexpr size_t max_in_mem_partitions = 10;
 
 /// Number of immediately scheduled INDEX partitions.
 constexpr size_t taste_partitions = 5;
 
+/// Number of INDEXING WORKERS per active INDEX partition. A value of 0 spawns
+/// one ACTIVE INDEXER per field instead.
+constexpr size_t indexing_workers = 0;
+
+/// Length of the wall-clock time windows at which active INDEX partitions
+/// roll over. A value of 0 disables time windows, such that partitions roll
+/// over only when they reach their maximum size.
+constexpr caf::timespan partition_window = caf::timespan::zero();
+
+/// Maximum number of concurrent active INDEX partitions. At the limit, the
+/// first slice of another layout makes the INDEX persist the active partition
+/// that received events least recently.
+constexpr size_t max_active_partitions = 16;
+
+/// Duration without new events after which the INDEX persists an active
+/// partition, independent of the partition window. A value of 0 keeps idle
+/// partitions active.
+constexpr caf::timespan active_partition_timeout = std::chrono::minutes{5};
+
+/// Maximum number of events the INDEX merges per compaction cycle. A value of
+/// 0 disables periodic compaction.
+constexpr size_t partition_compaction_budget = 0;
+
+/// Interval between two compaction cycles of the INDEX.
+constexpr std::chrono::milliseconds partition_compaction_interval
+  = std::chrono::minutes{1};
+
+/// Number of threads that read the synopses of persisted INDEX partitions at
+/// startup.
+constexpr size_t synopsis_loaders = 4;
+
+/// Whether the INDEX answers queries before it loaded all synopses of
+/// persisted partitions.
+constexpr bool lazy_synopses = false;
+
+/// Number of META INDEX shards that look up candidate partitions in parallel.
+constexpr size_t meta_index_shards = 4;
+
+/// Number of INDEX journal entries between two checkpoints of the full INDEX
+/// state.
+constexpr size_t index_checkpoint_interval = 100;
+
 /// Maximum number of concurrent INDEX queries.
 constexpr size_t num_query_supervisors = 10;
 
-/// Number of cached ARCHIVE segments.
-constexpr size_t segments = 10;
+/// Maximum size of the cached ARCHIVE segments in MiB.
+constexpr size_t segment_cache_size = 1'024;
 
 /// Maximum size of ARCHIVE segments in MiB.
 constexpr size_t max_segment_size = 1'024;
 
+/// Maximum number of concurrent ARCHIVE extraction sessions.
+constexpr size_t max_archive_sessions = 4;
+
+/// Number of candidate ARCHIVE segments to read ahead during extraction.
+constexpr size_t segment_read_ahead = 2;
+
+/// Maximum number of MiB the ARCHIVE reads per compaction cycle.
+constexpr size_t segment_compaction_budget = 128;
+
+/// Number of ARCHIVE catalog journal entries between two rewrites of the full
+/// segment catalog.
+constexpr size_t segment_catalog_checkpoint_interval = 100;
+
+/// Interval between two compaction cycles of the ARCHIVE.
+constexpr std::chrono::milliseconds segment_compaction_interval
+  = std::chrono::minutes{1};
+
+/// Number of concurrent blocking operations of the FILESYSTEM.
+constexpr size_t filesystem_workers = 4;
+
 /// Number of initial IDs to request in the IMPORTER.
 constexpr size_t initially_requested_ids = 128;
 
@@ -393,6 +460,13 @@ constexpr std::chrono::seconds shutdown_kill_timeout = std::chrono::minutes{1};
 /// The allowed false positive rate for an address_synopsis.
 constexpr double address_synopsis_fprate = 0.01;
 
+/// The allowed false positive rate for a string_synopsis.
+constexpr double string_synopsis_fprate = 0.01;
+
+/// The maximum number of distinct values for which an active partition keeps
+/// the exact set of addresses or strings instead of a Bloom filter.
+constexpr size_t max_set_synopsis_size = 128;
+
 } // namespace system
 
 } // namespace vast::defaults
@@ -24,14 +24,15 @@
 #include "vast/error.hpp"
 
 #include "vast/detail/assert.hpp"
+#include "vast/detail/cache_policy.hpp"
 #include "vast/detail/operators.hpp"
 #include "vast/detail/type_traits.hpp"
 
 namespace vast::detail {
 
-struct lru;
-
-/// A direct-mapped cache with fixed capacity.
+/// A direct-mapped cache with fixed capacity. The capacity limits the total
+/// weight of all elements, which is the number of elements unless the cache
+/// has a custom weigh function.
 template <class Key, class Value, class Policy = lru>
 class cache : equality_comparable<cache<Key, Value, Policy>> {
 public:
@@ -47,10 +48,17 @@ public:
   /// The callback to invoke for evicted elements.
   using evict_callback = std::function<void(key_type&, mapped_type&)>;
 
-  /// Constructs an LRU cache with a maximum number of elements.
-  /// @param capacity The maximum number of elements in the cache.
+  /// The function that determines the weight of an element.
+  using weigh_function
+    = std::function<size_t(const key_type&, const mapped_type&)>;
+
+  /// Constructs an LRU cache with a maximum total weight of its elements.
+  /// @param capacity The maximum total weight of the elements in the cache.
+  /// @param weigh The function that determines the weight of an element upon
+  ///        insertion. Without a weigh function, every element weighs 1.
   /// @pre `capacity > 0`
-  cache(size_t capacity = 100) : capacity_{capacity} {
+  cache(size_t capacity = 100, weigh_function weigh = {})
+    : weigh_{std::move(weigh)}, capacity_{capacity} {
     VAST_ASSERT(capacity_ > 0);
   }
 
@@ -67,34 +75,48 @@ public:
   /// @pre `!empty()`
   value_type evict() {
     VAST_ASSERT(!empty());
-    auto i = tracker_.find(xs_.front().first);
+    auto j = policy_.victim(xs_);
+    auto i = tracker_.find(j->first);
     VAST_ASSERT(i != tracker_.end());
+    weight_ -= i->second.second;
     tracker_.erase(i);
-    auto victim = std::move(xs_.front());
-    xs_.pop_front();
+    auto victim = std::move(*j);
+    xs_.erase(j);
+    ++statistics_.evictions;
     if (on_evict_)
       on_evict_(const_cast<key_type&>(victim.first), victim.second);
     return victim;
   }
 
-  /// Retrieves the maximum number elements the cache can hold.
+  /// Retrieves the maximum total weight of the elements the cache can hold.
   /// @returns The cache's capacity.
   size_t capacity() const {
     return capacity_;
   }
 
   /// Adjusts the cache capacity and evicts elements if the new capacity is
-  /// smaller than the previous one.
+  /// smaller than the total weight of the elements.
   /// @param c the new capacity.
   /// @pre `c > 0`
   void capacity(size_t c) {
     VAST_ASSERT(c > 0);
     capacity_ = c;
-    auto n = size();
-    for (auto i = c; i < n; ++i)
+    while (weight_ > capacity_)
       evict();
   }
 
+  /// Retrieves the total weight of the elements in the cache.
+  /// @returns The sum of the weights of all elements.
+  size_t weight() const {
+    return weight_;
+  }
+
+  /// Retrieves the counters for lookups and evictions.
+  /// @returns The cache statistics.
+  const cache_statistics& statistics() const {
+    return statistics_;
+  }
+
   /// Retrieves the current number of elements in the cache.
   /// @returns The number of elements in the cache.
   size_t size() const {
@@ -151,13 +173,14 @@ public:
     auto i = tracker_.find(x);
     if (i == tracker_.end())
       return insert({x, {}}).first->second;
-    policy::access(xs_, i->second);
-    return i->second;
+    policy_.access(xs_, i->second.first);
+    return i->second.first->second;
   }
 
   // -- modifiers -----------------------------------------------------------
 
-  /// Inserts a fresh entry in the cache.
+  /// Inserts a fresh entry in the cache. If the entry weighs more than the
+  /// capacity on its own, the cache evicts all other entries.
   /// @param key The key mapping to *value*.
   /// @param value The value for *key*.
   /// @returns An pair of an iterator and boolean flag that indicates whether
@@ -170,13 +193,15 @@ public:
   > {
     auto i = tracker_.find(x.first);
     if (i != tracker_.end()) {
-      policy::access(xs_, i->second);
-      return {i->second, false};
+      policy_.access(xs_, i->second.first);
+      return {i->second.first, false};
     }
-    if (size() == capacity_)
+    auto weight = weigh(x.first, x.second);
+    while (!empty() && weight_ + weight > capacity_)
       evict();
-    auto j = policy::insert(xs_, std::forward<T>(x));
-    tracker_.emplace(j->first, j);
+    auto j = policy_.insert(xs_, std::forward<T>(x));
+    tracker_.emplace(j->first, std::pair{j, weight});
+    weight_ += weight;
     return {j, true};
   }
 
@@ -192,7 +217,9 @@ public:
     auto i = tracker_.find(x);
     if (i == tracker_.end())
       return 0;
-    xs_.erase(i->second);
+    weight_ -= i->second.second;
+    policy_.erase(xs_, i->second.first);
+    xs_.erase(i->second.first);
     tracker_.erase(i);
     return 1;
   }
@@ -201,11 +228,14 @@ public:
   void erase(iterator i) {
     auto j = tracker_.begin();
     while (j != tracker_.end()) {
-      if (j->second == i)
+      if (j->second.first == i) {
+        weight_ -= j->second.second;
         j = tracker_.erase(j);
-      else
+      } else {
         ++j;
+      }
     }
+    policy_.erase(xs_, i);
     xs_.erase(i);
   }
 
@@ -213,29 +243,56 @@ public:
   void clear() {
     xs_.clear();
     tracker_.clear();
+    policy_.clear();
+    weight_ = 0;
   }
 
   // -- lookup --------------------------------------------------------------
 
+  /// Looks up an element and counts the lookup as hit or miss.
   auto find(const key_type& x) {
     auto i = tracker_.find(x);
-    if (i == tracker_.end())
+    if (i == tracker_.end()) {
+      ++statistics_.misses;
       return xs_.end();
-    policy::access(xs_, i->second);
-    return i->second;
+    }
+    ++statistics_.hits;
+    policy_.access(xs_, i->second.first);
+    return i->second.first;
   }
 
   size_t count(const key_type& x) {
     return find(x) == end() ? 0 : 1;
   }
 
+  /// Looks up an element without counting the lookup or affecting the
+  /// eviction order.
+  auto peek(const key_type& x) {
+    auto i = tracker_.find(x);
+    if (i == tracker_.end())
+      return xs_.end();
+    return i->second.first;
+  }
+
+  /// Checks whether the cache holds an element without counting the lookup or
+  /// affecting the eviction order.
+  bool contains(const key_type& x) const {
+    return tracker_.count(x) != 0;
+  }
+
   // -- concepts ------------------------------------------------------------
 
   template <class Inspector>
   friend auto inspect(Inspector& f, cache& c) {
     auto load = [&]() -> error {
-      for (auto i = c.xs_.begin(); i != c.xs_.end(); ++i)
-        c.tracker_.emplace(i->first, i);
+      c.tracker_.clear();
+      c.policy_.clear();
+      c.weight_ = 0;
+      for (auto i = c.xs_.begin(); i != c.xs_.end(); ++i) {
+        auto weight = c.weigh(i->first, i->second);
+        c.tracker_.emplace(i->first, std::pair{i, weight});
+        c.weight_ += weight;
+      }
       return {};
     };
     return f(c.xs_, c.capacity_, caf::meta::load_callback(load));
@@ -246,36 +303,18 @@ public:
   }
 
 private:
+  size_t weigh(const key_type& key, const mapped_type& value) const {
+    return weigh_ ? weigh_(key, value) : 1;
+  }
+
   std::list<value_type> xs_;
-  std::unordered_map<key_type, iterator> tracker_;
+  std::unordered_map<key_type, std::pair<iterator, size_t>> tracker_;
   evict_callback on_evict_;
+  weigh_function weigh_;
+  policy policy_;
+  cache_statistics statistics_;
   size_t capacity_;
-};
-
-/// A *least recently used* (LRU) cache eviction policy.
-struct lru {
-  template <class List, class Iterator>
-  static void access(List& xs, Iterator i) {
-    xs.splice(xs.end(), xs, i);
-  }
-
-  template <class List, class T>
-  static auto insert(List& xs, T&& x) {
-    return xs.insert(xs.end(), std::forward<T>(x));
-  }
-};
-
-/// A *most recently used* (MRU) cache eviction policy.
-struct mru {
-  template <class List, class Iterator>
-  static void access(List& xs, Iterator i) {
-    xs.splice(xs.begin(), xs, i);
-  }
-
-  template <class List, class T>
-  static auto insert(List& xs, T&& x) {
-    return xs.insert(xs.begin(), std::forward<T>(x));
-  }
+  size_t weight_ = 0;
 };
 
 } // namespace vast::detail
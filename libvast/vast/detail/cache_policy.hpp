@@ -0,0 +1,181 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <unordered_set>
+#include <utility>
+
+namespace vast::detail {
+
+/// Counters that describe the effectiveness of a cache.
+struct cache_statistics {
+  /// The number of lookups that found an entry.
+  uint64_t hits = 0;
+
+  /// The number of lookups that did not find an entry.
+  uint64_t misses = 0;
+
+  /// The number of entries that the cache evicted to make room.
+  uint64_t evictions = 0;
+};
+
+// A cache eviction policy determines the position of new entries in the list
+// of a cache, how accessing an entry affects the order of the list, and which
+// entry the cache evicts next. Policies may carry state, but must not rely on
+// the order in which the cache iterates over its entries.
+
+/// A *least recently used* (LRU) cache eviction policy.
+struct lru {
+  template <class List, class T>
+  auto insert(List& xs, T&& x) {
+    return xs.insert(xs.end(), std::forward<T>(x));
+  }
+
+  template <class List, class Iterator>
+  void access(List& xs, Iterator i) {
+    xs.splice(xs.end(), xs, i);
+  }
+
+  template <class List>
+  auto victim(List& xs) {
+    return xs.begin();
+  }
+
+  template <class List, class Iterator>
+  void erase(List&, Iterator) {
+    // nop
+  }
+
+  void clear() {
+    // nop
+  }
+};
+
+/// A *most recently used* (MRU) cache eviction policy.
+struct mru {
+  template <class List, class T>
+  auto insert(List& xs, T&& x) {
+    return xs.insert(xs.begin(), std::forward<T>(x));
+  }
+
+  template <class List, class Iterator>
+  void access(List& xs, Iterator i) {
+    xs.splice(xs.begin(), xs, i);
+  }
+
+  template <class List>
+  auto victim(List& xs) {
+    return xs.begin();
+  }
+
+  template <class List, class Iterator>
+  void erase(List&, Iterator) {
+    // nop
+  }
+
+  void clear() {
+    // nop
+  }
+};
+
+/// A scan-resistant cache eviction policy after *2Q* by Johnson and Shasha.
+/// New entries start out on probation and only become protected when they get
+/// accessed again, either while on probation or shortly after their eviction.
+/// The cache evicts entries on probation first, such that a single sweep over
+/// many entries cannot displace the frequently used ones. The list holds the
+/// entries on probation in insertion order, followed by the protected entries
+/// in LRU order.
+class two_queue {
+public:
+  template <class List, class T>
+  auto insert(List& xs, T&& x) {
+    // An entry that returns shortly after its eviction is protected right
+    // away.
+    if (forget(hash(x.first)))
+      return xs.insert(xs.end(), std::forward<T>(x));
+    auto i = xs.insert(std::next(xs.begin(), probation_.size()),
+                       std::forward<T>(x));
+    probation_.insert(&*i);
+    return i;
+  }
+
+  template <class List, class Iterator>
+  void access(List& xs, Iterator i) {
+    probation_.erase(&*i);
+    xs.splice(xs.end(), xs, i);
+  }
+
+  template <class List>
+  auto victim(List& xs) {
+    auto i = xs.begin();
+    if (probation_.erase(&*i) > 0)
+      remember(hash(i->first), xs.size());
+    return i;
+  }
+
+  template <class List, class Iterator>
+  void erase(List&, Iterator i) {
+    probation_.erase(&*i);
+  }
+
+  void clear() {
+    probation_.clear();
+    ghosts_.clear();
+    ghost_order_.clear();
+  }
+
+private:
+  template <class Key>
+  static size_t hash(const Key& x) {
+    return std::hash<Key>{}(x);
+  }
+
+  /// Removes a key from the set of recently evicted keys.
+  /// @returns Whether the cache evicted the key recently.
+  bool forget(size_t key) {
+    if (ghosts_.erase(key) == 0)
+      return false;
+    ghost_order_.remove(key);
+    return true;
+  }
+
+  /// Adds a key to the set of recently evicted keys, which holds at most as
+  /// many keys as the cache holds entries.
+  void remember(size_t key, size_t max_size) {
+    if (!ghosts_.insert(key).second)
+      return;
+    ghost_order_.push_back(key);
+    while (ghost_order_.size() > max_size) {
+      ghosts_.erase(ghost_order_.front());
+      ghost_order_.pop_front();
+    }
+  }
+
+  /// The addresses of the entries on probation.
+  std::unordered_set<const void*> probation_;
+
+  /// The hashes of the keys of entries that were recently evicted while on
+  /// probation. Hash collisions only cause spurious promotions.
+  std::unordered_set<size_t> ghosts_;
+
+  /// The hashes in `ghosts_` in the order of their eviction.
+  std::list<size_t> ghost_order_;
+};
+
+} // namespace vast::detail
@@ -26,10 +26,15 @@
 // if a key is missing from the cache.
 // Additionally, iteration support and `resize()` and `clear()` function were
 // added; and `exists()` was renamed to `contains()` for closer alignment with
-// the standard library containers.
+// the standard library containers. Finally, a `Weigher` was added that allows
+// for limiting the cache by the total weight of its entries, e.g., in bytes,
+// rather than by their number, and a `Policy` that decides which entry to
+// evict. Despite its name, the cache supports all policies of `cache.hpp`.
 
 #pragma once
 
+#include "vast/detail/cache_policy.hpp"
+
 #include <cstddef>
 #include <list>
 #include <stdexcept>
@@ -38,7 +43,20 @@
 
 namespace vast::detail {
 
-template <typename Key, typename Value, typename Factory>
+/// Assigns every entry of an `lru_cache` the same weight, such that the
+/// maximum size of the cache limits the number of its entries.
+struct unit_weigher {
+  template <class Key, class Value>
+  size_t operator()(const Key&, const Value&) const {
+    return 1;
+  }
+};
+
+/// A cache that evicts entries according to its policy once the total weight
+/// of all entries exceeds the maximum size. The cache always retains the most
+/// recently inserted entry, even if its weight exceeds the maximum size alone.
+template <typename Key, typename Value, typename Factory,
+          typename Weigher = unit_weigher, typename Policy = lru>
 class lru_cache {
 public:
   using key_value_pair = std::pair<Key, Value>;
@@ -46,26 +64,23 @@ public:
   using const_list_iterator =
     typename std::list<key_value_pair>::const_iterator;
 
-  lru_cache(size_t max_size, Factory factory)
-    : max_size_(max_size), factory_(std::move(factory)) {
+  lru_cache(size_t max_size, Factory factory, Weigher weigher = Weigher{})
+    : max_size_(max_size),
+      factory_(std::move(factory)),
+      weigher_(std::move(weigher)) {
   }
 
   void clear() {
     cache_items_map_.clear();
     cache_items_list_.clear();
+    policy_.clear();
+    weight_ = 0;
   }
 
   void resize(size_t max_size) {
-    // FIXME: write unit test for this
-    if (cache_items_list_.size() > max_size) {
-      auto new_end = std::next(cache_items_list_.begin(), max_size);
-      while (new_end != cache_items_list_.end()) {
-        cache_items_map_.erase(new_end->first);
-        auto position = new_end++;
-        cache_items_list_.erase(position);
-      }
-    }
     max_size_ = max_size;
+    while (weight_ > max_size_)
+      evict();
   }
 
   list_iterator begin() {
@@ -85,39 +100,34 @@ public:
   }
 
   const Value& put(Key key, Value value) {
-    auto it = cache_items_map_.find(key);
-    cache_items_list_.push_front(
-      key_value_pair(std::move(key), std::move(value)));
-    if (it != cache_items_map_.end()) {
-      cache_items_list_.erase(it->second);
-      cache_items_map_.erase(it);
-    }
-    auto& result = cache_items_list_.begin()->second;
-    cache_items_map_[key] = cache_items_list_.begin();
-    if (cache_items_map_.size() > max_size_) {
-      auto last = cache_items_list_.end();
-      last--;
-      cache_items_map_.erase(last->first);
-      cache_items_list_.pop_back();
-    }
-    return result;
+    drop(key);
+    auto weight = weigher_(key, value);
+    while (!cache_items_list_.empty() && weight_ + weight > max_size_)
+      evict();
+    auto it = policy_.insert(cache_items_list_,
+                             key_value_pair(std::move(key), std::move(value)));
+    cache_items_map_.emplace(it->first, std::pair{it, weight});
+    weight_ += weight;
+    return it->second;
   }
 
   const Value& get_or_load(const Key& key) {
     auto it = cache_items_map_.find(key);
     if (it != cache_items_map_.end()) {
-      cache_items_list_.splice(cache_items_list_.begin(), cache_items_list_,
-                               it->second);
-      return it->second->second;
+      ++statistics_.hits;
+      policy_.access(cache_items_list_, it->second.first);
+      return it->second.first->second;
     }
+    ++statistics_.misses;
     return put(key, factory_(key));
-    ;
   }
 
   void drop(const Key& key) {
     auto it = cache_items_map_.find(key);
     if (it != cache_items_map_.end()) {
-      cache_items_list_.erase(it->second);
+      weight_ -= it->second.second;
+      policy_.erase(cache_items_list_, it->second.first);
+      cache_items_list_.erase(it->second.first);
       cache_items_map_.erase(it);
     }
   }
@@ -130,15 +140,46 @@ public:
     return cache_items_map_.size();
   }
 
+  /// @returns The total weight of all entries.
+  size_t weight() const {
+    return weight_;
+  }
+
+  /// @returns The maximum total weight of all entries.
+  size_t max_size() const {
+    return max_size_;
+  }
+
   Factory& factory() {
     return factory_;
   }
 
+  Weigher& weigher() {
+    return weigher_;
+  }
+
+  const cache_statistics& statistics() const {
+    return statistics_;
+  }
+
 private:
+  void evict() {
+    auto victim = policy_.victim(cache_items_list_);
+    auto it = cache_items_map_.find(victim->first);
+    weight_ -= it->second.second;
+    cache_items_map_.erase(it);
+    cache_items_list_.erase(victim);
+    ++statistics_.evictions;
+  }
+
   std::list<key_value_pair> cache_items_list_;
-  std::unordered_map<Key, list_iterator> cache_items_map_;
+  std::unordered_map<Key, std::pair<list_iterator, size_t>> cache_items_map_;
   size_t max_size_;
+  size_t weight_ = 0;
   Factory factory_;
+  Weigher weigher_;
+  Policy policy_;
+  cache_statistics statistics_;
 };
 
 } // namespace vast::detail
@@ -0,0 +1,48 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/byte.hpp"
+#include "vast/span.hpp"
+
+#include <cstddef>
+
+namespace vast::detail::lz4 {
+
+/// Computes the maximum size of a compressed LZ4 block.
+/// @param size The number of bytes to compress.
+/// @returns The worst-case size of compressing *size* bytes, or 0 if *size*
+///          exceeds the maximum input size of LZ4.
+size_t compress_bound(size_t size) noexcept;
+
+/// Computes the maximum size of a decompressed LZ4 block.
+/// @param size The size of the compressed block.
+/// @returns The largest number of bytes that a valid block of *size* bytes
+///          can decompress to.
+size_t decompress_bound(size_t size) noexcept;
+
+/// Compresses a buffer into a single LZ4 block.
+/// @param input The bytes to compress.
+/// @param output The buffer to write the compressed block into.
+/// @returns The number of bytes written to *output*, or 0 on failure.
+/// @pre `output.size() >= compress_bound(input.size())`
+size_t compress(span<const byte> input, span<byte> output) noexcept;
+
+/// Decompresses a single LZ4 block.
+/// @param input The compressed block.
+/// @param output The buffer to write the decompressed bytes into.
+/// @returns The number of bytes written to *output*, or 0 on failure.
+size_t decompress(span<const byte> input, span<byte> output) noexcept;
+
+} // namespace vast::detail::lz4
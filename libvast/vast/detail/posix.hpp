@@ -133,6 +133,24 @@ struct [[nodiscard]] unix_domain_socket {
 [[nodiscard]] caf::expected<size_t>
 write(int fd, const void* buffer, size_t bytes);
 
+/// Wraps `pread(2)`.
+/// @param fd The file descriptor to read from.
+/// @param buffer The buffer to write into.
+/// @param bytes The number of bytes to read from *fd* and write into *buffer*.
+/// @param offset The position in *fd* to start reading from.
+/// @returns the number of bytes on successful reading.
+[[nodiscard]] caf::expected<size_t>
+pread(int fd, void* buffer, size_t bytes, size_t offset);
+
+/// Wraps `pwrite(2)`.
+/// @param fd The file descriptor to write to.
+/// @param buffer The buffer to read from.
+/// @param bytes The number of bytes to write into *fd* from *buffer*.
+/// @param offset The position in *fd* to start writing at.
+/// @returns the number of written bytes on successful writing.
+[[nodiscard]] caf::expected<size_t>
+pwrite(int fd, const void* buffer, size_t bytes, size_t offset);
+
 /// Wraps `seek(2)`.
 /// @param fd A seekable file descriptor.
 /// @param bytes The number of bytes that should be skipped.
@@ -15,12 +15,64 @@
 
 #include "vast/bitmap_base.hpp"
 #include "vast/bitvector.hpp"
+#include "vast/chunk.hpp"
+#include "vast/span.hpp"
 #include "vast/word.hpp"
 
 #include "vast/detail/operators.hpp"
 
+#include <caf/meta/load_callback.hpp>
+#include <caf/sec.hpp>
+
+#include <cstdint>
+#include <vector>
+
 namespace vast {
 
+class ewah_bitmap;
+
+/// A side table for the blocks of EWAH bitmaps inside CAF-serialized objects.
+/// While a table is alive, it is installed for the calling thread: CAF
+/// serialization then writes only the position of an `ewah_bitmap` in the
+/// table, and deserialization resolves such a position into a copy of the
+/// bitmap in the table. This allows for storing the blocks of all bitmaps of
+/// an object in a native, aligned format next to its serialized form.
+class ewah_bitmap_table {
+public:
+  /// Installs an empty table that collects bitmaps during serialization.
+  ewah_bitmap_table();
+
+  /// Installs a table that resolves bitmaps during deserialization.
+  /// @param bitmaps The bitmaps referenced by the serialized data.
+  explicit ewah_bitmap_table(std::vector<ewah_bitmap> bitmaps);
+
+  /// Restores the previously installed table.
+  ~ewah_bitmap_table();
+
+  ewah_bitmap_table(const ewah_bitmap_table&) = delete;
+  ewah_bitmap_table& operator=(const ewah_bitmap_table&) = delete;
+
+  /// @returns the table installed for the calling thread, or `nullptr`.
+  static ewah_bitmap_table* current();
+
+  /// Appends a bitmap to the table.
+  /// @param bm The bitmap to append.
+  /// @returns The position of *bm* in the table.
+  uint64_t add(const ewah_bitmap& bm);
+
+  /// Looks up a bitmap by its position.
+  /// @param position The position of the bitmap in the table.
+  /// @returns A pointer to the bitmap or `nullptr` if *position* is invalid.
+  const ewah_bitmap* at(uint64_t position) const;
+
+  /// @returns all bitmaps in the table.
+  const std::vector<ewah_bitmap>& bitmaps() const;
+
+private:
+  std::vector<ewah_bitmap> bitmaps_;
+  ewah_bitmap_table* previous_;
+};
+
 template <class Block>
 struct ewah_word : word<Block> {
   /// The offset from the LSB which separates clean and dirty counters.
@@ -86,6 +138,9 @@ struct ewah_word : word<Block> {
 /// 1. The first block is a marker.
 /// 2. The last block is always dirty.
 ///
+/// A bitmap can also borrow its blocks from a chunk, e.g., from a memory-mapped
+/// file. Such a bitmap is read-only until the first modification, which copies
+/// the blocks into the bitmap.
 class ewah_bitmap : public bitmap_base<ewah_bitmap>,
                     detail::equality_comparable<ewah_bitmap> {
 public:
@@ -96,13 +151,27 @@ public:
 
   explicit ewah_bitmap(size_type n, bool bit = false);
 
+  /// Constructs a bitmap that borrows its blocks from a chunk.
+  /// @param blocks The blocks of the bitmap, residing in *owner*.
+  /// @param last_marker The position of the last marker in *blocks*.
+  /// @param num_bits The number of bits in the bitmap.
+  /// @param owner The chunk that keeps *blocks* alive.
+  ewah_bitmap(span<const block_type> blocks, size_type last_marker,
+              size_type num_bits, chunk_ptr owner);
+
   // -- inspectors -----------------------------------------------------------
 
   bool empty() const;
 
   size_type size() const;
 
-  const block_vector& blocks() const;
+  span<const block_type> blocks() const;
+
+  /// @returns the position of the last marker in `blocks()`.
+  size_type last_marker() const;
+
+  /// @returns `true` if the bitmap borrows its blocks from a chunk.
+  bool borrowed() const;
 
   // -- modifiers ------------------------------------------------------------
 
@@ -119,11 +188,41 @@ public:
   friend bool operator==(const ewah_bitmap& x, const ewah_bitmap& y);
 
   template <class Inspector>
-  friend auto inspect(Inspector&f, ewah_bitmap& bm) {
-    return f(bm.blocks_, bm.last_marker_, bm.num_bits_);
+  friend auto inspect(Inspector& f, ewah_bitmap& bm) {
+    auto table = ewah_bitmap_table::current();
+    if constexpr (Inspector::reads_state) {
+      if (table) {
+        auto position = table->add(bm);
+        return f(position);
+      }
+      if (bm.borrowed()) {
+        auto blocks = block_vector(bm.view_.begin(), bm.view_.end());
+        return f(blocks, bm.last_marker_, bm.num_bits_);
+      }
+      return f(bm.blocks_, bm.last_marker_, bm.num_bits_);
+    } else {
+      static_assert(Inspector::writes_state);
+      bm.view_ = {};
+      bm.owner_ = nullptr;
+      if (table) {
+        auto position = uint64_t{0};
+        auto cb = [&]() -> caf::error {
+          auto x = table->at(position);
+          if (!x)
+            return caf::sec::invalid_argument;
+          bm = *x;
+          return caf::none;
+        };
+        return f(position, caf::meta::load_callback(cb));
+      }
+      return f(bm.blocks_, bm.last_marker_, bm.num_bits_);
+    }
   }
 
 private:
+  /// Copies borrowed blocks into the bitmap before a modification.
+  void materialize();
+
   /// Incorporates the most recent (complete) dirty block.
   /// @pre `num_bits_ % word_type::width == 0`
   void integrate_last_block();
@@ -136,6 +235,8 @@ private:
   block_vector blocks_;
   size_type last_marker_ = 0;
   size_type num_bits_ = 0;
+  span<const block_type> view_;
+  chunk_ptr owner_;
 };
 
 class ewah_bitmap_range
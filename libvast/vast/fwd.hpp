@@ -43,6 +43,7 @@ namespace vast {
 
 namespace fbs {
 
+struct CompressedTableSlice;
 struct FlatTableSlice;
 struct TableSlice;
 
@@ -85,6 +86,7 @@ class schema;
 class segment;
 class segment_builder;
 class segment_store;
+class segment_writer;
 class store;
 class subnet;
 class synopsis;
@@ -266,7 +268,9 @@ CAF_BEGIN_TYPE_ID_BLOCK(vast, caf::first_custom_type_id)
 
   VAST_ADD_ATOM(accept, "accept")
   VAST_ADD_ATOM(announce, "announce")
+  VAST_ADD_ATOM(append, "append")
   VAST_ADD_ATOM(batch, "batch")
+  VAST_ADD_ATOM(compact, "compact")
   VAST_ADD_ATOM(config, "config")
   VAST_ADD_ATOM(continuous, "continuous")
   VAST_ADD_ATOM(cpu, "cpu")
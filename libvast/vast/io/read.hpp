@@ -32,4 +32,13 @@ caf::error read(const path& filename, span<byte> xs);
 /// @returns The raw bytes of the buffer.
 caf::expected<std::vector<byte>> read(const path& filename);
 
+/// Reads a range of bytes from a file without reading the rest of it.
+/// @param filename The file to read from.
+/// @param offset The position of the first byte to read.
+/// @param size The number of bytes to read.
+/// @returns The raw bytes of the range, which are fewer than *size* if the
+///          file ends before the end of the range.
+caf::expected<std::vector<byte>>
+read(const path& filename, size_t offset, size_t size);
+
 } // namespace vast::io
@@ -25,4 +25,11 @@ namespace vast::io {
 /// @returns An error if the operation failed.
 caf::error write(const path& filename, span<const byte> xs);
 
+/// Appends an immutable buffer to a file, creating the file if it does not
+/// exist yet.
+/// @param filename The file to append to.
+/// @param xs The buffer to read from.
+/// @returns An error if the operation failed.
+caf::error append(const path& filename, span<const byte> xs);
+
 } // namespace vast::io
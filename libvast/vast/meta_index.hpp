@@ -23,7 +23,9 @@
 #include "vast/type.hpp"
 #include "vast/uuid.hpp"
 
+#include <caf/allowed_unsafe_message_type.hpp>
 #include <caf/fwd.hpp>
+#include <caf/meta/load_callback.hpp>
 #include <caf/settings.hpp>
 
 #include <flatbuffers/flatbuffers.h>
@@ -59,6 +61,11 @@ struct partition_synopsis {
 
   /// Synopsis data structures for individual columns.
   std::unordered_map<qualified_record_field, synopsis_ptr> field_synopses_;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, partition_synopsis& x) {
+    return f(x.field_synopses_);
+  }
 };
 
 /// The meta index is the first data structure that queries hit. The result
@@ -72,18 +79,26 @@ public:
   /// @param partition The partition ID that *slice* belongs to.
   void add(const uuid& partition, const table_slice& slice);
 
+  /// Adds a partition whose synopses are not available yet because they are
+  /// still being built elsewhere. Lookups only rule out such a partition by
+  /// its layout name until its synopses arrive via `merge` or `replace`.
+  /// @param partition The partition ID.
+  /// @param layout_name The name of the layout of all events in *partition*,
+  ///        or the empty string if it is unknown.
+  void add_pending(const uuid& partition, std::string layout_name);
+
   /// Adds new synopses for a partition in bulk. Used when
   /// re-building the meta index state at startup.
   void merge(const uuid& partition, partition_synopsis&&);
 
-  /// Replaces an existing partition synopsis. Does nothing
-  /// if `partition` does not exist as a key.
+  /// Replaces the synopsis of a partition, or adds it if `partition` does not
+  /// exist as a key.
   void replace(const uuid& partition, std::unique_ptr<partition_synopsis>);
 
   /// Returns the partition synopsis for a specific partition.
   /// Note that most callers will prefer to use `lookup()` instead.
   /// @pre `partition` must be a valid key for this meta index.
-  partition_synopsis& at(const uuid& partition);
+  const partition_synopsis& at(const uuid& partition) const;
 
   /// Erase this partition from the meta index.
   void erase(const uuid& partition);
@@ -106,7 +121,16 @@ public:
   // Allow debug printing meta_index instances.
   template <class Inspector>
   friend auto inspect(Inspector& f, meta_index& x) {
-    return f(x.synopsis_options_, x.synopses_);
+    // The field columns point into the synopses, so we rebuild them instead
+    // of serializing them.
+    auto load = [&]() -> caf::error {
+      x.columns_.clear();
+      for (auto& [partition, _] : x.synopses_)
+        x.add_columns(partition);
+      return caf::none;
+    };
+    return f(x.synopsis_options_, x.synopses_, x.pending_,
+             caf::meta::load_callback(load));
   }
 
   // Allow the partition to directly serialize the relevant synopses.
@@ -115,9 +139,32 @@ public:
                      const system::active_partition_state& x);
 
 private:
+  /// The synopses of a single field across all partitions that contain it.
+  struct field_column {
+    /// The fully qualified name of the field.
+    std::string fqn;
+
+    /// The partitions that contain the field along with their synopsis for
+    /// it, which is `nullptr` for fields without synopsis.
+    std::vector<std::pair<uuid, const synopsis*>> synopses;
+  };
+
+  /// Adds the synopses of a partition to the field columns.
+  void add_columns(const uuid& partition);
+
+  /// Removes the synopses of a partition from the field columns.
+  void erase_columns(const uuid& partition);
+
   /// Maps a partition ID to the synopses for that partition.
   std::unordered_map<uuid, partition_synopsis> synopses_;
 
+  /// The synopses of `synopses_` grouped by field, such that a lookup
+  /// resolves the fields of a predicate only once.
+  std::unordered_map<qualified_record_field, field_column> columns_;
+
+  /// Maps IDs of partitions without synopses to their layout names.
+  std::unordered_map<uuid, std::string> pending_;
+
   /// Settings for the synopsis factory.
   caf::settings synopsis_options_;
 };
@@ -130,3 +177,6 @@ pack(flatbuffers::FlatBufferBuilder& builder, const partition_synopsis&);
 caf::error unpack(const fbs::partition_synopsis::v0&, partition_synopsis&);
 
 } // namespace vast
+
+// Partition synopses move between actors of the same node only.
+CAF_ALLOW_UNSAFE_MESSAGE_TYPE(std::shared_ptr<vast::partition_synopsis>)
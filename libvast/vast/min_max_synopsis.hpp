@@ -42,6 +42,10 @@ public:
       max_ = *y;
   }
 
+  void add_nil() override {
+    has_nil_ = true;
+  }
+
   caf::optional<bool> lookup(relational_operator op,
                              data_view rhs) const override {
     auto do_lookup = [this](relational_operator op,
@@ -66,12 +70,26 @@ public:
       case in:
         return membership();
       case not_in:
-        if (auto result = membership())
-          return !*result;
-        else
-          return result;
-      case equal:
+        // All values lie outside of the list only if they are all equal and
+        // the list does not contain that value. Nil values lie outside of
+        // every list.
+        if (auto xs = caf::get_if<view<list>>(&rhs)) {
+          if (has_nil_ || min_ != max_)
+            return true;
+          for (auto x : **xs) {
+            auto result = do_lookup(equal, x);
+            if (result && *result)
+              return false;
+          }
+          return true;
+        }
+        return caf::none;
       case not_equal:
+        // Nil values differ from every value.
+        if (has_nil_)
+          return true;
+        return do_lookup(op, rhs);
+      case equal:
       case less:
       case less_equal:
       case greater:
@@ -91,6 +109,9 @@ public:
   }
 
   caf::error deserialize(caf::deserializer& source) override {
+    // The serialized form does not tell whether there were nil values, so we
+    // must assume them to answer negated predicates correctly.
+    has_nil_ = true;
     return source(min_, max_);
   }
 
@@ -102,6 +123,10 @@ public:
     return max_;
   }
 
+protected:
+  /// Whether the column contains nil values.
+  bool has_nil_ = false;
+
 private:
   bool lookup_impl(relational_operator op, const T x) const {
     // Let *min* and *max* constitute the LHS of the lookup operation and *rhs*
@@ -131,7 +156,8 @@ private:
       case equal:
         return min_ <= x && x <= max_;
       case not_equal:
-        return !(min_ <= x && x <= max_);
+        // Unless all values are equal to *rhs*, at least one differs from it.
+        return !(min_ == x && x == max_);
       case less:
         return min_ < x;
       case less_equal:
@@ -45,21 +45,41 @@ public:
   /// @returns the event IDs of all contained table slice.
   vast::ids ids() const;
 
+  /// @returns the IDs of erased events that the segment still contains.
+  const vast::ids& tombstones() const;
+
+  /// Marks events as erased without rewriting the segment. Lookups no longer
+  /// return erased events.
+  /// @param xs The IDs of all erased events of the segment.
+  void tombstones(vast::ids xs);
+
   // @returns The number of table slices in this segment.
   size_t num_slices() const;
 
+  /// @returns The number of events in this segment.
+  uint64_t num_events() const;
+
   /// @returns The underlying chunk.
   chunk_ptr chunk() const;
 
-  /// Locates the table slices for a given set of IDs.
+  /// Locates the table slices for a given set of IDs. Table slices that
+  /// contain erased events get cut such that the result contains no erased
+  /// events.
   /// @param xs The IDs to lookup.
   /// @returns The table slices according to *xs*.
   caf::expected<std::vector<table_slice>> lookup(const vast::ids& xs) const;
 
+  /// Advises the operating system to read the table slices for a given set of
+  /// IDs in the background, such that a subsequent lookup does not block on
+  /// disk I/O.
+  /// @param xs The IDs to prefetch.
+  void prefetch(const vast::ids& xs) const;
+
 private:
   explicit segment(chunk_ptr chk);
 
   chunk_ptr chunk_;
+  vast::ids tombstones_;
 };
 
 } // namespace vast
@@ -27,7 +27,8 @@
 
 namespace vast {
 
-/// A builder to create a segment from table slices.
+/// A builder to create a segment from table slices. The builder compresses
+/// every table slice individually with LZ4.
 /// @relates segment
 class segment_builder {
 public:
@@ -56,7 +57,7 @@ public:
   /// @returns The IDs for the contained table slices.
   vast::ids ids() const;
 
-  /// @returns The number of bytes of the current segment.
+  /// @returns The number of bytes of the current segment before compression.
   size_t table_slice_bytes() const;
 
   /// @returns The currently buffered table slices.
@@ -70,9 +71,12 @@ private:
   vast::id min_table_slice_offset_;
   uint64_t num_events_;
   flatbuffers::FlatBufferBuilder builder_;
-  std::vector<flatbuffers::Offset<fbs::FlatTableSlice>> flat_slices_;
+  std::vector<flatbuffers::Offset<fbs::CompressedTableSlice>>
+    compressed_slices_;
   std::vector<table_slice> slices_; // For queries to an unfinished segment.
   std::vector<fbs::interval::v0> intervals_;
+  std::vector<byte> compression_buffer_;
+  size_t table_slice_bytes_;
 };
 
 } // namespace vast
@@ -15,14 +15,21 @@
 
 #include "vast/fwd.hpp"
 
+#include "vast/defaults.hpp"
 #include "vast/detail/cache.hpp"
 #include "vast/detail/range_map.hpp"
+#include "vast/ids.hpp"
 #include "vast/path.hpp"
 #include "vast/segment.hpp"
-#include "vast/segment_builder.hpp"
+#include "vast/segment_writer.hpp"
 #include "vast/store.hpp"
 #include "vast/uuid.hpp"
 
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 namespace vast {
 
 /// @relates segment_store
@@ -31,15 +38,36 @@ using segment_store_ptr = std::unique_ptr<segment_store>;
 /// A store that keeps its data in terms of segments.
 class segment_store : public store {
 public:
+  // -- member types -----------------------------------------------------------
+
+  /// Describes a persisted segment in the catalog.
+  struct catalog_entry {
+    /// The ID intervals the segment covers.
+    std::vector<std::pair<id, id>> intervals;
+
+    /// The number of events in the segment, including erased ones.
+    uint64_t events = 0;
+
+    /// The size of the segment file in bytes.
+    uint64_t size = 0;
+
+    /// The size of the table slices in the segment before compression in
+    /// bytes, which the maximum segment size refers to.
+    uint64_t table_slice_bytes = 0;
+  };
+
   // -- constructors, destructors, and assignment operators --------------------
 
   /// Constructs a segment store.
   /// @param dir The directory where to store state.
   /// @param max_segment_size The maximum segment size in bytes.
-  /// @param in_memory_segments The number of semgents to cache in memory.
-  /// @pre `max_segment_size > 0`
-  static segment_store_ptr make(path dir, size_t max_segment_size,
-                                size_t in_memory_segments);
+  /// @param cache_size The maximum size of the cached segments in bytes.
+  /// @param read_ahead The number of candidate segments to prefetch while
+  ///        extracting table slices.
+  /// @pre `max_segment_size > 0 && cache_size > 0`
+  static segment_store_ptr
+  make(path dir, size_t max_segment_size, size_t cache_size,
+       size_t read_ahead = defaults::system::segment_read_ahead);
 
   ~segment_store();
 
@@ -50,19 +78,50 @@ public:
     return dir_ / "segments";
   }
 
+  /// @returns the path for storing the segment under construction.
+  path active_path() const {
+    return dir_ / "active";
+  }
+
+  /// @returns the path for storing the catalog of all segments.
+  path catalog_path() const {
+    return dir_ / "catalog";
+  }
+
+  /// @returns the path for the changes to the catalog since it was written.
+  path catalog_journal_path() const {
+    return dir_ / "catalog.journal";
+  }
+
+  /// @returns the path for recording the progress of a compaction.
+  path compaction_path() const {
+    return dir_ / "compaction";
+  }
+
+  /// @returns the path for storing the tombstones of erased events.
+  path tombstone_path() const {
+    return dir_ / "tombstones";
+  }
+
+  /// @returns the path for storing rewritten segments until they replace the
+  ///          original.
+  path rewrite_path() const {
+    return dir_ / "rewrites";
+  }
+
   /// @returns whether the store has no unwritten data pending.
   bool dirty() const noexcept {
-    return builder_.table_slice_bytes() != 0;
+    return writer_.num_events() != 0;
   }
 
   /// @returns the ID of the active segment.
   const uuid& active_id() const noexcept {
-    return builder_.id();
+    return writer_.id();
   }
 
   /// @returns whether `x` is currently a cached segment.
   bool cached(const uuid& x) const noexcept {
-    return cache_.count(x) != 0;
+    return cache_.contains(x);
   }
 
   // -- cache management -------------------------------------------------------
@@ -72,6 +131,65 @@ public:
     cache_.clear();
   }
 
+  // -- rewriting --------------------------------------------------------------
+
+  /// Hands out the segments that erasures left mostly dead. Rewriting a
+  /// segment takes time proportional to its size, so the caller runs
+  /// `rewrite` on a separate thread and passes the result to `finish_rewrite`.
+  /// @returns the segments to rewrite, including their current tombstones.
+  std::vector<segment> take_rewrites();
+
+  /// Writes the events of a segment that are not marked as erased into a new
+  /// segment. Does not access any state of the store.
+  /// @param x The segment to rewrite.
+  /// @param dir The directory for the new segment, i.e., `rewrite_path()`.
+  /// @returns the ID of the new segment.
+  static caf::expected<uuid> rewrite(const segment& x, const path& dir);
+
+  /// Replaces a segment with the result of `rewrite`. Removes the file of the
+  /// original segment, so the caller must ensure that no lookup from
+  /// `extract` still needs it.
+  /// @param id The ID of the rewritten segment.
+  /// @param applied The tombstones of the segment that `rewrite` applied.
+  /// @param result The ID of the new segment.
+  caf::error finish_rewrite(const uuid& id, const ids& applied,
+                            const uuid& result);
+
+  /// Gives up on rewriting a segment, e.g., after `rewrite` failed.
+  /// @param id The ID of the segment.
+  void abort_rewrite(const uuid& id);
+
+  // -- merging ----------------------------------------------------------------
+
+  /// Hands out runs of adjacent segments that are smaller than half the
+  /// maximum segment size. Merging a run takes time proportional to its size,
+  /// so the caller runs `merge` on a separate thread and passes the result to
+  /// `finish_merge`.
+  /// @param budget The maximum number of bytes to read from disk.
+  /// @returns the runs to merge, each ordered by the IDs of its segments.
+  std::vector<std::vector<segment>> take_merges(size_t budget);
+
+  /// Writes the events of multiple segments that are not marked as erased
+  /// into a single new segment. Does not access any state of the store.
+  /// @param xs The segments to merge, ordered by their IDs.
+  /// @param dir The directory for the new segment, i.e., `rewrite_path()`.
+  /// @returns the ID of the new segment.
+  static caf::expected<uuid>
+  merge(const std::vector<segment>& xs, const path& dir);
+
+  /// Replaces segments with the result of `merge`. Removes the files of the
+  /// original segments, so the caller must ensure that no lookup from
+  /// `extract` still needs them.
+  /// @param sources The IDs of the merged segments.
+  /// @param applied The tombstones of every segment that `merge` applied.
+  /// @param result The ID of the new segment.
+  caf::error finish_merge(const std::vector<uuid>& sources,
+                          const std::vector<ids>& applied, const uuid& result);
+
+  /// Gives up on merging segments, e.g., after `merge` failed.
+  /// @param sources The IDs of the segments.
+  void abort_merge(const std::vector<uuid>& sources);
+
   // -- implementation of store ------------------------------------------------
 
   error put(table_slice xs) override;
@@ -84,10 +202,15 @@ public:
 
   caf::error flush() override;
 
+  /// Merges runs of adjacent segments that are smaller than half the maximum
+  /// segment size into larger segments on the calling thread.
+  caf::expected<size_t> compact(size_t budget) override;
+
   void inspect_status(caf::settings& xs, system::status_verbosity v) override;
 
 private:
-  segment_store(path dir, uint64_t max_segment_size, size_t in_memory_segments);
+  segment_store(path dir, uint64_t max_segment_size, size_t cache_size,
+                size_t read_ahead);
 
   // -- utility functions ------------------------------------------------------
 
@@ -95,22 +218,55 @@ private:
 
   caf::error register_segment(const path& filename);
 
+  caf::error register_segment(const uuid& id, catalog_entry entry);
+
+  /// Registers all segments from the catalog.
+  /// @returns `false` if the catalog is missing or does not match the
+  ///          segments on disk.
+  bool load_catalog();
+
+  /// Persists the catalog of all segments and truncates the catalog journal.
+  caf::error save_catalog();
+
+  /// Appends the current catalog entry of a segment to the catalog journal,
+  /// or records its removal if the catalog has no entry for it. Rewrites the
+  /// full catalog every `defaults::system::segment_catalog_checkpoint_interval`
+  /// changes instead.
+  /// @param id The ID of the segment.
+  void journal_catalog(const uuid& id);
+
+  /// Completes a compaction that was interrupted after the merged segment
+  /// became visible, by removing the segments it replaces.
+  void recover_compaction();
+
   caf::expected<segment> load_segment(uuid id) const;
 
+  /// Loads the tombstones of all segments from disk.
+  caf::error load_tombstones();
+
+  /// Persists the tombstones of a segment.
+  /// @param id The ID of the segment.
+  /// @param xs The IDs of all erased events in the segment.
+  caf::error save_tombstones(const uuid& id, const ids& xs) const;
+
+  /// Forgets the tombstones of a segment and removes them from disk.
+  /// @param id The ID of the segment.
+  void drop_tombstones(const uuid& id);
+
   /// Fills `candidates` with all segments that qualify for `selection`.
   caf::error select_segments(const ids& selection,
                              std::vector<uuid>& candidates) const;
 
   /// Drops an entire segment and erases its content from disk.
   /// @param x The segment to drop.
-  /// @returns The number of events in `x`.
+  /// @returns The number of events in `x` that were not yet erased.
   uint64_t drop(segment& x);
 
-  /// Drops a segment-under-construction by resetting the builder and forcing
+  /// Drops a segment-under-construction by resetting the writer and forcing
   /// it to generate a new segment ID.
   /// @param x The segment-under-construction to drop.
   /// @returns The number of events in `x`.
-  uint64_t drop(segment_builder& x);
+  uint64_t drop(segment_writer& x);
 
   // -- member variables -------------------------------------------------------
 
@@ -120,16 +276,39 @@ private:
   /// Configures the limit each segment until we seal and flush it.
   uint64_t max_segment_size_;
 
+  /// The number of candidate segments to prefetch during extraction.
+  size_t read_ahead_;
+
   uint64_t num_events_ = 0;
 
   /// Maps event IDs to candidate segments.
   detail::range_map<id, uuid> segments_;
 
+  /// Maps segments to the IDs of their erased events. Segments without
+  /// erased events have no entry.
+  std::unordered_map<uuid, ids> tombstones_;
+
+  /// Segments that wait for `take_rewrites`.
+  std::vector<uuid> pending_rewrites_;
+
+  /// Segments that wait for a rewrite or whose rewrite or merge is in
+  /// progress.
+  std::unordered_set<uuid> rewrites_;
+
+  /// Describes all persisted segments, such that startup does not need to
+  /// read every segment file.
+  std::unordered_map<uuid, catalog_entry> catalog_;
+
+  /// The number of entries in the catalog journal.
+  size_t catalog_journal_entries_ = 0;
+
   /// Optimizes access times into segments by keeping some segments in memory.
-  mutable detail::cache<uuid, segment> cache_;
+  /// The cache weighs segments by the size of their chunk, and resists scans
+  /// over many segments by large extractions.
+  mutable detail::cache<uuid, segment, detail::two_queue> cache_;
 
-  /// Serializes table slices into contiguous chunks of memory.
-  segment_builder builder_;
+  /// Streams table slices into the segment under construction.
+  segment_writer writer_;
 };
 
 } // namespace vast
@@ -0,0 +1,98 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/aliases.hpp"
+#include "vast/fbs/segment.hpp"
+#include "vast/file.hpp"
+#include "vast/fwd.hpp"
+#include "vast/path.hpp"
+#include "vast/uuid.hpp"
+
+#include <caf/expected.hpp>
+#include <caf/fwd.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vast {
+
+/// A writer that streams table slices into a segment file. Unlike the
+/// `segment_builder`, the writer compresses every table slice individually
+/// with LZ4 and appends it to a file in the given directory right away, such
+/// that the memory usage does not grow with the size of the segment. Only
+/// per-slice metadata remains in memory until `finish` writes it as footer
+/// and moves the file to its final destination.
+/// @relates segment
+class segment_writer {
+public:
+  /// Constructs a segment writer.
+  /// @param dir The directory for segments under construction.
+  explicit segment_writer(path dir);
+
+  /// Destroys the writer and removes the unfinished segment, if any.
+  ~segment_writer();
+
+  /// Adds a table slice to the segment.
+  /// @returns An error if adding the table slice failed.
+  /// @pre The table slice offset (`x.offset()`) must be greater than the
+  ///      offset of the previously added table slice. This requirement enables
+  ///      efficient lookup of table slices from a sequence of IDs.
+  caf::error add(table_slice x);
+
+  /// Completes the segment under construction and moves it to *filename*.
+  /// @param filename The final location of the segment.
+  /// @returns The memory-mapped segment.
+  /// @post The writer can now be reused to contruct a new segment.
+  caf::expected<segment> finish(const path& filename);
+
+  /// Locates previously added table slices for a given set of IDs by reading
+  /// them back from the unfinished segment.
+  /// @param xs The IDs to lookup.
+  /// @returns The table slices according to *xs*.
+  caf::expected<std::vector<table_slice>> lookup(const vast::ids& xs) const;
+
+  /// @returns The UUID for the segment under construction.
+  const uuid& id() const;
+
+  /// @returns The IDs for the contained table slices.
+  vast::ids ids() const;
+
+  /// @returns The number of events in the segment under construction.
+  uint64_t num_events() const;
+
+  /// @returns The number of bytes of the current segment before compression.
+  size_t table_slice_bytes() const;
+
+  /// Resets the writer state to start with a new segment and removes the
+  /// unfinished segment, if any.
+  void reset();
+
+private:
+  /// Opens the file for the segment under construction unless it is open.
+  caf::error open();
+
+  path dir_;
+  uuid id_;
+  file file_;
+  uint64_t size_;
+  uint64_t num_events_;
+  size_t table_slice_bytes_;
+  std::vector<fbs::interval::v0> intervals_;
+  std::vector<fbs::extent::v0> extents_;
+  std::vector<byte> compression_buffer_;
+};
+
+} // namespace vast
@@ -0,0 +1,191 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/address.hpp"
+#include "vast/detail/assert.hpp"
+#include "vast/subnet.hpp"
+#include "vast/synopsis.hpp"
+#include "vast/type.hpp"
+#include "vast/view.hpp"
+
+#include <caf/deserializer.hpp>
+#include <caf/optional.hpp>
+#include <caf/serializer.hpp>
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace vast {
+
+namespace detail {
+
+// A set synopsis has no sizing parameters, but deserialization must still be
+// able to tell it apart from a Bloom filter synopsis of the same type.
+inline type annotate_set_type(type type) {
+  // Replaces any previously existing attributes.
+  return std::move(type).attributes({{"synopsis", "set"}});
+}
+
+} // namespace detail
+
+/// Checks whether a type carries the `#synopsis=set` attribute.
+/// @param x The type to check.
+/// @returns `true` if a synopsis for *x* holds the exact set of values.
+/// @relates set_synopsis
+inline bool has_set_attribute(const type& x) {
+  auto pred = [](auto& attr) {
+    return attr.key == "synopsis" && attr.value && *attr.value == "set";
+  };
+  return std::any_of(x.attributes().begin(), x.attributes().end(), pred);
+}
+
+/// A synopsis that stores the distinct values of a field exactly. Unlike a
+/// Bloom filter, it never yields false positives, so it also answers negated
+/// predicates precisely.
+template <class T>
+class set_synopsis final : public synopsis {
+public:
+  /// Constructs a set synopsis from a sorted list of distinct values.
+  /// @param has_nil Whether the field also contains nil values.
+  /// @pre `std::is_sorted(values.begin(), values.end())`
+  explicit set_synopsis(vast::type x, std::vector<T> values = {},
+                        bool has_nil = false)
+    : synopsis{std::move(x)}, values_{std::move(values)}, has_nil_{has_nil} {
+    VAST_ASSERT(std::is_sorted(values_.begin(), values_.end()));
+  }
+
+  void add(data_view x) override {
+    auto y = caf::get_if<view<T>>(&x);
+    VAST_ASSERT(y != nullptr);
+    auto i = std::lower_bound(values_.begin(), values_.end(), *y);
+    if (i == values_.end() || *i != *y)
+      values_.insert(i, materialize(*y));
+  }
+
+  void add_nil() override {
+    has_nil_ = true;
+  }
+
+  caf::optional<bool>
+  lookup(relational_operator op, data_view rhs) const override {
+    switch (op) {
+      default:
+        return caf::none;
+      case equal:
+        if (auto x = caf::get_if<view<T>>(&rhs))
+          return contains(*x);
+        return caf::none;
+      case not_equal:
+        // Nil values differ from every value.
+        if (has_nil_)
+          return true;
+        if (auto x = caf::get_if<view<T>>(&rhs))
+          return values_.size() > 1
+                 || (values_.size() == 1 && values_.front() != *x);
+        return caf::none;
+      case in:
+        return membership(rhs, true);
+      case not_in:
+        // Nil values lie outside of every list and subnet.
+        if (has_nil_)
+          return true;
+        return membership(rhs, false);
+    }
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(set_synopsis))
+      return false;
+    auto& rhs = static_cast<const set_synopsis&>(other);
+    return this->type() == rhs.type() && values_ == rhs.values_
+           && has_nil_ == rhs.has_nil_;
+  }
+
+  size_t size_bytes() const override {
+    size_t result = sizeof(set_synopsis) + values_.capacity() * sizeof(T);
+    if constexpr (std::is_same_v<T, std::string>)
+      for (auto& x : values_)
+        result += x.capacity();
+    return result;
+  }
+
+  caf::error serialize(caf::serializer& sink) const override {
+    return sink(values_, has_nil_);
+  }
+
+  caf::error deserialize(caf::deserializer& source) override {
+    return source(values_, has_nil_);
+  }
+
+  /// @returns The sorted distinct values.
+  const std::vector<T>& values() const noexcept {
+    return values_;
+  }
+
+private:
+  bool contains(view<T> x) const {
+    return std::binary_search(values_.begin(), values_.end(), x);
+  }
+
+  // Checks whether any value is contained in (or, if `inside` is false,
+  // missing from) the right-hand side.
+  caf::optional<bool> membership(data_view rhs, bool inside) const {
+    if constexpr (std::is_same_v<T, address>) {
+      if (auto sn = caf::get_if<view<subnet>>(&rhs)) {
+        auto pred = [&](const address& x) { return sn->contains(x) == inside; };
+        return std::any_of(values_.begin(), values_.end(), pred);
+      }
+    }
+    auto xs = caf::get_if<view<list>>(&rhs);
+    if (!xs)
+      return caf::none;
+    // Elements of another type never compare equal to our values.
+    std::vector<view<T>> elements;
+    for (auto x : **xs)
+      if (auto y = caf::get_if<view<T>>(&x))
+        elements.push_back(*y);
+    std::sort(elements.begin(), elements.end());
+    auto pred = [&](const T& x) {
+      auto found = std::binary_search(elements.begin(), elements.end(), x);
+      return found == inside;
+    };
+    return std::any_of(values_.begin(), values_.end(), pred);
+  }
+
+  std::vector<T> values_;
+
+  /// Whether the field contains nil values.
+  bool has_nil_ = false;
+};
+
+/// Constructs a set synopsis from the distinct values of a container.
+/// @param type The type of the values.
+/// @param xs The distinct values.
+/// @param has_nil Whether the field also contains nil values.
+/// @returns A type-erased pointer to a synopsis.
+/// @relates set_synopsis
+template <class Container>
+synopsis_ptr
+make_set_synopsis(vast::type type, const Container& xs, bool has_nil = false) {
+  using value_type = typename Container::value_type;
+  std::vector<value_type> values{xs.begin(), xs.end()};
+  std::sort(values.begin(), values.end());
+  return std::make_unique<set_synopsis<value_type>>(
+    detail::annotate_set_type(std::move(type)), std::move(values), has_nil);
+}
+
+} // namespace vast
@@ -62,6 +62,12 @@ public:
   /// @returns No error on success.
   virtual caf::error flush() = 0;
 
+  /// Reorganizes persistent storage in the background, e.g., by merging
+  /// small units of storage. The default implementation does nothing.
+  /// @param budget The maximum number of bytes to read from disk.
+  /// @returns The number of bytes read from disk.
+  virtual caf::expected<size_t> compact(size_t budget);
+
   /// Fills `xs` with implementation-specific status information.
   virtual void inspect_status(caf::settings& xs, system::status_verbosity v)
     = 0;
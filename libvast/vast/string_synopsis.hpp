@@ -0,0 +1,149 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/bloom_filter_parameters.hpp"
+#include "vast/bloom_filter_synopsis.hpp"
+#include "vast/fwd.hpp"
+#include "vast/set_synopsis.hpp"
+
+#include <caf/config_value.hpp>
+#include <caf/settings.hpp>
+
+#include <vast/defaults.hpp>
+#include <vast/detail/assert.hpp>
+#include <vast/error.hpp>
+#include <vast/logger.hpp>
+
+#include <string>
+
+namespace vast {
+
+template <class HashFunction>
+synopsis_ptr
+make_string_synopsis(vast::type type, bloom_filter_parameters params,
+                     std::vector<size_t> seeds = {});
+
+/// A synopsis for strings.
+template <class HashFunction>
+class string_synopsis final
+  : public bloom_filter_synopsis<std::string, HashFunction> {
+public:
+  using super = bloom_filter_synopsis<std::string, HashFunction>;
+
+  /// Constructs a string synopsis from a `string_type` and a Bloom filter.
+  string_synopsis(type x, typename super::bloom_filter_type bf)
+    : super{std::move(x), std::move(bf)} {
+    VAST_ASSERT(caf::holds_alternative<string_type>(this->type()));
+  }
+
+  bool equals(const synopsis& other) const noexcept override {
+    if (typeid(other) != typeid(string_synopsis))
+      return false;
+    auto& rhs = static_cast<const string_synopsis&>(other);
+    return this->type() == rhs.type()
+           && this->bloom_filter_ == rhs.bloom_filter_;
+  }
+};
+
+/// A synopsis for strings that buffers the input until it shrinks.
+template <class HashFunction>
+using buffered_string_synopsis
+  = buffered_synopsis<std::string, string_synopsis<HashFunction>>;
+
+/// Factory to construct a string synopsis.
+/// @tparam HashFunction The hash function to use for the Bloom filter.
+/// @param type A type instance carrying a `string_type`.
+/// @param params The Bloom filter parameters.
+/// @param seeds The seeds for the Bloom filter hasher.
+/// @returns A type-erased pointer to a synopsis.
+/// @pre `caf::holds_alternative<string_type>(type)`.
+/// @relates string_synopsis
+template <class HashFunction>
+synopsis_ptr
+make_string_synopsis(vast::type type, bloom_filter_parameters params,
+                     std::vector<size_t> seeds) {
+  VAST_ASSERT(caf::holds_alternative<string_type>(type));
+  auto x = make_bloom_filter<HashFunction>(std::move(params), std::move(seeds));
+  if (!x) {
+    VAST_WARNING_ANON(__func__, "failed to construct Bloom filter");
+    return nullptr;
+  }
+  using synopsis_type = string_synopsis<HashFunction>;
+  return std::make_unique<synopsis_type>(std::move(type), std::move(*x));
+}
+
+/// Factory to construct a buffered string synopsis.
+/// @tparam HashFunction The hash function to use for the Bloom filter.
+/// @param type A type instance carrying a `string_type`.
+/// @param params The Bloom filter parameters.
+/// @param max_set_size The maximum number of distinct strings for which
+///        shrinking produces an exact set instead of a Bloom filter.
+/// @returns A type-erased pointer to a synopsis.
+/// @pre `caf::holds_alternative<string_type>(type)`.
+/// @relates string_synopsis
+template <class HashFunction>
+synopsis_ptr make_buffered_string_synopsis(
+  vast::type type, bloom_filter_parameters params,
+  size_t max_set_size = defaults::system::max_set_synopsis_size) {
+  VAST_ASSERT(caf::holds_alternative<string_type>(type));
+  if (!params.p)
+    return nullptr;
+  using synopsis_type = buffered_string_synopsis<HashFunction>;
+  return std::make_unique<synopsis_type>(std::move(type), *params.p,
+                                         max_set_size);
+}
+
+/// Factory to construct a string synopsis. This overload looks for a type
+/// attribute containing the Bloom filter parameters and hash function seeds.
+/// Without such an attribute, the maximum partition size from the options
+/// bounds the number of distinct strings.
+/// @tparam HashFunction The hash function to use for the Bloom filter.
+/// @param type A type instance carrying a `string_type`.
+/// @param opts The synopsis options.
+/// @returns A type-erased pointer to a synopsis.
+/// @relates string_synopsis
+template <class HashFunction>
+synopsis_ptr make_string_synopsis(vast::type type, const caf::settings& opts) {
+  VAST_ASSERT(caf::holds_alternative<string_type>(type));
+  if (has_set_attribute(type))
+    return std::make_unique<set_synopsis<std::string>>(std::move(type));
+  if (auto xs = parse_parameters(type))
+    return make_string_synopsis<HashFunction>(std::move(type), std::move(*xs));
+  using int_type = caf::config_value::integer;
+  auto max_part_size = caf::get_if<int_type>(&opts, "max-partition-size");
+  if (!max_part_size) {
+    VAST_ERROR_ANON(__func__, "could not determine Bloom filter parameters");
+    return nullptr;
+  }
+  bloom_filter_parameters params;
+  params.n = *max_part_size;
+  params.p = defaults::system::string_synopsis_fprate;
+  auto annotated_type = detail::annotate_type(type, params);
+  // Active partitions buffer the strings so that they can shrink the Bloom
+  // filter to the actual number of distinct values before persisting.
+  auto buffered = caf::get_or(opts, "buffer-strings", false);
+  auto result
+    = buffered
+        ? make_buffered_string_synopsis<HashFunction>(std::move(type), params)
+        : make_string_synopsis<HashFunction>(std::move(annotated_type),
+                                             params);
+  if (!result)
+    VAST_ERROR_ANON(__func__,
+                    "failed to evaluate Bloom filter parameters:", params.n,
+                    params.p);
+  return result;
+}
+
+} // namespace vast
@@ -47,6 +47,11 @@ public:
   /// @pre `type_check(type(), x)`
   virtual void add(data_view x) = 0;
 
+  /// Records that the column contains nil values, which match negated
+  /// predicates. Synopses that rule out partitions for negated predicates
+  /// must take them into account; the default implementation ignores them.
+  virtual void add_nil();
+
   /// Tests whether a predicate matches. The synopsis is implicitly the LHS of
   /// the predicate.
   /// @param op The operator of the predicate.
@@ -61,7 +66,7 @@ public:
 
   /// Returns a new synopsis with the same data but consuming less memory,
   /// or `nullptr` if that is not possible.
-  /// This currently only makes sense for the `buffered_address_synopsis`.
+  /// This currently only makes sense for buffered synopses.
   virtual synopsis_ptr shrink() const;
 
   /// Tests whether two objects are equal.
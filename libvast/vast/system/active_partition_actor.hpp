@@ -27,9 +27,10 @@ using active_partition_actor = caf::typed_actor<
   // Hooks into the table slice stream.
   caf::replies_to<caf::stream<table_slice>>::with< //
     caf::inbound_stream_slot<table_slice>>,
-  // Persists the active partition at the specified path.
+  // Persists the active partition at the specified path and returns the size
+  // of the partition flatbuffer in bytes.
   caf::replies_to<atom::persist, path, index_actor>::with< //
-    atom::ok>,
+    uint64_t>,
   // A repeatedly called continuation of the persist request.
   caf::reacts_to<atom::persist, atom::resume>>
   // Conform to the protocol of the PARTITION.
@@ -16,7 +16,7 @@
 #include "vast/fwd.hpp"
 
 #include "vast/ids.hpp"
-#include "vast/store.hpp"
+#include "vast/segment_store.hpp"
 #include "vast/system/accountant_actor.hpp"
 #include "vast/system/archive_actor.hpp"
 #include "vast/system/instrumentation.hpp"
@@ -25,17 +25,74 @@
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace vast::system {
 
 /// @relates archive
 struct archive_state {
+  /// An extraction session that serves a single request of a requester.
+  struct session {
+    std::unique_ptr<vast::store::lookup> lookup;
+    uint64_t id;
+  };
+
+  /// A rewritten or merged segment that waits to replace the segments it
+  /// was written from.
+  struct segment_swap {
+    std::vector<uuid> sources;
+    std::vector<ids> applied;
+    uuid result;
+  };
+
   void send_report();
+
+  /// Starts sessions for waiting requesters until either all session slots
+  /// are in use or no requester has pending work.
   void next_session();
+
+  /// Ends the session of a requester and frees its session slot. If the
+  /// requester has more pending work, it rejoins the end of the queue.
+  void finish_session(const archive_client_actor& requester);
+
+  /// Rewrites the segments that erasures left mostly dead on separate
+  /// threads, such that the archive keeps serving requests meanwhile.
+  void rewrite_segments();
+
+  /// Merges the next run of segments on a separate thread, such that the
+  /// archive keeps serving requests meanwhile.
+  void merge_segments();
+
+  /// Replaces segments with the results of their rewrites and merges once no
+  /// session is running.
+  void swap_segments();
+
   archive_actor::pointer self;
-  std::unique_ptr<vast::store> store;
-  std::unique_ptr<vast::store::lookup> session;
+  segment_store_ptr store;
+
+  /// The active sessions by requester. Every requester has at most one active
+  /// session, and the archive interleaves the extraction of all active
+  /// sessions slice by slice.
+  std::unordered_map<caf::actor_addr, session> sessions;
+
+  /// Rewritten and merged segments that wait for the running sessions to
+  /// end. Sessions read the candidate segments they selected at their start,
+  /// so replacing a segment earlier makes them miss its remaining events.
+  std::vector<segment_swap> pending_swaps;
+
+  /// The runs of segments of the current compaction cycle that wait for
+  /// merging, including the one in progress.
+  std::vector<std::vector<segment>> merges;
+
+  /// The maximum number of concurrently active sessions.
+  size_t max_sessions = 1;
+
+  /// The maximum number of bytes to read per compaction cycle.
+  size_t compaction_budget = 0;
+
   uint64_t session_id = 0;
+
+  /// Requesters with pending work that wait for a session slot.
   std::queue<archive_client_actor> requesters;
   std::unordered_map<caf::actor_addr, std::queue<ids>> unhandled_ids;
   std::unordered_set<caf::actor_addr> active_exporters;
@@ -47,11 +104,17 @@ struct archive_state {
 /// Stores event batches and answers queries for ID sets.
 /// @param self The actor handle.
 /// @param dir The root directory of the archive.
-/// @param capacity The number of segments to cache in memory.
+/// @param capacity The maximum size of the cached segments in bytes.
 /// @param max_segment_size The maximum segment size in bytes.
-/// @pre `max_segment_size > 0`
+/// @param max_sessions The maximum number of concurrent extraction sessions.
+/// @param read_ahead The number of candidate segments to prefetch per
+///        extraction session.
+/// @param compaction_budget The maximum number of bytes to read per compaction
+///        cycle, or 0 to disable compaction.
+/// @pre `max_segment_size > 0 && max_sessions > 0`
 archive_actor::behavior_type
 archive(archive_actor::stateful_pointer<archive_state> self, path dir,
-        size_t capacity, size_t max_segment_size);
+        size_t capacity, size_t max_segment_size, size_t max_sessions,
+        size_t read_ahead, size_t compaction_budget);
 
 } // namespace vast::system
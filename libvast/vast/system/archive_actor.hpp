@@ -43,6 +43,8 @@ using archive_actor = caf::typed_actor<
   caf::reacts_to<ids, archive_client_actor, uint64_t>,
   // The internal telemetry loop of the ARCHIVE.
   caf::reacts_to<atom::telemetry>,
+  // The internal compaction loop of the ARCHIVE.
+  caf::reacts_to<atom::compact>,
   // Erase the events with the given ids.
   caf::replies_to<atom::erase, ids>::with< //
     atom::done>>
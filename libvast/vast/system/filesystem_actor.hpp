@@ -19,6 +19,8 @@
 
 #include <caf/typed_event_based_actor.hpp>
 
+#include <cstdint>
+
 namespace vast::system {
 
 /// The interface for file system I/O. The filesystem actor implementation must
@@ -29,9 +31,17 @@ using filesystem_actor = caf::typed_actor<
   // if needed.
   caf::replies_to<atom::write, path, chunk_ptr>::with< //
     atom::ok>,
+  // Appends a chunk of data to the file at a given path. Creates the file and
+  // intermediate directories if needed.
+  caf::replies_to<atom::append, path, chunk_ptr>::with< //
+    atom::ok>,
   // Reads a chunk of data from a given path and returns the chunk.
   caf::replies_to<atom::read, path>::with< //
     chunk_ptr>,
+  // Reads the given number of bytes starting at the given offset from a
+  // given path and returns the chunk, which is shorter if the file ends early.
+  caf::replies_to<atom::read, path, uint64_t, uint64_t>::with< //
+    chunk_ptr>,
   // Memory-maps a file.
   caf::replies_to<atom::mmap, path>::with< //
     chunk_ptr>>
@@ -15,6 +15,8 @@
 
 #include "vast/fwd.hpp"
 
+#include "vast/time.hpp"
+
 #include <caf/meta/type_name.hpp>
 
 #include <cstdint>
@@ -28,11 +30,17 @@ struct filesystem_statistics {
     uint64_t failed = 0;
     uint64_t bytes = 0;
 
+    /// The accumulated time from issuing an operation until its completion.
+    duration latency = duration::zero();
+
+    /// The longest time from issuing an operation until its completion.
+    duration max_latency = duration::zero();
+
     template <class Inspector>
     friend auto inspect(Inspector& f, ops& x) ->
       typename Inspector::result_type {
       return f(caf::meta::type_name("vast.system.filesystem_statistics.ops"),
-               x.successful, x.failed, x.bytes);
+               x.successful, x.failed, x.bytes, x.latency, x.max_latency);
     }
   };
 
@@ -15,26 +15,36 @@
 
 #include "vast/fwd.hpp"
 
+#include "vast/chunk.hpp"
 #include "vast/detail/lru_cache.hpp"
 #include "vast/detail/stable_map.hpp"
 #include "vast/expression.hpp"
 #include "vast/fbs/index.hpp"
+#include "vast/ids.hpp"
 #include "vast/meta_index.hpp"
 #include "vast/system/accountant.hpp"
+#include "vast/system/archive_actor.hpp"
 #include "vast/system/filesystem_actor.hpp"
 #include "vast/system/flush_listener_actor.hpp"
 #include "vast/system/index_actor.hpp"
+#include "vast/system/meta_index_actor.hpp"
 #include "vast/system/partition.hpp"
+#include "vast/system/partition_file.hpp"
 #include "vast/system/query_supervisor.hpp"
+#include "vast/time.hpp"
 #include "vast/uuid.hpp"
 
 #include <caf/actor.hpp>
 #include <caf/behavior.hpp>
+#include <caf/broadcast_downstream_manager.hpp>
 #include <caf/fwd.hpp>
 #include <caf/meta/omittable_if_empty.hpp>
 #include <caf/meta/type_name.hpp>
 #include <caf/response_promise.hpp>
 
+#include <functional>
+#include <memory>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -54,13 +64,74 @@ struct active_partition_info {
   /// The UUID of the partition.
   uuid id;
 
+  /// The end of the time window of the partition, if the index rolls over
+  /// partitions at fixed time windows.
+  vast::time window_end;
+
+  /// The IDs of the events in the partition.
+  vast::ids ids;
+
+  /// The sequence number of the last table slice the partition received.
+  uint64_t last_write;
+
+  /// Whether the partition received no events since the last idle check.
+  bool idle;
+
   template <class Inspector>
   friend auto inspect(Inspector& f, active_partition_info& x) {
     return f(caf::meta::type_name("active_partition_info"), x.actor,
-             x.stream_slot, x.capacity, x.id);
+             x.stream_slot, x.capacity, x.id, x.window_end, x.ids,
+             x.last_write, x.idle);
   }
 };
 
+/// A persisted partition with few events, which the index may merge with
+/// other such partitions of the same layout.
+struct undersized_partition_info {
+  /// The layout of the events in the partition.
+  std::string layout;
+
+  /// The IDs of the events in the partition.
+  vast::ids ids;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, undersized_partition_info& x) {
+    return f(caf::meta::type_name("undersized_partition_info"), x.layout,
+             x.ids);
+  }
+};
+
+/// The state of a running merge of undersized partitions.
+struct compaction_state {
+  /// The UUID of the merged partition.
+  uuid id;
+
+  /// The layout of the events in the merged partition.
+  std::string layout;
+
+  /// The partitions that the merged partition replaces.
+  std::vector<uuid> sources;
+
+  /// The IDs of the events in the replaced partitions.
+  vast::ids ids;
+
+  /// The synopsis of the merged partition, which the index holds back until
+  /// the merged partition replaces its sources.
+  std::unique_ptr<partition_synopsis> synopsis;
+
+  /// The number of events in the merged partition.
+  uint64_t events = 0;
+
+  /// Whether the merged partition is on disk.
+  bool persisted = false;
+};
+
+/// Routes table slices to the active partition for their layout in the CAF
+/// stream stage.
+struct index_selector {
+  bool operator()(const std::string& filter, const table_slice& x) const;
+};
+
 /// Accumulates statistics for a given layout.
 struct layout_statistics {
   uint64_t count; ///< Number of events indexed.
@@ -82,6 +153,40 @@ struct index_statistics {
   }
 };
 
+/// A change to the persistent state of the index. The index appends an entry
+/// to its journal whenever a partition is persisted or erased, such that it
+/// only needs to write its full state at checkpoints.
+struct index_journal_entry {
+  /// The generation of the journal that contains the entry.
+  uint64_t generation = 0;
+
+  /// The partition that was persisted or erased.
+  uuid partition;
+
+  /// Whether the partition was erased rather than persisted.
+  bool erased = false;
+
+  /// The index statistics after the change.
+  index_statistics stats;
+
+  /// The partitions that the persisted partition replaces.
+  std::vector<uuid> replaced;
+
+  template <class Inspector>
+  friend auto inspect(Inspector& f, index_journal_entry& x) {
+    return f(caf::meta::type_name("index_journal_entry"), x.generation,
+             x.partition, x.erased, x.stats, x.replaced);
+  }
+};
+
+/// @relates index_journal_entry
+caf::expected<flatbuffers::Offset<fbs::index_journal_entry::v0>>
+pack(flatbuffers::FlatBufferBuilder& builder, const index_journal_entry& x);
+
+/// @relates index_journal_entry
+caf::error unpack(const fbs::index_journal_entry::v0& x,
+                  index_journal_entry& y);
+
 /// Loads partitions from disk by UUID.
 class partition_factory {
 public:
@@ -93,6 +198,18 @@ public:
 
 private:
   filesystem_actor filesystem_;
+  index_state& state_;
+};
+
+/// Weighs loaded partitions by the size of their partition flatbuffer in bytes,
+/// which the INDEX learns when it persists a partition or reads its synopsis.
+class partition_weigher {
+public:
+  explicit partition_weigher(const index_state& state);
+
+  size_t operator()(const uuid& id, const partition_actor& partition) const;
+
+private:
   const index_state& state_;
 };
 
@@ -120,9 +237,12 @@ struct query_state {
 struct index_state {
   // -- type aliases -----------------------------------------------------------
 
+  using index_downstream_manager
+    = caf::broadcast_downstream_manager<table_slice, std::string,
+                                        index_selector>;
+
   using index_stream_stage_ptr
-    = caf::stream_stage_ptr<table_slice,
-                            caf::broadcast_downstream_manager<table_slice>>;
+    = caf::stream_stage_ptr<table_slice, index_downstream_manager>;
 
   // -- constructor ------------------------------------------------------------
 
@@ -130,18 +250,91 @@ struct index_state {
 
   // -- persistence ------------------------------------------------------------
 
+  /// Restores the state from the last checkpoint and replays the journal
+  /// entries that were appended after it.
   caf::error load_from_disk();
 
+  /// Reads the synopses of all persisted partitions into the meta index in
+  /// the background. Until its synopsis arrives, a partition is a candidate
+  /// for every query.
+  /// @param num_loaders The number of threads that read synopses.
+  void load_synopses(size_t num_loaders);
+
+  /// Hands the next partition whose synopsis is still on disk to `loader`.
+  void load_next_synopsis(caf::actor loader);
+
   /// @returns various status metrics.
   caf::dictionary<caf::config_value> status(status_verbosity v) const;
 
+  /// Writes a checkpoint of the current state and truncates the journal.
   void flush_to_disk();
 
+  /// Appends an entry for a persisted or erased partition to the journal, and
+  /// writes a checkpoint every `defaults::system::index_checkpoint_interval`
+  /// entries.
+  /// @param partition The UUID of the partition.
+  /// @param erased Whether the partition was erased rather than persisted.
+  /// @param replaced The partitions that the persisted partition replaces.
+  void append_to_journal(const uuid& partition, bool erased,
+                         std::vector<uuid> replaced = {});
+
+  /// Issues the next write of the journal or the checkpoint unless another one
+  /// is still in flight, such that they reach the disk in order.
+  void flush_journal();
+
+  /// Removes the file of a partition, or defers the removal until no loaded
+  /// partition refers to it anymore.
+  /// @param partition The UUID of the partition.
+  void unlink_partition(const uuid& partition);
+
+  // -- compaction -------------------------------------------------------------
+
+  /// Merges undersized partitions of the same layout into a new partition by
+  /// reading their events from the archive, unless a merge is still running.
+  void compact();
+
+  /// Replaces the sources of a persisted merge with the merged partition,
+  /// unless pending queries still refer to them.
+  void finish_compaction();
+
   path index_filename(path basename = {}) const;
 
+  path journal_filename(path basename = {}) const;
+
   // Maps partitions to their expected location on the file system.
   vast::path partition_path(const uuid& id) const;
 
+  // -- partition handling -----------------------------------------------------
+
+  /// Looks up an active partition by its UUID.
+  /// @returns A pointer to the active partition or `nullptr` if no active
+  ///          partition has the UUID `id`.
+  const active_partition_info* find_active_partition(const uuid& id) const;
+
+  // -- meta index -------------------------------------------------------------
+
+  /// @returns The META INDEX shard that holds the synopses of `partition`.
+  const meta_index_actor& meta_index_shard_for(const uuid& partition) const;
+
+  /// Adds a partition whose synopses are not available yet to the meta index.
+  void add_pending_synopsis(const uuid& partition, std::string layout);
+
+  /// Adds or replaces the synopses of a partition in the meta index.
+  void merge_synopsis(const uuid& partition,
+                      std::shared_ptr<partition_synopsis> synopsis);
+
+  /// Removes a partition from the meta index.
+  void erase_synopsis(const uuid& partition);
+
+  /// Looks up the candidate partitions for an expression in all META INDEX
+  /// shards in parallel. Partitions do not get swapped or erased while
+  /// lookups are in flight, such that all candidates remain valid.
+  /// @param expr The expression to look up.
+  /// @param f The function that receives the sorted candidates.
+  void lookup_candidates(
+    const expression& expr,
+    std::function<void(caf::expected<std::vector<uuid>>)> f);
+
   // -- query handling ---------------------------------------------------------
 
   bool worker_available();
@@ -174,8 +367,21 @@ struct index_state {
   /// The streaming stage.
   index_stream_stage_ptr stage;
 
-  /// The single active (read/write) partition.
-  active_partition_info active_partition = {};
+  /// The active (read/write) partitions by layout name. Every layout has a
+  /// partition of its own, such that ingesting multiple layouts scales across
+  /// partition actors and the meta index can prune partitions by type.
+  std::unordered_map<std::string, active_partition_info> active_partitions;
+
+  /// The maximum number of active partitions with an actor.
+  size_t max_active_partitions;
+
+  /// The duration without new events after which an active partition
+  /// persists, or 0 to keep idle partitions active.
+  duration active_partition_timeout;
+
+  /// The number of table slices the index received, which orders the active
+  /// partitions by their last write.
+  uint64_t slice_sequence = 0;
 
   /// Partitions that are currently in the process of persisting.
   // TODO: An alternative to keeping an explicit set of unpersisted partitions
@@ -187,30 +393,63 @@ struct index_state {
 
   /// The set of passive (read-only) partitions currently loaded into memory.
   /// Uses the `partition_factory` to load new partitions as needed, and evicts
-  /// old entries when the size exceeds `max_inmem_partitions`.
-  detail::lru_cache<uuid, partition_actor, partition_factory> inmem_partitions;
+  /// entries when their total size in bytes exceeds the maximum size. The
+  /// scan-resistant policy protects frequently queried partitions from being
+  /// evicted by queries that sweep over many partitions once.
+  detail::lru_cache<uuid, partition_actor, partition_factory, partition_weigher,
+                    detail::two_queue>
+    inmem_partitions;
 
   /// The set of partitions that exist on disk.
   std::unordered_set<uuid> persisted_partitions;
 
+  /// The sizes of the partition flatbuffers of persisted partitions, which
+  /// passive partitions keep in memory.
+  std::unordered_map<uuid, size_t> partition_sizes;
+
   /// The maximum number of events that a partition can hold.
   size_t partition_capacity;
 
-  // The maximum size of the partition LRU cache (or the maximum number of
-  // read-only partition loaded to memory).
-  size_t max_inmem_partitions;
-
   // The number of partitions initially returned for a query.
   size_t taste_partitions;
 
+  /// The number of INDEXING WORKERS per active partition, or 0 for one
+  /// ACTIVE INDEXER per field.
+  size_t indexing_workers;
+
+  /// The length of the wall-clock time windows that active partitions roll
+  /// over at, or 0 to disable windows.
+  duration partition_window;
+
+  /// Whether the index answers queries while it still loads the synopses of
+  /// persisted partitions.
+  bool lazy_synopses;
+
+  /// Persisted partitions whose synopses no loader has read yet.
+  std::vector<uuid> synopsis_queue;
+
+  /// The number of persisted partitions whose synopses did not arrive yet.
+  size_t pending_synopses = 0;
+
   /// Maps query IDs to pending lookup state.
   std::unordered_map<uuid, query_state> pending;
 
+  /// The number of candidate lookups in the META INDEX shards that did not
+  /// complete yet.
+  size_t candidate_lookups = 0;
+
   /// Caches idle workers.
   std::vector<query_supervisor_actor> idle_workers;
 
-  /// The meta index.
-  meta_index meta_idx;
+  /// The shards of the meta index, each of which holds the synopses of the
+  /// partitions whose UUIDs hash to it.
+  std::vector<meta_index_actor> meta_index_shards;
+
+  /// The memory usage of the synopses in the meta index by partition.
+  std::unordered_map<uuid, size_t> synopsis_sizes;
+
+  /// Options for the synopses that active partitions build.
+  caf::settings synopsis_options;
 
   /// The directory for persistent state.
   path dir;
@@ -218,6 +457,43 @@ struct index_state {
   /// Statistics about processed data.
   index_statistics stats;
 
+  /// The generation of the journal, which increases with every checkpoint.
+  uint64_t journal_generation = 0;
+
+  /// The number of journal entries since the last checkpoint.
+  size_t journal_entries = 0;
+
+  /// Serialized journal entries that wait for the journal write in flight.
+  std::vector<char> journal_buffer;
+
+  /// The checkpoint that waits for the journal write in flight, if any.
+  chunk_ptr checkpoint;
+
+  /// Whether a write of the journal or the checkpoint is in flight.
+  bool journal_in_flight = false;
+
+  /// Partitions whose files become obsolete once the pending journal entries
+  /// are on disk.
+  std::vector<uuid> obsolete_partitions;
+
+  /// The files of loaded partitions, which keep them on disk while passive
+  /// partitions or their indexers may still read from them.
+  std::unordered_map<uuid, std::weak_ptr<partition_file>> partition_files;
+
+  /// Persisted partitions that hold at most half of the partition capacity.
+  std::unordered_map<uuid, undersized_partition_info> undersized_partitions;
+
+  /// The running merge of undersized partitions, if any.
+  std::optional<compaction_state> compaction;
+
+  /// The maximum number of events to merge per compaction cycle, or 0 to
+  /// disable periodic compaction.
+  size_t compaction_budget;
+
+  /// Actor handle of the archive, which holds the events that the index reads
+  /// to merge partitions.
+  archive_actor archive;
+
   // Handle of the accountant.
   accountant_actor accountant;
 
@@ -242,10 +518,33 @@ pack(flatbuffers::FlatBufferBuilder& builder, const index_state& x);
 /// forwarded to partitions.
 /// @param dir The directory of the index.
 /// @param partition_capacity The maximum number of events per partition.
+/// @param partition_cache_size The maximum size of the loaded partitions in
+///        bytes.
+/// @param indexing_workers The number of INDEXING WORKERS per active
+///        partition, or 0 to spawn one ACTIVE INDEXER per field.
+/// @param partition_window The length of the wall-clock time windows that
+///        active partitions roll over at, or 0 to roll over only when they
+///        reach their capacity.
+/// @param max_active_partitions The maximum number of active partitions. At
+///        the limit, a new layout replaces the least recently written one.
+/// @param active_partition_timeout The duration without new events after
+///        which an active partition persists, or 0 to keep it active.
+/// @param compaction_budget The maximum number of events to merge per
+///        compaction cycle, or 0 to disable periodic compaction.
+/// @param synopsis_loaders The number of threads that read the synopses of
+///        persisted partitions at startup.
+/// @param lazy_synopses Whether to answer queries before all synopses of
+///        persisted partitions are loaded.
+/// @param meta_index_shards The number of META INDEX shards that look up
+///        candidate partitions in parallel.
 /// @pre `partition_capacity > 0
 index_actor::behavior_type
 index(index_actor::stateful_pointer<index_state> self,
       filesystem_actor filesystem, path dir, size_t partition_capacity,
-      size_t in_mem_partitions, size_t taste_partitions, size_t num_workers);
+      size_t partition_cache_size, size_t taste_partitions,
+      size_t num_workers, size_t indexing_workers, duration partition_window,
+      size_t max_active_partitions, duration active_partition_timeout,
+      size_t compaction_budget, size_t synopsis_loaders, bool lazy_synopses,
+      size_t meta_index_shards);
 
 } // namespace vast::system
@@ -17,6 +17,7 @@
 
 #include "vast/meta_index.hpp"
 #include "vast/system/accountant.hpp"
+#include "vast/system/archive_actor.hpp"
 #include "vast/system/query_supervisor_master_actor.hpp"
 #include "vast/system/status_client_actor.hpp"
 
@@ -35,13 +36,21 @@ using index_actor = caf::typed_actor<
     caf::inbound_stream_slot<table_slice>>,
   // Registers the ARCHIVE with the ACCOUNTANT.
   caf::reacts_to<accountant_actor>,
+  // Registers the ARCHIVE that holds the events of the INDEX.
+  caf::reacts_to<archive_actor>,
+  // Persists the active partition of a layout at the end of its time window.
+  caf::reacts_to<atom::persist, std::string, uuid>,
+  // Persists the active partition of a layout if it stayed idle.
+  caf::reacts_to<atom::wakeup, std::string, uuid>,
+  // Merges undersized partitions.
+  caf::reacts_to<atom::compact>,
   // Subscribes a FLUSH LISTENER to the INDEX.
   caf::reacts_to<atom::subscribe, atom::flush, wrapped_flush_listener>,
   // Evaluatates an expression.
   caf::reacts_to<expression>,
   // Queries PARTITION actors for a given query id.
   caf::reacts_to<uuid, uint32_t>,
-  // Replaces the SYNOPSIS of the PARTITION witht he given partition id.
+  // Replaces the SYNOPSIS of the PARTITION with the given partition id.
   caf::reacts_to<atom::replace, uuid, std::shared_ptr<partition_synopsis>>,
   // Erases the given events from the INDEX, and returns their ids.
   caf::replies_to<atom::erase, uuid>::with<ids>>
@@ -17,15 +17,22 @@
 
 #include "vast/fbs/partition.hpp"
 #include "vast/path.hpp"
+#include "vast/qualified_record_field.hpp"
 #include "vast/system/accountant_actor.hpp"
 #include "vast/system/active_indexer_actor.hpp"
 #include "vast/system/filesystem_actor.hpp"
 #include "vast/system/indexer_actor.hpp"
+#include "vast/system/indexing_worker_actor.hpp"
 #include "vast/system/instrumentation.hpp"
+#include "vast/system/partition_file.hpp"
 #include "vast/type.hpp"
 #include "vast/uuid.hpp"
 
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace vast::system {
 
@@ -52,15 +59,73 @@ struct indexer_state {
   caf::typed_response_promise<chunk_ptr> promise;
 };
 
+/// The state of an INDEXING WORKER.
+struct indexing_worker_state {
+  /// A value index for a single field.
+  struct entry {
+    /// The index holding the data.
+    value_index_ptr idx;
+
+    /// Whether the type of the field has the `#skip` attribute, implying that
+    /// the incoming data should not be indexed.
+    bool has_skip_attribute;
+  };
+
+  /// The value indexes of this worker.
+  std::unordered_map<qualified_record_field, entry> entries;
+
+  /// Settings that are forwarded when creating value indexes.
+  caf::settings index_opts;
+
+  /// The partition id to which this worker belongs (for log messages).
+  uuid partition_id;
+
+  /// Tracks whether we received at least one table slice column.
+  bool stream_initiated = false;
+
+  /// The response promises for snapshot atoms that arrived while the stream
+  /// was still open.
+  std::vector<
+    std::pair<qualified_record_field, caf::typed_response_promise<chunk_ptr>>>
+    promises;
+
+  static inline const char* name = "indexing-worker";
+};
+
 /// Indexes a table slice column with a single value index.
 active_indexer_actor::behavior_type
 active_indexer(active_indexer_actor::stateful_pointer<indexer_state> self,
                type index_type, caf::settings index_opts);
 
+/// Indexes the table slice columns it receives with one value index per
+/// field, such that a small pool of workers can index all fields of a
+/// partition.
+/// @param self The worker actor.
+/// @param partition_id The UUID of the partition the worker belongs to.
+/// @param index_opts Settings that are forwarded when creating value indexes.
+indexing_worker_actor::behavior_type
+indexing_worker(indexing_worker_actor::stateful_pointer<indexing_worker_state>
+                  self,
+                uuid partition_id, caf::settings index_opts);
+
 /// An indexer that was recovered from on-disk state. It can only respond
 /// to queries, but not add eny more entries.
 indexer_actor::behavior_type
 passive_indexer(indexer_actor::stateful_pointer<indexer_state> self,
                 uuid partition_id, value_index_ptr idx);
 
+/// A passive indexer that reads its value index from a partition file before
+/// responding to queries.
+/// @param self The indexer actor.
+/// @param partition_id The UUID of the partition the indexer belongs to.
+/// @param filesystem The actor handle of the filesystem actor.
+/// @param file The partition file, which the indexer keeps until it read its
+///        value index.
+/// @param offset The position of the value index in the partition file.
+/// @param size The size of the value index in bytes.
+indexer_actor::behavior_type
+lazy_passive_indexer(indexer_actor::stateful_pointer<indexer_state> self,
+                     uuid partition_id, filesystem_actor filesystem,
+                     partition_file_ptr file, uint64_t offset, uint64_t size);
+
 } // namespace vast::system
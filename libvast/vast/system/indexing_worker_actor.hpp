@@ -0,0 +1,34 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/fwd.hpp"
+
+#include <caf/typed_event_based_actor.hpp>
+
+namespace vast::system {
+
+/// The INDEXING WORKER actor interface. An INDEXING WORKER maintains the value
+/// indexes for a subset of the fields of an ACTIVE PARTITION.
+using indexing_worker_actor = caf::typed_actor<
+  // Hooks into the table slice column stream.
+  caf::replies_to<caf::stream<table_slice_column>>::with<
+    caf::inbound_stream_slot<table_slice_column>>,
+  // Returns the ids for the given predicate on a field.
+  caf::replies_to<curried_predicate, qualified_record_field>::with<ids>,
+  // Finalizes the value index of a field into a chunk, which contains an
+  // INDEXER.
+  caf::replies_to<atom::snapshot, qualified_record_field>::with<chunk_ptr>>;
+
+} // namespace vast::system
@@ -0,0 +1,40 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/fwd.hpp"
+
+#include "vast/meta_index.hpp"
+
+#include <caf/typed_actor.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vast::system {
+
+/// The META INDEX actor interface.
+using meta_index_actor = caf::typed_actor<
+  // Adds a partition whose synopses are not available yet.
+  caf::reacts_to<atom::add, uuid, std::string>,
+  // Adds or replaces the synopses of a partition.
+  caf::reacts_to<atom::replace, uuid, std::shared_ptr<partition_synopsis>>,
+  // Removes a partition.
+  caf::reacts_to<atom::erase, uuid>,
+  // Looks up the candidate partitions for an expression.
+  caf::replies_to<expression>::with< //
+    std::vector<uuid>>>;
+
+} // namespace vast::system
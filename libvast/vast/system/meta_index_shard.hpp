@@ -0,0 +1,36 @@
+/******************************************************************************
+ *                    _   _____   __________                                  *
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/fwd.hpp"
+
+#include "vast/meta_index.hpp"
+#include "vast/system/meta_index_actor.hpp"
+
+namespace vast::system {
+
+struct meta_index_shard_state {
+  /// The synopses of the partitions that belong to this shard.
+  meta_index meta_idx;
+
+  static inline const char* name = "meta-index-shard";
+};
+
+/// Holds the synopses of a subset of all partitions, such that the INDEX can
+/// look up candidate partitions on several threads at once.
+/// @param self The actor handle.
+meta_index_actor::behavior_type meta_index_shard(
+  meta_index_actor::stateful_pointer<meta_index_shard_state> self);
+
+} // namespace vast::system
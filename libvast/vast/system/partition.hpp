@@ -22,12 +22,15 @@
 #include "vast/meta_index.hpp"
 #include "vast/path.hpp"
 #include "vast/qualified_record_field.hpp"
+#include "vast/span.hpp"
 #include "vast/system/active_partition_actor.hpp"
 #include "vast/system/evaluator.hpp"
 #include "vast/system/filesystem_actor.hpp"
 #include "vast/system/index_actor.hpp"
 #include "vast/system/indexer.hpp"
+#include "vast/system/indexing_worker_actor.hpp"
 #include "vast/system/instrumentation.hpp"
+#include "vast/system/partition_file.hpp"
 #include "vast/system/partition_actor.hpp"
 #include "vast/table_slice_column.hpp"
 #include "vast/type.hpp"
@@ -42,10 +45,25 @@
 
 namespace vast::system {
 
+/// Describes which table slice columns an indexer receives in the CAF stream
+/// stage of a partition. An ACTIVE INDEXER receives the columns of a single
+/// field, and an INDEXING WORKER all columns whose field name hashes onto it.
+struct indexer_filter {
+  /// The field of an ACTIVE INDEXER.
+  qualified_record_field field;
+
+  /// The position of an INDEXING WORKER in the pool of its partition.
+  size_t worker = 0;
+
+  /// The number of INDEXING WORKERS of the partition, or 0 for an ACTIVE
+  /// INDEXER.
+  size_t workers = 0;
+};
+
 /// Helper class used to route table slice columns to the correct indexer
 /// in the CAF stream stage.
 struct partition_selector {
-  bool operator()(const qualified_record_field& filter,
+  bool operator()(const indexer_filter& filter,
                   const table_slice_column& x) const;
 };
 
@@ -55,12 +73,12 @@ struct active_partition_state {
 
   using partition_stream_stage_ptr = caf::stream_stage_ptr<
     table_slice,
-    caf::broadcast_downstream_manager<
-      table_slice_column, vast::qualified_record_field, partition_selector>>;
+    caf::broadcast_downstream_manager<table_slice_column, indexer_filter,
+                                      partition_selector>>;
 
   // -- utility functions ------------------------------------------------------
 
-  active_indexer_actor indexer_at(size_t position) const;
+  indexer_actor indexer_at(size_t position) const;
 
   // -- data members -----------------------------------------------------------
 
@@ -79,18 +97,25 @@ struct active_partition_state {
   /// The combined type of all columns of this partition
   record_type combined_layout;
 
-  /// Maps qualified fields to indexer actors.
+  /// Maps qualified fields to indexer actors. The indexer handles are null if
+  /// the partition uses a pool of INDEXING WORKERS instead.
   //  TODO: Should we use the tsl map here for heterogenous key lookup?
   detail::stable_map<qualified_record_field, active_indexer_actor> indexers;
 
+  /// The pool of INDEXING WORKERS that index all fields of this partition.
+  /// Empty if every field has its own ACTIVE INDEXER.
+  std::vector<indexing_worker_actor> workers;
+
+  /// Maps qualified fields to the position of their INDEXING WORKER.
+  std::unordered_map<qualified_record_field, size_t> worker_positions;
+
   /// Maps type names to IDs. Used the answer #type queries.
   std::unordered_map<std::string, ids> type_ids;
 
-  /// Partition synopsis for this partition. This is built up in parallel
-  /// to the one in the index, so it can be shrinked and serialized into
-  /// a `Partition` flatbuffer upon completion of this partition. Will be
-  /// sent back to the partition after persisting to minimize memory footprint
-  /// of the meta index.
+  /// Partition synopsis for this partition. This is the only place where the
+  /// synopsis gets built. Upon completion of this partition, it is shrinked
+  /// and serialized into a `Partition` flatbuffer, and then handed over to
+  /// the meta index of the INDEX.
   /// Semantically this should be a unique_ptr, but caf requires message
   /// types to be copy-constructible.
   std::shared_ptr<partition_synopsis> synopsis;
@@ -113,9 +138,9 @@ struct active_partition_state {
   /// Actor handle of the filesystem actor.
   filesystem_actor filesystem;
 
-  /// Promise that gets satisfied when the partition state was serialized
-  /// and written to disk.
-  caf::typed_response_promise<atom::ok> persistence_promise;
+  /// Promise that gets satisfied with the size of the partition flatbuffer
+  /// when the partition state was serialized and written to disk.
+  caf::typed_response_promise<uint64_t> persistence_promise;
 
   /// Path where the index state is written.
   std::optional<path> persist_path;
@@ -126,7 +151,7 @@ struct active_partition_state {
 
   /// Temporary storage for the serialized indexers of this partition, before
   /// they get written into the flatbuffer.
-  std::map<caf::actor_id, vast::chunk_ptr> chunks;
+  std::map<qualified_record_field, vast::chunk_ptr> chunks;
 
   /// A once_flag for things that need to be done only once at shutdown.
   std::once_flag shutdown_once;
@@ -172,6 +197,16 @@ struct passive_partition_state {
   /// The raw memory of the partition, used to spawn indexers on demand.
   chunk_ptr partition_chunk;
 
+  /// Actor handle of the filesystem actor, used to read value indexes on
+  /// demand.
+  filesystem_actor filesystem;
+
+  /// The partition file.
+  partition_file_ptr file;
+
+  /// The position of the first value index in the partition file.
+  size_t data_offset = 0;
+
   /// Stores a list of expressions that could not be answered immediately.
   std::vector<std::pair<
     expression, caf::typed_response_promise<std::vector<evaluation_triple>>>>
@@ -194,6 +229,39 @@ caf::error unpack(const fbs::partition::v0& x, passive_partition_state& y);
 
 caf::error unpack(const fbs::partition::v0& x, partition_synopsis& y);
 
+// -- partition files ----------------------------------------------------------
+
+/// The number of bytes at the beginning of a partition file that determine its
+/// layout.
+constexpr size_t partition_header_size = 12;
+
+/// Creates the beginning of a partition file, i.e., the partition flatbuffer
+/// padded such that the value indexes at the locations it records can follow
+/// directly.
+/// @param x The state of an active partition with all indexer chunks.
+/// @returns The padded partition flatbuffer.
+caf::expected<chunk_ptr>
+make_partition_flatbuffer(const active_partition_state& x);
+
+/// Determines the size of the partition flatbuffer at the beginning of a
+/// partition file.
+/// @param header At least the first `partition_header_size` bytes of a
+///        partition file.
+/// @returns The size of the flatbuffer including its size prefix, or 0 for
+///          partition files of older versions that consist of a single
+///          flatbuffer without size prefix.
+caf::expected<size_t> partition_flatbuffer_size(span<const byte> header);
+
+/// Gets the partition flatbuffer at the beginning of a partition file.
+/// @param xs The partition file, or at least its flatbuffer.
+/// @returns The partition flatbuffer or `nullptr` if *xs* does not contain one.
+const fbs::Partition* partition_flatbuffer(span<const byte> xs);
+
+/// Computes the position of the first value index in a partition file.
+/// @param flatbuffer_size The result of `partition_flatbuffer_size`.
+/// @returns The offset that value index locations are relative to.
+size_t partition_data_offset(size_t flatbuffer_size);
+
 // -- behavior -----------------------------------------------------------------
 
 /// Spawns a partition.
@@ -202,18 +270,20 @@ caf::error unpack(const fbs::partition::v0& x, partition_synopsis& y);
 /// @param filesystem The actor handle of the filesystem actor.
 /// @param index_opts Settings that are forwarded when creating indexers.
 /// @param synopsis_opts Settings that are forwarded when creating synopses.
+/// @param indexing_workers The number of INDEXING WORKERS that index all
+///        fields, or 0 to spawn an ACTIVE INDEXER per field.
 active_partition_actor::behavior_type active_partition(
   active_partition_actor::stateful_pointer<active_partition_state> self,
   uuid id, filesystem_actor filesystem, caf::settings index_opts,
-  caf::settings synopsis_opts);
+  caf::settings synopsis_opts, size_t indexing_workers);
 
 /// Spawns a read-only partition.
 /// @param self The partition actor.
 /// @param id The UUID of this partition.
 /// @param filesystem The actor handle of the filesystem actor.
-/// @param path The path where the partition flatbuffer can be found.
+/// @param file The file where the partition flatbuffer can be found.
 partition_actor::behavior_type passive_partition(
   partition_actor::stateful_pointer<passive_partition_state> self, uuid id,
-  filesystem_actor filesystem, vast::path path);
+  filesystem_actor filesystem, partition_file_ptr file);
 
 } // namespace vast::system
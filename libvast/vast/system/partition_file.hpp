@@ -0,0 +1,48 @@
+/******************************************************************************
+
+ *                   | | / / _ | / __/_  __/     Visibility                   *
+ *                   | |/ / __ |_\ \  / /          Across                     *
+ *                   |___/_/ |_/___/ /_/       Space and Time                 *
+ *                                                                            *
+ * This file is part of VAST. It is subject to the license terms in the       *
+ * LICENSE file found in the top-level directory of this distribution and at  *
+ * http://vast.io/license. No part of VAST, including this file, may be       *
+ * copied, modified, propagated, or distributed except according to the terms *
+ * contained in the LICENSE file.                                             *
+ ******************************************************************************/
+
+#pragma once
+
+#include "vast/path.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace vast::system {
+
+/// A shared handle to the file of a persisted partition. A loaded partition
+/// and its indexers hold the handle while they may still read value indexes
+/// from the file, such that erasing the partition can defer the removal of
+/// the file until they are gone.
+struct partition_file {
+  /// Constructs a handle.
+  /// @param path The path of the partition file.
+  explicit partition_file(vast::path path);
+
+  /// Removes the file if it became obsolete.
+  ~partition_file();
+
+  partition_file(const partition_file&) = delete;
+  partition_file& operator=(const partition_file&) = delete;
+
+  /// The path of the partition file.
+  const vast::path path;
+
+  /// Whether to remove the file once the last holder releases the handle.
+  std::atomic<bool> obsolete = false;
+};
+
+/// @relates partition_file
+using partition_file_ptr = std::shared_ptr<partition_file>;
+
+} // namespace vast::system
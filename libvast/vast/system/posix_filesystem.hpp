@@ -15,28 +15,70 @@
 
 #include "vast/fwd.hpp"
 
+#include "vast/defaults.hpp"
 #include "vast/path.hpp"
 #include "vast/system/filesystem_actor.hpp"
 #include "vast/system/filesystem_statistics.hpp"
+#include "vast/system/instrumentation.hpp"
+
+#include <vector>
 
 namespace vast::system {
 
 /// The state for the POSIX filesystem.
 /// @relates posix_filesystem
 struct posix_filesystem_state {
+  /// @returns the index of the worker with the fewest pending operations,
+  ///          for operations that only read.
+  size_t next_worker() const;
+
+  /// @returns the index of the worker that performs all writes to a file.
+  ///          Pinning writes to a worker keeps them in order and prevents
+  ///          concurrent writes to the same temporary file.
+  /// @param filename The file to write to.
+  size_t writer_for(const path& filename) const;
+
+  /// Accounts for a finished operation.
+  /// @param worker The index of the worker that performed the operation.
+  /// @param op The statistics for the kind of the operation.
+  /// @param start The time when the operation was issued.
+  /// @param bytes The number of bytes the operation transferred, or 0 if the
+  ///        operation failed.
+  void finish(size_t worker, filesystem_statistics::ops& op,
+              stopwatch::time_point start, uint64_t bytes);
+
   /// Statistics about filesystem operations.
   filesystem_statistics stats;
 
+  /// The workers that perform the blocking system calls, each in a thread of
+  /// its own.
+  std::vector<filesystem_actor> workers;
+
+  /// The number of pending operations per worker.
+  std::vector<size_t> pending;
+
   /// The actor name.
   static inline const char* name = "posix-filesystem";
 };
 
-/// A filesystem implemented with POSIX system calls.
+/// A filesystem implemented with POSIX system calls. The actor dispatches all
+/// operations to a pool of workers, such that slow operations do not block
+/// unrelated ones.
 /// @param self The actor handle.
 /// @param root The filesystem root. The actor prepends this path to all
 ///             operations that include a path parameter.
+/// @param num_workers The number of concurrent blocking operations.
 /// @returns The actor behavior.
+/// @pre `num_workers > 0`
 filesystem_actor::behavior_type posix_filesystem(
-  filesystem_actor::stateful_pointer<posix_filesystem_state> self, path root);
+  filesystem_actor::stateful_pointer<posix_filesystem_state> self, path root,
+  size_t num_workers = defaults::system::filesystem_workers);
+
+/// A worker of the POSIX filesystem that performs blocking system calls.
+/// @param self The actor handle.
+/// @param root The filesystem root.
+/// @returns The actor behavior.
+filesystem_actor::behavior_type
+posix_filesystem_worker(filesystem_actor::pointer self, path root);
 
 } // namespace vast::system
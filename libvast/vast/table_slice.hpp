@@ -85,6 +85,15 @@ public:
   table_slice(const fbs::FlatTableSlice& flat_slice,
               const chunk_ptr& parent_chunk, enum verify verify) noexcept;
 
+  /// Construct a table slice from a compressed table slice by decompressing
+  /// it into a new chunk.
+  /// @param compressed_slice The `vast.fbs.CompressedTableSlice` object.
+  /// @param verify Controls whether the table should be verified.
+  /// @note Constructs an invalid table slice if the decompression or the
+  /// verification of the FlatBuffers table fails.
+  table_slice(const fbs::CompressedTableSlice& compressed_slice,
+              enum verify verify) noexcept;
+
   /// Copy-construct a table slice.
   /// @param other The copied-from slice.
   table_slice(const table_slice& other) noexcept;
@@ -266,6 +275,15 @@ table_slice truncate(const table_slice& slice, size_t num_rows);
 std::pair<table_slice, table_slice>
 split(const table_slice& slice, size_t partition_point);
 
+/// Decompresses a table slice that was compressed as a single LZ4 block.
+/// @param compressed The LZ4-compressed bytes of a `vast.fbs.TableSlice`.
+/// @param uncompressed_size The size of the table slice before compression.
+/// @param verify Controls whether the table should be verified.
+/// @returns The decompressed table slice, or an invalid table slice if the
+///          decompression or the verification of the FlatBuffers table fails.
+table_slice decompress(span<const byte> compressed, size_t uncompressed_size,
+                       enum table_slice::verify verify) noexcept;
+
 /// Counts the number of total rows of multiple table slices.
 /// @param slices The table slices to count.
 /// @returns The sum of rows across *slices*.
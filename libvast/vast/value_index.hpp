@@ -15,6 +15,8 @@
 
 #include "vast/error.hpp"
 #include "vast/ewah_bitmap.hpp"
+#include "vast/fbs/value_index.hpp"
+#include "vast/fwd.hpp"
 #include "vast/ids.hpp"
 #include "vast/type.hpp"
 #include "vast/view.hpp"
@@ -110,4 +112,19 @@ caf::error inspect(caf::serializer& sink, const value_index_ptr& x);
 /// @relates value_index
 caf::error inspect(caf::deserializer& source, value_index_ptr& x);
 
+/// Packs a value index into a flatbuffer. The blocks of all EWAH bitmaps of
+/// the index are stored natively, such that `unpack` can use them in place.
+/// @relates value_index
+caf::expected<flatbuffers::Offset<fbs::value_index::v0>>
+pack(flatbuffers::FlatBufferBuilder& builder, const value_index_ptr& x);
+
+/// Unpacks a value index from a flatbuffer.
+/// @param x The packed value index.
+/// @param y The unpacked value index.
+/// @param owner The chunk that contains *x*. The bitmaps of *y* borrow their
+///        blocks from it instead of copying them.
+/// @relates value_index
+caf::error
+unpack(const fbs::value_index::v0& x, value_index_ptr& y, chunk_ptr owner);
+
 } // namespace vast
@@ -138,7 +138,9 @@ Kind classify(vast::path path) {
   auto buf = bytes->data();
   if (vast::fbs::IndexBufferHasIdentifier(buf))
     return Kind::Index;
-  if (vast::fbs::PartitionBufferHasIdentifier(buf))
+  if (vast::fbs::PartitionBufferHasIdentifier(buf)
+      || flatbuffers::BufferHasIdentifier(
+        buf, vast::fbs::PartitionIdentifier(), true))
     return Kind::Partition;
   if (vast::fbs::SegmentBufferHasIdentifier(buf))
     return Kind::Segment;
@@ -169,7 +171,7 @@ struct flatbuffer_deleter {
 // automatically upon destruction.
 template <typename T>
 std::unique_ptr<const T, flatbuffer_deleter<T>>
-read_flatbuffer_file(vast::path path) {
+read_flatbuffer_file(vast::path path, bool size_prefixed = false) {
   using result_t = std::unique_ptr<const T, flatbuffer_deleter<T>>;
   auto result
     = result_t(static_cast<const T*>(nullptr), flatbuffer_deleter<T>{});
@@ -177,7 +179,9 @@ read_flatbuffer_file(vast::path path) {
   if (!maybe_bytes)
     return result;
   auto bytes = std::move(*maybe_bytes);
-  const auto* ptr = flatbuffers::GetRoot<T>(bytes.data());
+  const auto* ptr = size_prefixed
+                      ? flatbuffers::GetSizePrefixedRoot<T>(bytes.data())
+                      : flatbuffers::GetRoot<T>(bytes.data());
   return result_t(ptr, flatbuffer_deleter<T>(std::move(bytes)));
 }
 
@@ -366,7 +370,8 @@ void print_partition_v0(const vast::fbs::partition::v0* partition,
       auto index = indexes->Get(i);
       auto name = field.name;
       // auto name = index->qualified_field_name();
-      auto sz = index->index()->data()->size();
+      auto sz = index->location() ? index->location()->size()
+                                  : index->index()->data()->size();
       std::cout << indent << name << ": " << vast::to_string(field.type);
       if (formatting.print_bytesizes)
         std::cout << " (" << print_bytesize(sz, formatting) << ")";
@@ -377,7 +382,15 @@ void print_partition_v0(const vast::fbs::partition::v0* partition,
 
 void print_partition(vast::path path, indentation& indent,
                      const formatting_options& formatting) {
-  auto partition = read_flatbuffer_file<vast::fbs::Partition>(path);
+  // Partition files of older versions lack the size prefix.
+  auto header = vast::io::read(path, 0, 3 * sizeof(flatbuffers::uoffset_t));
+  auto size_prefixed = header
+                       && header->size() == 3 * sizeof(flatbuffers::uoffset_t)
+                       && flatbuffers::BufferHasIdentifier(
+                         header->data(), vast::fbs::PartitionIdentifier(),
+                         true);
+  auto partition
+    = read_flatbuffer_file<vast::fbs::Partition>(path, size_prefixed);
   if (!partition) {
     std::cout << "(error reading partition file " << path.str() << ")\n";
   }
@@ -475,6 +488,88 @@ void print_segment_v0(const vast::fbs::segment::v0* segment,
   }
 }
 
+void print_segment_v1(const vast::fbs::segment::v1* segment,
+                      indentation& indent,
+                      const formatting_options& formatting) {
+  vast::uuid id;
+  if (segment->uuid())
+    unpack(*segment->uuid(), id);
+  std::cout << indent << "Segment\n";
+  indented_scope _(indent);
+  std::cout << indent << "uuid: " << to_string(id) << "\n";
+  std::cout << indent << "events: " << segment->events() << "\n";
+  if (formatting.verbosity >= output_verbosity::verbose) {
+    std::cout << indent << "table_slices:\n";
+    indented_scope _(indent);
+    size_t total_size = 0;
+    size_t total_uncompressed_size = 0;
+    for (auto compressed_slice : *segment->slices()) {
+      auto slice
+        = vast::table_slice(*compressed_slice, vast::table_slice::verify::no);
+      std::cout << indent << slice.layout().name() << ": " << slice.rows()
+                << " rows";
+      if (formatting.print_bytesizes) {
+        auto size = compressed_slice->data()->size();
+        auto uncompressed_size = compressed_slice->uncompressed_size();
+        std::cout << " (" << print_bytesize(size, formatting) << ", "
+                  << print_bytesize(uncompressed_size, formatting)
+                  << " uncompressed)";
+        total_size += size;
+        total_uncompressed_size += uncompressed_size;
+      }
+      std::cout << '\n';
+    }
+    if (formatting.print_bytesizes)
+      std::cout << indent << "total: " << print_bytesize(total_size, formatting)
+                << " (" << print_bytesize(total_uncompressed_size, formatting)
+                << " uncompressed)\n";
+  }
+}
+
+void print_segment_v2(const vast::fbs::segment::v2* segment,
+                      vast::span<const vast::byte> bytes, indentation& indent,
+                      const formatting_options& formatting) {
+  vast::uuid id;
+  if (segment->uuid())
+    unpack(*segment->uuid(), id);
+  std::cout << indent << "Segment\n";
+  indented_scope _(indent);
+  std::cout << indent << "uuid: " << to_string(id) << "\n";
+  std::cout << indent << "events: " << segment->events() << "\n";
+  if (formatting.verbosity >= output_verbosity::verbose) {
+    std::cout << indent << "table_slices:\n";
+    indented_scope _(indent);
+    size_t total_size = 0;
+    size_t total_uncompressed_size = 0;
+    for (auto extent : *segment->slices()) {
+      if (extent->offset() > bytes.size()
+          || extent->size() > bytes.size() - extent->offset()) {
+        std::cout << indent << "(extent out of bounds)\n";
+        continue;
+      }
+      auto slice = vast::decompress(
+        bytes.subspan(extent->offset(), extent->size()),
+        extent->uncompressed_size(), vast::table_slice::verify::no);
+      std::cout << indent << slice.layout().name() << ": " << slice.rows()
+                << " rows";
+      if (formatting.print_bytesizes) {
+        auto size = extent->size();
+        auto uncompressed_size = extent->uncompressed_size();
+        std::cout << " (" << print_bytesize(size, formatting) << ", "
+                  << print_bytesize(uncompressed_size, formatting)
+                  << " uncompressed)";
+        total_size += size;
+        total_uncompressed_size += uncompressed_size;
+      }
+      std::cout << '\n';
+    }
+    if (formatting.print_bytesizes)
+      std::cout << indent << "total: " << print_bytesize(total_size, formatting)
+                << " (" << print_bytesize(total_uncompressed_size, formatting)
+                << " uncompressed)\n";
+  }
+}
+
 void print_segment(vast::path path, indentation& indent,
                    const formatting_options& formatting) {
   auto segment = read_flatbuffer_file<vast::fbs::Segment>(path);
@@ -485,6 +580,17 @@ void print_segment(vast::path path, indentation& indent,
     case vast::fbs::segment::Segment::v0:
       print_segment_v0(segment->segment_as_v0(), indent, formatting);
       break;
+    case vast::fbs::segment::Segment::v1:
+      print_segment_v1(segment->segment_as_v1(), indent, formatting);
+      break;
+    case vast::fbs::segment::Segment::v2:
+      // The table slices of a v2 segment live outside of the FlatBuffers
+      // table, so we need to pass the file contents along.
+      print_segment_v2(
+        segment->segment_as_v2(),
+        vast::span<const vast::byte>{segment.get_deleter().chunk_}, indent,
+        formatting);
+      break;
     default:
       std::cout << "(unknown partition version)\n";
   }